@@ -0,0 +1,59 @@
+/*
+ * arena.h
+ * for tasknc
+ * by mjheagle
+ */
+
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stddef.h>
+
+/**
+ * arena block - a chunk of memory handed out by an arena
+ * next - the previously allocated block
+ * size - the usable size of the block
+ * used - how much of the block has been handed out
+ * data - the memory of the block
+ */
+struct arena_block {
+    struct arena_block* next;
+    size_t size;
+    size_t used;
+    char data[];
+};
+
+/**
+ * arena owned struct - a malloc'd pointer which is released with an arena
+ * ptr  - the pointer to free
+ * next - the next owned pointer
+ */
+struct arena_owned {
+    void* ptr;
+    struct arena_owned* next;
+};
+
+/**
+ * arena struct - a bump allocator whose memory is released all at once
+ * blocks    - the blocks allocated, newest first
+ * owned     - malloc'd pointers that are freed along with the arena
+ * blocksize - the default size of a new block
+ * allocated - the total size of all blocks
+ */
+struct arena {
+    struct arena_block* blocks;
+    struct arena_owned* owned;
+    size_t blocksize;
+    size_t allocated;
+};
+
+void* arena_adopt(struct arena* arena, void* ptr);
+void* arena_alloc(struct arena* arena, size_t size);
+void arena_free(struct arena* arena);
+void arena_init(struct arena* arena, const size_t blocksize);
+void arena_merge(struct arena* arena, struct arena* other);
+char* arena_strndup(struct arena* arena, const char* str, const size_t len);
+
+#endif
+
+// vim: et ts=4 sw=4 sts=4
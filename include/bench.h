@@ -0,0 +1,30 @@
+/*
+ * bench.h
+ * for tasknc
+ * by mjheagle
+ */
+
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include <curses.h>
+#include <stdio.h>
+#include "common.h"
+
+void bench(const char* args);
+
+extern FILE* logfp;
+extern struct config cfg;
+extern int cols;
+extern WINDOW* header;
+extern struct task* head;
+extern int pageoffset;
+extern int rows;
+extern int selline;
+extern WINDOW* statusbar;
+extern int taskcount;
+extern WINDOW* tasklist;
+
+#endif
+
+// vim: et ts=4 sw=4 sts=4
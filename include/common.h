@@ -7,6 +7,7 @@
 #ifndef _COMMON_H
 #define _COMMON_H
 
+#include <regex.h>
 #include <stdbool.h>
 #include <time.h>
 
@@ -46,29 +47,89 @@ struct var {
     void* ptr;
 };
 
+/* size of a uuid in binary form */
+#define UUIDKEYLENGTH                   16
+
+/**
+ * task detail - the taskwarrior data of a task which is not needed to sort,
+ * filter (beyond project, tags and priority) or mark the task list
+ * it is kept out of the task struct so that those loops touch less memory
+ * uuid         - the uuid string
+ * description  - the description
+ * tags         - the tags, in the form "tag1","tag2"
+ * annotations  - the descriptions of the annotations, one per line
+ * entry        - the time the task was added
+ * end          - the time the task was completed or deleted
+ * modified     - the time the task was last modified
+ * urgency      - the urgency taskwarrior computed for the task
+ * nannotations - the number of annotations
+ * status       - the first letter of the status (pending, completed,
+ *                deleted, waiting or recurring), 0 if it is unknown
+ */
+struct task_detail {
+    char* uuid;
+    char* description;
+    char* tags;
+    char* annotations;
+    time_t entry;
+    time_t end;
+    time_t modified;
+    double urgency;
+    unsigned int nannotations;
+    char status;
+};
+
 /**
  * task struct - the main structure in this program!
- * the fields thru description are data from the taskwarrior json
- * selpair - the cached color pair to be used when this task is selected
- * pair    - the cached color pair to be used when this task is not selected
- * prev    - the previous task struct
- * next    - the next task struct
+ * it holds what the sort, filter and draw loops read, largest fields first,
+ * and points to the rest of the task's data
+ * project  - the project, the shared copy of its name if it is interned
+ * tagids   - the symbol ids of the tags, in the order of the tags string
+ * detail   - the rest of the taskwarrior data of the task
+ * start    - the time the task was started, 0 if it is not active
+ * due      - the due time of the task, 0 if it has none
+ * uuidkey  - the uuid in binary form, used for hashing and comparison
+ * index    - the taskwarrior id of the task
+ * projectid - the symbol id of the project
+ * position - the line of the task in the position index
+ * ntags    - the number of tags
+ * priority - the priority of the task (H, M or L), 0 if it has none
+ * marked   - whether the task is marked for a batch command
+ * datagen  - bumped whenever the task's data is changed in place
+ * colorgen - the color rules generation the cached color pairs belong to
+ * colordatagen - the datagen the cached color pairs belong to
+ * selpair  - the cached color pair to be used when this task is selected
+ * pair     - the cached color pair to be used when this task is not selected
+ * prev     - the previous task struct
+ * next     - the next task struct
  */
 struct task {
     /* taskwarrior data */
-    unsigned short index;
-    char* uuid;
-    char* tags;
+    const char* project;
+    unsigned int* tagids;
+    struct task_detail* detail;
     time_t start;
-    time_t end;
-    time_t entry;
     time_t due;
-    char* project;
+    unsigned char uuidkey[UUIDKEYLENGTH];
+    unsigned int index;
+    unsigned int projectid;
+    /* position index */
+    int position;
+    unsigned short ntags;
     char priority;
-    char* description;
+    bool marked;
     /* color caching */
+    unsigned int datagen;
+    unsigned int colorgen;
+    unsigned int colordatagen;
     int selpair;
     int pair;
+    /* line caching */
+    char* line;
+    unsigned int linesize;
+    unsigned int linegen;
+    unsigned int linedatagen;
+    int linewidth;
     /* linked list pointers */
     struct task* prev;
     struct task* next;
@@ -90,6 +151,9 @@ enum fmt_field_type {
     FIELD_PRIORITY,
     FIELD_UUID,
     FIELD_INDEX,
+    FIELD_URGENCY,
+    FIELD_STATUS,
+    FIELD_ANNOTATIONS,
     FIELD_STRING,
     FIELD_VAR,
     FIELD_CONDITIONAL,
@@ -166,6 +230,11 @@ enum log_mode {
  * version           - the task warrior version being wrapped
  * sortmode          - the active sort mode
  * follow_task       - whether a task will be followed when it moves in the list
+ * snapshot          - whether the task list is cached on disk for startup
+ * watch             - whether the data files are watched for changes to reload
+ * metrics           - whether the metrics are written to the log on exit
+ * threads           - the number of threads large loads are parsed and sorted
+ *                     with, 0 for one per processor
  * formats           - string and compiled printing formats
  * fieldlengths      - width of some task data fields
  */
@@ -177,6 +246,10 @@ struct config {
     char* version;
     char* sortmode;
     bool follow_task;
+    int snapshot;
+    int watch;
+    int metrics;
+    int threads;
     struct {
         char* task;
         struct fmt_field* task_compiled;
@@ -206,10 +279,25 @@ struct config {
 /* min function */
 #define MIN(x, y)                       (x < y ? x : y)
 
+/* taskwarrior data files, relative to the data location */
+#define DATAFILES                       3
+extern const char* data_files[DATAFILES];
+
 /* functions */
+char* data_location(void);
+void free_regex_cache(void);
+int hex_value(const char c);
+bool match_regex(const char* haystack, const regex_t* regex);
 bool match_string(const char* haystack, const char* needle);
+long now_ms(void);
+const regex_t* regex_get(const char* pattern, const int flags);
+const regex_t* regex_pin(const char* pattern, const int flags);
+void regex_unpin(const char* pattern, const int flags);
+int thread_count(void);
 char* utc_date(const time_t timeint);
+char* utc_date_r(const time_t timeint, char* timestr);
 char* utc_time(const time_t timeint);
+char* utc_time_r(const time_t timeint, char* timestr);
 char* var_value_message(struct var* v, bool printname);
 
 #endif
@@ -13,7 +13,41 @@
 #define PROJECTLENGTH           64
 #define DESCRIPTIONLENGTH       512
 #define TIMELENGTH              32
+#define FIELDLENGTH             32
+#define EXPORTLENGTH            65536
+#define TASKARENALENGTH         65536
+#define SIDEPOOLLENGTH          4096
+#define INDEXLENGTH             1024
+#define SORTKEYS                16
+#define REGEXCACHELENGTH        32
+#define COLORMEMOLENGTH         256
+#define BATCHLENGTH             65536
+#define SEARCHTEXTLENGTH        65536
+#define SYMBOLARENALENGTH       4096
+#define SYMBOLTABLELENGTH       256
+#define PAGERTEXTLENGTH         16384
+#define PAGERREADLENGTH         16384
+#define PAGERLINESLENGTH        256
+#define VIEWCACHELENGTH         16
+#define FRAMESKIPS              16
+#define KEYTABLELENGTH          512
+#define KEYSEQUENCELENGTH       4
+#define KEYSEQUENCEWAIT         1000
+#define MAXTHREADS              16
+#define PARALLELPARSELENGTH     1048576
+#define PARALLELSORTLENGTH      16384
 #define LOGFILE                 "/tmp/.tasknc_runlog_%s"
+#define SNAPSHOTFILE            "/tmp/.tasknc_snapshot_%s"
+#define WATCHDELAY              250
+#define BENCHTASKS              10000
+#define BENCHRUNS               5
+#define BENCHROWS               50
+#define BENCHCOLS               120
+#define BENCHSEED               0x2545f4914f6cdd1dULL
+
+/* count allocations in benchmarks, by replacing malloc for the whole program
+ * with counting wrappers (glibc only), uncomment for benchmark builds */
+/* #define BENCH_COUNT_ALLOCS */
 
 /* static field lengths */
 #define UUIDLENGTH                      38
@@ -0,0 +1,23 @@
+/*
+ * filter.h
+ * for tasknc
+ * by mjheagle
+ */
+
+#ifndef _FILTER_H
+#define _FILTER_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "common.h"
+
+void filter_clear(void);
+bool filter_compile(const char* filter, const char* loaded);
+bool filter_match(const struct task* tsk);
+const char* filter_view(void);
+
+extern FILE* logfp;
+
+#endif
+
+// vim: et ts=4 sw=4 sts=4
@@ -11,8 +11,11 @@
 
 struct fmt_field* compile_format_string(char* fmt);
 char* eval_format(struct fmt_field* fmts, struct task* tsks);
+int eval_format_buffer(struct fmt_field* fmts, struct task* tsk, char* buffer,
+                       const size_t size);
 void compile_formats(void);
 void free_formats(void);
+unsigned int task_format_generation(void);
 
 #endif
 
@@ -0,0 +1,29 @@
+/*
+ * frame.h
+ * for tasknc
+ * by mjheagle
+ */
+
+#ifndef _FRAME_H
+#define _FRAME_H
+
+#include <curses.h>
+#include <stdio.h>
+
+void frame_damage(const int first, const int count);
+void frame_damage_all(void);
+void frame_damage_header(void);
+void frame_draw(void);
+void frame_free(void);
+void frame_scroll(const int lines);
+
+extern FILE* logfp;
+extern int taskcount;
+extern int pageoffset;
+extern WINDOW* header;
+extern WINDOW* statusbar;
+extern WINDOW* tasklist;
+
+#endif
+
+// vim: et ts=4 sw=4 sts=4
@@ -0,0 +1,27 @@
+/*
+ * index.h
+ * for tasknc
+ * by mjheagle
+ */
+
+#ifndef _INDEX_H
+#define _INDEX_H
+
+#include <stdbool.h>
+#include "common.h"
+
+void index_build(struct task* first);
+int index_find_uuid(const char* uuid);
+void index_free(void);
+struct task* index_get(const int n);
+void index_insert(const int n, struct task* tsk);
+int index_length(void);
+int index_project_length(void);
+void index_remove(const int n);
+void index_reposition(const int from, const int to, struct task* tsk);
+unsigned int index_version(void);
+bool uuid_to_key(const char* uuid, unsigned char* key);
+
+#endif
+
+// vim: et ts=4 sw=4 sts=4
@@ -0,0 +1,29 @@
+/*
+ * intern.h
+ * for tasknc
+ * by mjheagle
+ */
+
+#ifndef _INTERN_H
+#define _INTERN_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "arena.h"
+#include "common.h"
+
+/* the symbol id of a missing string */
+#define NOSYMBOL                        0
+
+unsigned int intern(const char* str, const size_t len);
+unsigned int intern_count(void);
+void intern_free(void);
+size_t intern_length(const unsigned int id);
+const char* intern_name(const unsigned int id);
+void intern_task(struct task* tsk, struct arena* arena);
+
+extern FILE* logfp;
+
+#endif
+
+// vim: et ts=4 sw=4 sts=4
@@ -0,0 +1,34 @@
+/*
+ * json.h
+ * for tasknc
+ * by mjheagle
+ */
+
+#ifndef _JSON_H
+#define _JSON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* json value types */
+enum json_type {
+    JSON_ERROR,
+    JSON_STRING,
+    JSON_NUMBER,
+    JSON_OBJECT,
+    JSON_ARRAY,
+    JSON_TRUE,
+    JSON_FALSE,
+    JSON_NULL
+};
+
+char* json_expect(char* pos, const char c);
+char* json_parse_number(char* pos, double* value);
+char* json_parse_string(char* pos, char** str, size_t* len);
+enum json_type json_peek(const char* pos);
+char* json_skip_value(char* pos);
+char* json_skip_ws(char* pos);
+
+#endif
+
+// vim: et ts=4 sw=4 sts=4
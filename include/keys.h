@@ -5,11 +5,15 @@
  */
 
 #include "common.h"
+#include "config.h"
 
 /**
  * keybind structure
- * key      - the key which triggers the bind
+ * key      - the key which triggers the bind, the first of a sequence
+ * keys     - the sequence of keys which triggers the bind
+ * nkeys    - the number of keys in the sequence
  * function - the function to be run on bind trigger
+ * funcname - the name of the function
  * argint   - integer argument to be supplied to function
  * argstr   - string argument to be supplied to function
  * mode     - which mode this keybind should run in
@@ -17,7 +21,10 @@
  */
 struct keybind {
     int key;
+    int keys[KEYSEQUENCELENGTH];
+    int nkeys;
     void (*function)();
+    const char* funcname;
     int argint;
     char* argstr;
     enum prog_mode mode;
@@ -34,13 +41,27 @@ void add_keybind(const int key,
                  char* arg,
                  const enum prog_mode mode);
 
+void add_keybind_sequence(const int* keys,
+                          const int nkeys,
+                          void* function,
+                          char* arg,
+                          const enum prog_mode mode);
+
+void free_keybinds(void);
+
 void handle_keypress(const int c, const enum prog_mode mode);
 
+int keys_timeout(void);
+
 char* name_key(const int val);
 
+char* name_keys(const int* keys, const int nkeys);
+
 int parse_key(const char* keystr);
 
-int remove_keybinds(const int key, const enum prog_mode mode);
+int parse_keys(const char* keystr, int* keys);
+
+int remove_keybinds(const int* keys, const int nkeys, const enum prog_mode mode);
 
 extern FILE* logfp;
 extern struct keybind* keybinds;
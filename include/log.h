@@ -10,11 +10,20 @@
 #include <stdio.h>
 #include "common.h"
 
+/* the level is checked before the arguments are evaluated, so a disabled
+ * log costs only the comparison */
+#define tnc_fprintf(fp, minloglvl, ...) \
+    do { \
+        if ((minloglvl) <= cfg.loglvl) { \
+            tnc_log(fp, minloglvl, __VA_ARGS__); \
+        } \
+    } while (0)
+
 extern struct config cfg;
-void tnc_fprintf(FILE* fp,
-                 const enum log_mode monloglvl,
-                 const char* format,
-                 ...) __attribute__((format(printf, 3, 4)));
+void tnc_log(FILE* fp,
+             const enum log_mode minloglvl,
+             const char* format,
+             ...) __attribute__((format(printf, 3, 4)));
 
 #endif
 
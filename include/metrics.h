@@ -0,0 +1,62 @@
+/*
+ * metrics.h
+ * for tasknc
+ * by mjheagle
+ */
+
+#ifndef _METRICS_H
+#define _METRICS_H
+
+#include <stdio.h>
+
+/* the phases of work which are timed */
+enum metric_phase {
+    PHASE_EXPORT,
+    PHASE_PARSE,
+    PHASE_SORT,
+    PHASE_FILTER,
+    PHASE_RENDER,
+    PHASE_SPAWN,
+    PHASES
+};
+
+/* the events which are counted */
+enum metric_counter {
+    COUNTER_REGEX,
+    COUNTER_ARENA,
+    COUNTERS
+};
+
+/**
+ * phase timer - the time spent in a phase of work
+ * calls - the number of times the phase ran
+ * us    - the total time it took in microseconds, as far as an int holds
+ * ns    - the total time it took in nanoseconds
+ */
+struct phase_timer {
+    int calls;
+    int us;
+    long long ns;
+};
+
+/**
+ * metrics - the timers and counters of the running program
+ * phases   - the timer of each phase
+ * counters - the count of each event
+ */
+struct metrics {
+    struct phase_timer phases[PHASES];
+    int counters[COUNTERS];
+};
+
+void metrics_count(const enum metric_counter counter);
+void metrics_dump(void);
+void metrics_end(const enum metric_phase phase, const long long start);
+long long metrics_start(void);
+
+extern FILE* logfp;
+extern struct metrics metrics;
+
+#endif
+
+// vim: et ts=4 sw=4 sts=4
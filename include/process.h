@@ -0,0 +1,27 @@
+/*
+ * process.h
+ * for tasknc
+ * by mjheagle
+ */
+
+#ifndef _PROCESS_H
+#define _PROCESS_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+int process_close(FILE* fp);
+int process_fd(void);
+void process_flush(void);
+FILE* process_open(const char* cmdstr);
+bool process_pending(void);
+void process_poll(void);
+void process_queue(const char* cmdstr, void (*done)(const int, const char*),
+                 const char* arg);
+int process_status(const int status);
+
+extern FILE* logfp;
+
+#endif
+
+// vim: et ts=4 sw=4 sts=4
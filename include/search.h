@@ -0,0 +1,21 @@
+/*
+ * search.h
+ * for tasknc
+ * by mjheagle
+ */
+
+#ifndef _SEARCH_H
+#define _SEARCH_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+int search_find(const char* pattern, const int from, const int direction, bool* wrapped);
+void search_free(void);
+int search_matches(const char* pattern, const int** lines);
+
+extern FILE* logfp;
+
+#endif
+
+// vim: et ts=4 sw=4 sts=4
@@ -0,0 +1,37 @@
+/*
+ * snapshot.h
+ * for tasknc
+ * by mjheagle
+ */
+
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include <time.h>
+#include "arena.h"
+#include "common.h"
+
+/**
+ * snapshot stamp - the state of the taskwarrior data files
+ * a snapshot is only used while its stamp matches the data files
+ * mtime - the modification time of each data file, 0 if it does not exist
+ * nsec  - the nanoseconds of each modification time
+ * size  - the size of each data file
+ */
+struct snapshot_stamp {
+    time_t mtime[DATAFILES];
+    long nsec[DATAFILES];
+    off_t size[DATAFILES];
+};
+
+struct task* snapshot_read(struct arena* arena, const char* filter, void** map,
+                           size_t* maplen);
+void snapshot_stamp(struct snapshot_stamp* stamp);
+bool snapshot_write(struct task* first, const char* filter,
+                    const struct snapshot_stamp* stamp);
+
+#endif
+
+// vim: et ts=4 sw=4 sts=4
@@ -7,7 +7,11 @@
 #include <stdio.h>
 #include "common.h"
 
-void sort_wrapper(struct task* first);
+struct task* sort_insert(struct task* first, struct task* tsk);
+struct task* sort_reposition(struct task* first,
+                             struct task* old,
+                             struct task* tsk);
+struct task* sort_tasks(struct task* first);
 
 extern struct config cfg;
 extern FILE* logfp;
@@ -15,6 +15,10 @@ void free_prompts(void);
 int statusbar_getstr(char** str,
                      const char* msg);
 
+int statusbar_getstr_live(char** str,
+                          const char* msg,
+                          void (*update)(const char*));
+
 void statusbar_message(const int dtmout,
                        const char* format,
                        ...) __attribute__((format(printf, 2, 3)));
@@ -15,6 +15,8 @@ void key_tasklist_complete(void);
 void key_tasklist_delete(void);
 void key_tasklist_edit(void);
 void key_tasklist_filter(const char* arg);
+void key_tasklist_mark(void);
+void key_tasklist_mark_matching(const char* arg);
 void key_tasklist_modify(const char* arg);
 void key_tasklist_reload(void);
 void key_tasklist_scroll(const int direction);
@@ -24,10 +26,12 @@ void key_tasklist_scroll_home(void);
 void key_tasklist_scroll_up(void);
 void key_tasklist_search(const char* arg);
 void key_tasklist_search_next(void);
+void key_tasklist_search_prev(void);
 void key_tasklist_sort(const char* arg);
 void key_tasklist_sync(void);
 void key_tasklist_toggle_started(void);
 void key_tasklist_undo(void);
+void key_tasklist_unmark_all(void);
 void key_tasklist_view(void);
 void tasklist_check_curs_pos(void);
 void tasklist_print_task(const int tasknum, const struct task* this, const int count);
@@ -37,6 +41,7 @@ void tasklist_task_add(void);
 void tasklist_window(void);
 
 extern bool reload;
+extern bool reload_changed;
 extern bool redraw;
 extern bool done;
 extern char* active_filter;
@@ -47,7 +52,7 @@ extern int cols;
 extern int rows;
 extern int selline;
 extern int taskcount;
-extern short pageoffset;
+extern int pageoffset;
 extern struct task* head;
 extern time_t sb_timeout;
 extern WINDOW* tasklist;
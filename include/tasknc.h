@@ -15,12 +15,14 @@
 #define wipe_tasklist()                 wipe_screen(tasklist, 0, rows-2)
 #define wipe_statusbar()                wipe_screen(statusbar, 0, 0)
 
-#define NVARS                           (int)(sizeof(vars)/sizeof(struct var))
+/* vars ends with a sentinel, which is not counted */
+#define NVARS                           (int)(sizeof(vars)/sizeof(struct var) - 1)
 #define NFUNCS                          (int)(sizeof(funcmaps)/sizeof(struct funcmap))
 
 /* default settings */
 #define STATUSBAR_TIMEOUT_DEFAULT       3
 #define NCURSES_WAIT                    500
+#define NCURSES_LOAD_WAIT               20
 #define LOGLVL_DEFAULT                  3
 
 /* function prototypes */
@@ -29,7 +31,7 @@ void check_screen_size(void);
 void cleanup(void);
 void configure(void);
 struct funcmap* find_function(const char* name, const enum prog_mode mode);
-void find_next_search_result(struct task* head, struct task* pos);
+void find_search_result(const struct task* pos, const int direction);
 struct var* find_var(const char* name);
 void force_redraw(void);
 void handle_resize(void);
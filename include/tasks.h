@@ -8,25 +8,50 @@
 #define _TASKS_H
 
 #include <stdbool.h>
+#include "arena.h"
 #include "common.h"
 
-char free_task(struct task* tsk);
-void free_tasks(struct task* head);
+/* progress of a background load of the task list */
+enum load_status {
+    LOAD_RUNNING,
+    LOAD_PAINTED,
+    LOAD_READY
+};
+
+void free_tasks(void);
 struct task* get_task_by_position(int n);
 int get_task_position_by_uuid(const char* uuid);
 struct task* get_tasks(char* uuid);
-unsigned short get_task_id(char* uuid);
-struct task* malloc_task(void);
-struct task* parse_task(char* line);
+unsigned int get_task_id(char* uuid);
+void load_tasks_cancel(void);
+struct task* load_tasks_export(const char* data, const size_t len);
+void load_tasks_finish(void);
+bool load_tasks_pending(void);
+enum load_status load_tasks_poll(const int screenful);
+void load_tasks_refresh(void);
+bool load_tasks_snapshot(void);
+void load_tasks_start(void);
+struct task* malloc_task(struct arena* arena);
+bool parse_export(char* pos, char* end, struct arena* arena,
+                  struct task** first, struct task** last,
+                  unsigned int* count);
+struct task* parse_task(char** line, struct arena* arena);
+bool refresh_tasks(void);
 void reload_task(struct task* this);
 void reload_tasks(void);
-void remove_char(char* str, char remove);
 void set_position_by_uuid(const char* uuid);
 int task_background_command(const char* cmdfmt);
+int task_batch_command(const char* cmd);
 void task_count(void);
+bool task_filter(const char* filter);
 int task_interactive_command(const char* cmdfmt);
+const char* task_line(struct task* tsk, const int width);
 bool task_match(const struct task* cur, const char* str);
+bool task_match_regex(const struct task* cur, const regex_t* regex);
+void task_mark(struct task* tsk, const bool marked);
+int task_marks(void);
 void task_modify(const char* argstr);
+void task_unmark_all(void);
 
 extern FILE* logfp;
 extern struct task* head;
@@ -0,0 +1,25 @@
+/*
+ * watch.h
+ * for tasknc
+ * by mjheagle
+ */
+
+#ifndef _WATCH_H
+#define _WATCH_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+void watch_clear(void);
+bool watch_due(void);
+int watch_fd(void);
+void watch_read(void);
+bool watch_start(void);
+void watch_stop(void);
+int watch_timeout(void);
+
+extern FILE* logfp;
+
+#endif
+
+// vim: et ts=4 sw=4 sts=4
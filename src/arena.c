@@ -0,0 +1,176 @@
+/*
+ * arena.c - bump allocation for memory that shares a lifetime
+ * for tasknc
+ * by mjheagle
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "metrics.h"
+
+/* alignment of every allocation */
+#define ARENA_ALIGN             16
+#define ARENA_ROUND(x)          (((x) + ARENA_ALIGN - 1) & ~((size_t)ARENA_ALIGN - 1))
+
+void* arena_adopt(struct arena* arena, void* ptr) { /* {{{ */
+    /**
+     * transfer ownership of a malloc'd pointer to an arena
+     * arena - the arena which will free the pointer
+     * ptr   - the pointer to adopt
+     * return is ptr, or NULL on failure (in which case ptr is freed)
+     */
+    struct arena_owned* owned;
+
+    if (ptr == NULL) {
+        return NULL;
+    }
+
+    owned = arena_alloc(arena, sizeof(struct arena_owned));
+
+    if (owned == NULL) {
+        free(ptr);
+        return NULL;
+    }
+
+    owned->ptr = ptr;
+    owned->next = arena->owned;
+    arena->owned = owned;
+
+    return ptr;
+} /* }}} */
+
+void* arena_alloc(struct arena* arena, size_t size) { /* {{{ */
+    /**
+     * allocate zeroed memory from an arena
+     * arena - the arena to allocate from
+     * size  - the number of bytes requested
+     * return is the memory, or NULL on failure
+     */
+    struct arena_block* block = arena->blocks;
+    size_t              blocksize;
+    void*               ret;
+
+    size = ARENA_ROUND(size);
+
+    /* start a new block if the current one is full */
+    if (block == NULL || block->size - block->used < size) {
+        blocksize = size > arena->blocksize ? size : arena->blocksize;
+        block = malloc(sizeof(struct arena_block) + blocksize);
+
+        if (block == NULL) {
+            return NULL;
+        }
+
+        block->size = blocksize;
+        block->used = 0;
+        arena->allocated += blocksize;
+        metrics_count(COUNTER_ARENA);
+
+        /* keep filling the old block if a large allocation got its own */
+        if (arena->blocks != NULL && blocksize > arena->blocksize) {
+            block->next = arena->blocks->next;
+            arena->blocks->next = block;
+        } else {
+            block->next = arena->blocks;
+            arena->blocks = block;
+        }
+    }
+
+    ret = block->data + block->used;
+    block->used += size;
+    memset(ret, 0, size);
+
+    return ret;
+} /* }}} */
+
+void arena_free(struct arena* arena) { /* {{{ */
+    /**
+     * release all memory held by an arena
+     * arena - the arena to free, which is left empty and reusable
+     */
+    struct arena_block* block;
+
+    while (arena->owned != NULL) {
+        free(arena->owned->ptr);
+        arena->owned = arena->owned->next;
+    }
+
+    while (arena->blocks != NULL) {
+        block = arena->blocks;
+        arena->blocks = block->next;
+        free(block);
+    }
+
+    arena->allocated = 0;
+} /* }}} */
+
+void arena_init(struct arena* arena, const size_t blocksize) { /* {{{ */
+    /**
+     * initialize an empty arena
+     * arena     - the arena to initialize
+     * blocksize - the size of the blocks it will allocate
+     */
+    arena->blocks = NULL;
+    arena->owned = NULL;
+    arena->blocksize = ARENA_ROUND(blocksize);
+    arena->allocated = 0;
+} /* }}} */
+
+void arena_merge(struct arena* arena, struct arena* other) { /* {{{ */
+    /**
+     * move all memory held by an arena into another, which then frees it
+     * the block being filled stays first, so allocation goes on from it
+     * arena - the arena which takes the memory
+     * other - the arena which gives it up, which is left empty and reusable
+     */
+    struct arena_block* block = other->blocks;
+    struct arena_owned* owned = other->owned;
+
+    if (block != NULL) {
+        while (block->next != NULL) {
+            block = block->next;
+        }
+
+        if (arena->blocks != NULL) {
+            block->next = arena->blocks->next;
+            arena->blocks->next = other->blocks;
+        } else {
+            arena->blocks = other->blocks;
+        }
+    }
+
+    if (owned != NULL) {
+        while (owned->next != NULL) {
+            owned = owned->next;
+        }
+
+        owned->next = arena->owned;
+        arena->owned = other->owned;
+    }
+
+    arena->allocated += other->allocated;
+    other->blocks = NULL;
+    other->owned = NULL;
+    other->allocated = 0;
+} /* }}} */
+
+char* arena_strndup(struct arena* arena, const char* str, const size_t len) { /* {{{ */
+    /**
+     * copy a string into an arena
+     * arena - the arena to allocate from
+     * str   - the string to copy
+     * len   - the number of characters to copy
+     * return is the null terminated copy, or NULL on failure
+     */
+    char* ret = arena_alloc(arena, len + 1);
+
+    if (ret != NULL) {
+        memcpy(ret, str, len);
+        ret[len] = 0;
+    }
+
+    return ret;
+} /* }}} */
+
+// vim: et ts=4 sw=4 sts=4
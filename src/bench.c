@@ -0,0 +1,589 @@
+/*
+ * bench.c - benchmarks on a synthetic task list
+ * for tasknc
+ * by mjheagle
+ */
+
+#define _GNU_SOURCE
+#include <curses.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bench.h"
+#include "color.h"
+#include "common.h"
+#include "config.h"
+#include "formats.h"
+#include "frame.h"
+#include "search.h"
+#include "sort.h"
+#include "tasks.h"
+#include "tasknc.h"
+
+#ifdef TASKNC_INCLUDE_TESTS
+#if defined(BENCH_COUNT_ALLOCS) && \
+    (!defined(__GLIBC__) || defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__))
+#undef BENCH_COUNT_ALLOCS
+#endif
+
+#ifdef BENCH_COUNT_ALLOCS
+/* allocations are counted by replacing malloc with wrappers of glibc's own
+ * these are shared by every thread, so the count is atomic */
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void __libc_free(void* ptr);
+extern void* __libc_malloc(size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+#endif
+
+/**
+ * benchmark data - the synthetic task list the benchmarks run on
+ * export - the tasks as taskwarrior exports them
+ * length - the length of export
+ * ntasks - the number of tasks
+ * arena  - the memory of a copy of the tasks, which the sorts reorder
+ * order  - the tasks of that copy in the order they were exported
+ */
+static struct {
+    char* export;
+    size_t length;
+    int ntasks;
+    struct arena arena;
+    struct task** order;
+} data;
+
+/**
+ * benchmark run - the best of the runs of a benchmark
+ * ns     - the shortest time a run took
+ * allocs - the allocations made by that run
+ */
+struct bench_run {
+    long ns;
+    unsigned long allocs;
+};
+
+static unsigned long            allocs = 0;
+static unsigned long long       seed   = BENCHSEED;
+
+static const char* areas[] = {"home", "work", "garden", "tasknc", "finance",
+                              "health", "travel", "study"
+                             };
+static const char* subprojects[] = {"meetings", "admin", "ops", "docs", "kitchen",
+                                    "q3"
+                                   };
+static const char* tagnames[] = {"next", "waiting", "bug", "feature", "errand",
+                                 "phone", "home", "office", "someday", "review",
+                                 "urgent", "blocked", "email", "read", "deploy", "idea"
+                                };
+static const char* words[] = {"write", "review", "call", "fix", "update", "plan",
+                              "email", "buy", "clean", "read", "draft", "meeting",
+                              "report", "notes", "budget", "garden", "invoice",
+                              "release", "parser", "sort", "search", "kitchen",
+                              "dentist", "renew", "backup", "server", "patch",
+                              "design", "proposal", "slides", "taxes", "groceries"
+                             };
+#define NAREAS          (int)(sizeof(areas) / sizeof(char*))
+#define NSUBPROJECTS    (int)(sizeof(subprojects) / sizeof(char*))
+#define NTAGNAMES       (int)(sizeof(tagnames) / sizeof(char*))
+#define NWORDS          (int)(sizeof(words) / sizeof(char*))
+
+/* local functions */
+static void bench_color(void);
+static void bench_end(struct bench_run* run, const long start, const unsigned long before);
+static void bench_format(void);
+static void bench_generate(const int ntasks);
+static void bench_load(void);
+static long bench_now(void);
+static void bench_parse(void);
+static int bench_random(const int n);
+static void bench_render(void);
+static void bench_report(const char* name, const struct bench_run* run, const int ntasks);
+static void bench_search(void);
+static int bench_skewed(const int n);
+static void bench_sort(void);
+static void bench_task(FILE* out, const int n);
+
+#ifdef BENCH_COUNT_ALLOCS
+void* calloc(size_t nmemb, size_t size) { /* {{{ */
+    __atomic_fetch_add(&allocs, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(nmemb, size);
+} /* }}} */
+
+void free(void* ptr) { /* {{{ */
+    __libc_free(ptr);
+} /* }}} */
+
+void* malloc(size_t size) { /* {{{ */
+    __atomic_fetch_add(&allocs, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+} /* }}} */
+
+void* realloc(void* ptr, size_t size) { /* {{{ */
+    __atomic_fetch_add(&allocs, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(ptr, size);
+} /* }}} */
+#endif
+
+void bench(const char* args) { /* {{{ */
+    /**
+     * run benchmarks on a synthetic task list, without taskwarrior
+     * args - the benchmarks to run, or all, optionally followed by a colon
+     *        and the number of tasks to generate
+     */
+    struct bench {
+        const char* name;
+        void (*function)(void);
+    };
+    struct bench benches[] = {
+        {"load", bench_load},
+        {"parse", bench_parse},
+        {"sort", bench_sort},
+        {"search", bench_search},
+        {"color", bench_color},
+        {"format", bench_format},
+        {"render", bench_render},
+    };
+    const int   nbenches = sizeof(benches) / sizeof(struct bench);
+    const char* count = strrchr(args, ':');
+    FILE*       termout = fopen("/dev/null", "w");
+    FILE*       termin = fopen("/dev/null", "r");
+    SCREEN*     screen;
+    int         ntasks = count != NULL ? atoi(count + 1) : 0;
+    int         i;
+
+    /* draw to a terminal whose output is discarded */
+    screen = newterm("xterm", termout, termin);
+
+    if (screen == NULL) {
+        puts("could not create a terminal to draw to");
+        return;
+    }
+
+    resize_term(BENCHROWS, BENCHCOLS);
+    rows = LINES;
+    cols = COLS;
+    init_colors();
+    configure();
+
+    header      = newwin(1, cols, 0, 0);
+    tasklist    = newwin(rows - 2, cols, 1, 0);
+    statusbar   = newwin(1, cols, rows - 1, 0);
+
+    /* generate and load the tasks every benchmark runs on */
+    bench_generate(ntasks > 0 ? ntasks : BENCHTASKS);
+    head = load_tasks_export(data.export, data.length);
+    task_count();
+    cfg.fieldlengths.project     = max_project_length();
+    cfg.fieldlengths.date        = DATELENGTH;
+    cfg.fieldlengths.description = cols - cfg.fieldlengths.project - 1 -
+                                   cfg.fieldlengths.date;
+    printf("%d tasks, %zu bytes of export, best of %d runs\n", data.ntasks, data.length,
+           BENCHRUNS);
+
+    for (i = 0; i < nbenches; i++) {
+        if (strncmp(args, "all", 3) == 0 || strstr(args, benches[i].name) != NULL) {
+            (benches[i].function)();
+        }
+    }
+
+    delwin(header);
+    delwin(tasklist);
+    delwin(statusbar);
+    header = tasklist = statusbar = NULL;
+    endwin();
+    delscreen(screen);
+    fclose(termout);
+    fclose(termin);
+    free(data.export);
+    free(data.order);
+    arena_free(&(data.arena));
+
+    cleanup();
+} /* }}} */
+
+void bench_color(void) { /* {{{ */
+    /* time evaluating the color rules of every task */
+    struct bench_run    run = {LONG_MAX, 0};
+    struct task*        cur;
+    unsigned long       before;
+    long                start;
+    int                 r;
+
+    for (r = 0; r < BENCHRUNS; r++) {
+        /* drop the colors cached on the tasks */
+        for (cur = head; cur != NULL; cur = cur->next) {
+            cur->datagen++;
+        }
+
+        before = allocs;
+        start  = bench_now();
+
+        for (cur = head; cur != NULL; cur = cur->next) {
+            get_colors(OBJECT_TASK, cur, false);
+        }
+
+        bench_end(&run, start, before);
+    }
+
+    bench_report("color", &run, taskcount);
+} /* }}} */
+
+void bench_end(struct bench_run* run, const long start, const unsigned long before) { /* {{{ */
+    /**
+     * record a run of a benchmark, if it is the fastest so far
+     * run    - the best run so far
+     * start  - when the run started
+     * before - the count of allocations when the run started
+     */
+    const long ns = bench_now() - start;
+
+    if (ns < run->ns) {
+        run->ns     = ns;
+        run->allocs = allocs - before;
+    }
+} /* }}} */
+
+void bench_format(void) { /* {{{ */
+    /* time evaluating the task format for every task */
+    struct bench_run    run = {LONG_MAX, 0};
+    struct task*        cur;
+    unsigned long       before;
+    long                start;
+    int                 r;
+
+    for (r = 0; r < BENCHRUNS; r++) {
+        before = allocs;
+        start  = bench_now();
+
+        for (cur = head; cur != NULL; cur = cur->next) {
+            free(eval_format(cfg.formats.task_compiled, cur));
+        }
+
+        bench_end(&run, start, before);
+    }
+
+    bench_report("format", &run, taskcount);
+} /* }}} */
+
+void bench_generate(const int ntasks) { /* {{{ */
+    /**
+     * generate the export output of a task list
+     * projects and tags follow a skewed distribution, as a few of them
+     * usually hold most tasks
+     * ntasks - the number of tasks
+     */
+    FILE*           out = open_memstream(&(data.export), &(data.length));
+    struct task*    first = NULL;
+    struct task*    last = NULL;
+    struct task*    cur;
+    unsigned int    count = 0;
+    char*           copy;
+    int             i;
+
+    fputs("[\n", out);
+
+    for (i = 0; i < ntasks; i++) {
+        bench_task(out, i);
+        fputs(i < ntasks - 1 ? ",\n" : "\n", out);
+    }
+
+    fputs("]\n", out);
+    fclose(out);
+
+    /* keep the export order of a parsed copy to sort from */
+    arena_init(&(data.arena), TASKARENALENGTH);
+    copy = arena_strndup(&(data.arena), data.export, data.length);
+    parse_export(copy, copy + data.length, &(data.arena), &first, &last, &count);
+    data.order = calloc(count + 1, sizeof(struct task*));
+
+    for (cur = first, i = 0; cur != NULL; cur = cur->next, i++) {
+        data.order[i] = cur;
+    }
+
+    data.ntasks = i;
+} /* }}} */
+
+void bench_load(void) { /* {{{ */
+    /* time a full load of the task list from its export output */
+    struct bench_run    run = {LONG_MAX, 0};
+    unsigned long       before;
+    long                start;
+    int                 r;
+
+    for (r = 0; r < BENCHRUNS; r++) {
+        before = allocs;
+        start  = bench_now();
+        head   = load_tasks_export(data.export, data.length);
+        bench_end(&run, start, before);
+    }
+
+    task_count();
+    bench_report("load", &run, taskcount);
+} /* }}} */
+
+long bench_now(void) { /* {{{ */
+    /* read the monotonic clock in ns */
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+} /* }}} */
+
+void bench_parse(void) { /* {{{ */
+    /* time parsing the export output, without sorting or indexing it */
+    struct bench_run    run = {LONG_MAX, 0};
+    struct arena        arena;
+    struct task*        first;
+    struct task*        last;
+    unsigned int        count;
+    unsigned long       before;
+    long                start;
+    char*               copy;
+    int                 r;
+
+    for (r = 0; r < BENCHRUNS; r++) {
+        arena_init(&arena, TASKARENALENGTH);
+        copy  = arena_strndup(&arena, data.export, data.length);
+        first = NULL;
+        last  = NULL;
+        count = 0;
+
+        before = allocs;
+        start  = bench_now();
+        parse_export(copy, copy + data.length, &arena, &first, &last, &count);
+        bench_end(&run, start, before);
+
+        arena_free(&arena);
+    }
+
+    bench_report("parse", &run, data.ntasks);
+} /* }}} */
+
+int bench_random(const int n) { /* {{{ */
+    /**
+     * draw a pseudorandom number, the same sequence on every run
+     * n - the number of values
+     * return is a number from 0 to n - 1
+     */
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+
+    return (int)(seed % n);
+} /* }}} */
+
+void bench_render(void) { /* {{{ */
+    /* time drawing every page of the task list, the tasks formatted afresh */
+    struct bench_run    run = {LONG_MAX, 0};
+    struct task*        cur;
+    unsigned long       before;
+    long                start;
+    const int           height = getmaxy(tasklist);
+    int                 r;
+
+    for (r = 0; r < BENCHRUNS; r++) {
+        for (cur = head; cur != NULL; cur = cur->next) {
+            cur->datagen++;
+        }
+
+        before = allocs;
+        start  = bench_now();
+
+        for (pageoffset = 0; pageoffset < taskcount; pageoffset += height) {
+            selline = pageoffset;
+            frame_damage_all();
+            frame_draw();
+        }
+
+        bench_end(&run, start, before);
+    }
+
+    pageoffset = 0;
+    selline = 0;
+    bench_report("render", &run, taskcount);
+} /* }}} */
+
+void bench_report(const char* name, const struct bench_run* run, const int ntasks) { /* {{{ */
+    /**
+     * print the result of a benchmark
+     * name   - the name of the benchmark
+     * run    - its best run
+     * ntasks - the number of tasks the run handled
+     */
+    const int n = ntasks > 0 ? ntasks : 1;
+
+#ifdef BENCH_COUNT_ALLOCS
+    printf("%-20s %10.1f ns/task %8.2f allocs/task\n", name, (double)run->ns / n,
+           (double)run->allocs / n);
+#else
+    printf("%-20s %10.1f ns/task\n", name, (double)run->ns / n);
+#endif
+} /* }}} */
+
+void bench_search(void) { /* {{{ */
+    /* time searching the task list, from a fresh search each run */
+    const char*         patterns[] = {"review", "zzzz", "^fix .*notes", "work.meetings"};
+    const int           npatterns = sizeof(patterns) / sizeof(char*);
+    struct bench_run    run;
+    unsigned long       before;
+    long                start;
+    char*               name;
+    int                 p;
+    int                 r;
+
+    for (p = 0; p < npatterns; p++) {
+        run.ns = LONG_MAX;
+        run.allocs = 0;
+
+        for (r = 0; r < BENCHRUNS; r++) {
+            search_free();
+            before = allocs;
+            start  = bench_now();
+            search_matches(patterns[p], NULL);
+            bench_end(&run, start, before);
+        }
+
+        asprintf(&name, "search %s", patterns[p]);
+        bench_report(name, &run, taskcount);
+        free(name);
+    }
+} /* }}} */
+
+int bench_skewed(const int n) { /* {{{ */
+    /**
+     * draw a pseudorandom number, favoring small values
+     * n - the number of values
+     * return is a number from 0 to n - 1
+     */
+    const int a = bench_random(n);
+    const int b = bench_random(n);
+
+    return a < b ? a : b;
+} /* }}} */
+
+void bench_sort(void) { /* {{{ */
+    /* time sorting the tasks by each sort mode, from export order each run */
+    const char*         modes[] = {"drpu", "n", "pu", "rD"};
+    const int           nmodes = sizeof(modes) / sizeof(char*);
+    struct bench_run    run;
+    char*               oldmode = cfg.sortmode;
+    unsigned long       before;
+    long                start;
+    char*               name;
+    int                 m;
+    int                 r;
+    int                 i;
+
+    for (m = 0; m < nmodes; m++) {
+        run.ns = LONG_MAX;
+        run.allocs = 0;
+        cfg.sortmode = (char*)modes[m];
+
+        for (r = 0; r < BENCHRUNS; r++) {
+            /* put the tasks back in export order */
+            for (i = 0; i < data.ntasks; i++) {
+                data.order[i]->prev = i > 0 ? data.order[i - 1] : NULL;
+                data.order[i]->next = data.order[i + 1];
+            }
+
+            before = allocs;
+            start  = bench_now();
+            sort_tasks(data.order[0]);
+            bench_end(&run, start, before);
+        }
+
+        asprintf(&name, "sort %s", modes[m]);
+        bench_report(name, &run, data.ntasks);
+        free(name);
+    }
+
+    cfg.sortmode = oldmode;
+} /* }}} */
+
+void bench_task(FILE* out, const int n) { /* {{{ */
+    /**
+     * write the export output of a generated task
+     * out - where the output is written
+     * n   - the number of the task
+     */
+    int nwords = 3 + bench_random(10);
+    int ntags;
+    int i;
+
+    fprintf(out, "{\"id\":%d,\"description\":\"", n + 1);
+
+    for (i = 0; i < nwords; i++) {
+        fprintf(out, "%s%s", i > 0 ? " " : "", words[bench_skewed(NWORDS)]);
+    }
+
+    /* some descriptions need their escapes undone */
+    if (bench_random(20) == 0) {
+        fputs(" \\\"quoted\\\"", out);
+    } else if (bench_random(50) == 0) {
+        fputs(" caf\\u00e9", out);
+    }
+
+    fputs("\"", out);
+
+    if (bench_random(10) < 3) {
+        fprintf(out, ",\"due\":\"2024%02d%02dT000000Z\"", 1 + bench_random(12),
+                1 + bench_random(28));
+    }
+
+    fprintf(out, ",\"entry\":\"2023%02d%02dT120000Z\",\"modified\":\"2024%02d%02dT120000Z\"",
+            1 + bench_random(12), 1 + bench_random(28), 1 + bench_random(12),
+            1 + bench_random(28));
+
+    if (bench_random(10) < 4) {
+        fprintf(out, ",\"priority\":\"%c\"", "HML"[bench_random(3)]);
+    }
+
+    if (bench_random(10) < 8) {
+        i = bench_skewed(NAREAS);
+
+        if (bench_random(3) == 0) {
+            fprintf(out, ",\"project\":\"%s.%s\"", areas[i],
+                    subprojects[bench_skewed(NSUBPROJECTS)]);
+        } else {
+            fprintf(out, ",\"project\":\"%s\"", areas[i]);
+        }
+    }
+
+    if (bench_random(20) == 0) {
+        fputs(",\"start\":\"20240301T090000Z\"", out);
+    }
+
+    fputs(",\"status\":\"pending\"", out);
+
+    /* most tasks have no tags, few have several */
+    ntags = bench_random(10);
+    ntags = ntags < 4 ? 0 : ntags < 7 ? 1 : ntags < 9 ? 2 : 3;
+
+    for (i = 0; i < ntags; i++) {
+        fprintf(out, "%s\"%s\"", i == 0 ? ",\"tags\":[" : ",", tagnames[bench_skewed(NTAGNAMES)]);
+    }
+
+    fputs(ntags > 0 ? "]" : "", out);
+
+    if (bench_random(10) == 0) {
+        fputs(",\"annotations\":[{\"entry\":\"20240105T100000Z\",\"description\":\"see the notes [1]\"}]",
+              out);
+    }
+
+    fprintf(out, ",\"uuid\":\"%08x-%04x-4%03x-a%03x-%06x%06x\",\"urgency\":%d.%d}",
+            bench_random(1 << 30), bench_random(1 << 16), bench_random(1 << 12),
+            bench_random(1 << 12), bench_random(1 << 24), bench_random(1 << 24),
+            bench_random(15), bench_random(10));
+} /* }}} */
+
+#else
+void bench(const char* args) { /* {{{ */
+    strcmp(args, "all");
+    puts("benchmarks not included at compile time");
+} /* }}} */
+#endif
+
+// vim: et ts=4 sw=4 sts=4
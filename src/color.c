@@ -12,6 +12,7 @@
 #include <string.h>
 #include "color.h"
 #include "common.h"
+#include "config.h"
 #include "log.h"
 #include "tasks.h"
 
@@ -27,26 +28,87 @@ struct color {
     short bg;
 };
 
+/* conditions a color rule can test */
+enum rule_op {
+    RULE_SELECTED,
+    RULE_STARTED,
+    RULE_MARKED,
+    RULE_PROJECT,
+    RULE_DESCRIPTION,
+    RULE_TAGS,
+    RULE_PRIORITY
+};
+
+/**
+ * rule predicate structure - one compiled condition of a color rule
+ * op      - the condition tested
+ * invert  - whether the condition must be false instead of true
+ * pattern - the regular expression of the condition, if it has one
+ * regex   - the compiled pattern, pinned in the regex cache
+ */
+struct rule_predicate {
+    enum rule_op op;
+    bool invert;
+    char* pattern;
+    const regex_t* regex;
+};
+
 /**
  * color rule structure
- * pair   - the color pair number to be passed to COLOR_PAIR
- * rule   - the string containing the rule to be evaluated
- * object - the type of item that is being colored
- * next   - the next color_rule struct
+ * pair        - the color pair number to be passed to COLOR_PAIR
+ * rule        - the string containing the rule to be evaluated
+ * predicates  - the conditions in the rule, all of which must hold
+ * npredicates - the number of predicates
+ * malformed   - whether the rule could not be parsed (it never matches)
+ * object      - the type of item that is being colored
+ * next        - the next color_rule struct
  */
 struct color_rule {
     short pair;
     char* rule;
+    struct rule_predicate* predicates;
+    int npredicates;
+    bool malformed;
     enum color_object object;
     struct color_rule* next;
 };
 
+/**
+ * color memo entry - the color of every task sharing a signature
+ * the signature is everything the task rules look at, unless a rule tests
+ * descriptions, in which case the memo is not used
+ * hash     - the hash of the signature
+ * project  - the symbol id of the project of the signature
+ * tags     - the symbol ids of the tags of the signature
+ * ntags    - the number of tags
+ * priority - the priority of the signature
+ * flags    - whether the task is started, selected and marked
+ * pair     - the color pair of this signature
+ */
+struct color_memo {
+    unsigned int hash;
+    unsigned int project;
+    unsigned int* tags;
+    unsigned short ntags;
+    char priority;
+    char flags;
+    short pair;
+};
+
 /* global variables */
 bool use_colors;
 bool colors_initialized = false;
 bool* pairs_used = NULL;
 struct color_rule* color_rules = NULL;
 
+/* color caches are valid only while this matches, it changes with the rules */
+static unsigned int rules_generation = 1;
+
+/* memo of rule outcomes, keyed by task signature */
+static struct color_memo* color_memo = NULL;
+static int color_memo_length = 0;
+static bool color_memo_usable = true;
+
 /* local functions */
 static short add_color_pair(const short askpair,
                             const short fg,
@@ -54,13 +116,23 @@ static short add_color_pair(const short askpair,
 
 int check_color(int color);
 
-static bool eval_rules(char* rule,
-                       const struct task*,
-                       const bool selected);
+static void compile_rule(struct color_rule* this);
+
+static bool eval_rule(const struct color_rule* rule,
+                      const struct task* tsk,
+                      const bool selected);
 
 static short find_add_pair(const short fg,
                            const short bg);
 
+static void free_color_memo(void);
+
+static short memo_task_color(const struct task* tsk, const bool selected);
+
+static unsigned int memo_hash(const struct task* tsk, const char flags);
+
+static short task_color(const struct task* tsk, const bool selected);
+
 static int set_default_colors(void);
 
 short add_color_pair(short askpair, short fg, short bg) { /* {{{ */
@@ -121,18 +193,11 @@ short add_color_rule(const enum color_object object,
     struct color_rule*  last;
     struct color_rule*  this;
     short               ret;
-    struct task*        tsk;
+    int                 i;
 
-    /* reset color caches if past configuration */
-    if (tasklist != NULL) {
-        tsk = head;
-
-        while (tsk != NULL) {
-            tsk->selpair = -1;
-            tsk->pair = -1;
-            tsk = tsk->next;
-        }
-    }
+    /* invalidate every cached task color */
+    rules_generation++;
+    free_color_memo();
 
     /* look for existing rule and overwrite colors */
     this = color_rules;
@@ -171,6 +236,8 @@ short add_color_rule(const enum color_object object,
         this->rule = NULL;
     }
 
+    compile_rule(this);
+
     this->object = object;
     this->next = NULL;
 
@@ -180,6 +247,13 @@ short add_color_rule(const enum color_object object,
         color_rules = this;
     }
 
+    /* the memo key does not include descriptions */
+    for (i = 0; i < this->npredicates; i++) {
+        if (object == OBJECT_TASK && this->predicates[i].op == RULE_DESCRIPTION) {
+            color_memo_usable = false;
+        }
+    }
+
     return 0;
 } /* }}} */
 
@@ -195,128 +269,144 @@ int check_color(int color) { /* {{{ */
     }
 } /* }}} */
 
-bool eval_rules(char* rule, const struct task* tsk, const bool selected) { /* {{{ */
+void compile_rule(struct color_rule* this) { /* {{{ */
     /**
-     * evaluate a rule set for a task
-     * rule     - the rule to be evaluated
-     * tsk      - the task the rule will be evaluated on
-     * selected - whether the task is selected
+     * parse a rule string into predicates, which are evaluated by eval_rule
+     * rules are a series of ~<pattern> [<'regex'>] conditions, an uppercase
+     * pattern inverting its condition
+     * this - the rule to compile
      */
-    char*   regex = NULL;
-    char    pattern;
-    char*   tmp;
-    int     ret;
-    int     move;
-    bool    go = false;
-    bool    invert = false;
-
-    /* success if rules are done */
-    if (rule == NULL || *rule == 0) {
-        return true;
-    }
+    struct rule_predicate*  pred;
+    const char*             rule = this->rule;
+    char*                   regex;
+    char                    pattern;
+    int                     ret;
+    bool                    invert;
+
+    this->predicates  = NULL;
+    this->npredicates = 0;
+    this->malformed   = false;
+
+    while (rule != NULL && *rule != 0) {
+        /* skip non-patterns */
+        if (*rule != '~') {
+            rule++;
+            continue;
+        }
 
-    /* skip non-patterns */
-    if (*rule != '~') {
-        return eval_rules(rule + 1, tsk, selected);
-    }
+        regex  = NULL;
+        invert = false;
+        ret    = sscanf(rule, "~%c '%m[^\']'", &pattern, &regex);
 
-    /* regex match */
-    ret = sscanf(rule, "~%c '%m[^\']'", &pattern, &regex);
+        if (ret > 0 && pattern >= 'A' && pattern <= 'Z') {
+            pattern += 32;
+            invert = true;
+        }
 
-    if (ret > 0 && pattern >= 'A' && pattern <= 'Z') {
-        pattern += 32;
-        invert = true;
-    }
+        this->predicates = realloc(this->predicates,
+                                   (this->npredicates + 1) * sizeof(struct rule_predicate));
+        pred = this->predicates + this->npredicates;
+        pred->invert  = invert;
+        pred->pattern = NULL;
+        pred->regex   = NULL;
+
+        if (ret == 1 && strchr("stm", pattern) != NULL) {
+            pred->op = pattern == 's' ? RULE_SELECTED :
+                       pattern == 't' ? RULE_STARTED : RULE_MARKED;
+            rule += 2;
+        } else if (ret == 2 && strchr("pdtr", pattern) != NULL) {
+            switch (pattern) {
+            case 'p':
+                pred->op = RULE_PROJECT;
+                break;
 
-    if (ret == 1) {
-        switch (pattern) {
-        case 's':
-            if (!XOR(invert, selected)) {
-                return false;
-            } else {
-                return eval_rules(rule + 2, tsk, selected);
-            }
+            case 'd':
+                pred->op = RULE_DESCRIPTION;
+                break;
 
-            break;
+            case 't':
+                pred->op = RULE_TAGS;
+                break;
 
-        case 't':
-            if (!XOR(invert, tsk->start > 0)) {
-                return false;
-            } else {
-                return eval_rules(rule + 2, tsk, selected);
+            default:
+                pred->op = RULE_PRIORITY;
+                break;
             }
 
-            break;
-
-        default:
-            break;
+            pred->pattern = regex;
+            pred->regex   = regex_pin(regex, REGEX_OPTS);
+            rule += strlen(regex) + 3;
+        } else {
+            tnc_fprintf(logfp, LOG_ERROR, "malformed rules - \"%s\"", rule);
+            check_free(regex);
+            this->malformed = true;
+            return;
         }
+
+        this->npredicates++;
     }
+} /* }}} */
 
-    if (ret == 2) {
-        move = strlen(regex) + 3;
-        go = true;
-
-        switch (pattern) {
-        case 'p':
-            if (!XOR(invert, match_string(tsk->project, regex))) {
-                return false;
-            } else {
-                tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "eval_rules: project match - '%s' '%s'",
-                            tsk->project, regex);
-            }
+bool eval_rule(const struct color_rule* rule,
+               const struct task* tsk,
+               const bool selected) { /* {{{ */
+    /**
+     * evaluate a compiled rule for a task
+     * rule     - the rule to be evaluated
+     * tsk      - the task the rule will be evaluated on
+     * selected - whether the task is selected
+     * return is whether every predicate of the rule holds
+     */
+    const struct rule_predicate*    pred;
+    char                            priority[2] = {0, 0};
+    bool                            match;
+    int                             i;
 
-            break;
+    if (rule->malformed) {
+        return false;
+    }
 
-        case 'd':
-            if (!XOR(invert, match_string(tsk->description, regex))) {
-                return false;
-            } else {
-                tnc_fprintf(logfp, LOG_DEBUG_VERBOSE,
-                            "eval_rules: description match - '%s' '%s'", tsk->description, regex);
-            }
+    for (i = 0; i < rule->npredicates; i++) {
+        pred = rule->predicates + i;
 
+        switch (pred->op) {
+        case RULE_SELECTED:
+            match = selected;
             break;
 
-        case 't':
-            if (!XOR(invert, match_string(tsk->tags, regex))) {
-                return false;
-            } else {
-                tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "eval_rules: tag match - '%s' '%s'",
-                            tsk->tags, regex);
-            }
+        case RULE_STARTED:
+            match = tsk->start > 0;
+            break;
 
+        case RULE_MARKED:
+            match = tsk->marked;
             break;
 
-        case 'r':
-            tmp = calloc(2, sizeof(char));
-            *tmp = tsk->priority;
+        case RULE_PROJECT:
+            match = match_regex(tsk->project, pred->regex);
+            break;
 
-            if (!XOR(invert, match_string(tmp, regex))) {
-                return false;
-            } else {
-                tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "eval_rules: priority match - '%s' '%s'",
-                            tmp, regex);
-            }
+        case RULE_DESCRIPTION:
+            match = match_regex(tsk->detail->description, pred->regex);
+            break;
 
-            free(tmp);
+        case RULE_TAGS:
+            match = match_regex(tsk->detail->tags, pred->regex);
             break;
 
+        case RULE_PRIORITY:
         default:
-            go = false;
+            priority[0] = tsk->priority;
+            match = match_regex(priority, pred->regex);
             break;
         }
 
-        free(regex);
-
-        if (go) {
-            return eval_rules(rule + move, tsk, selected);
+        if (!XOR(pred->invert, match)) {
+            return false;
         }
     }
 
-    /* should never get here */
-    tnc_fprintf(logfp, LOG_ERROR, "malformed rules - \"%s\"", rule);
-    return false;
+    return true;
 } /* }}} */
 
 short find_add_pair(const short fg, const short bg) { /* {{{ */
@@ -352,10 +442,24 @@ short find_add_pair(const short fg, const short bg) { /* {{{ */
     return add_color_pair(free_pair, fg, bg);
 } /* }}} */
 
+void free_color_memo(void) { /* {{{ */
+    /* empty the memo of rule outcomes */
+    int i;
+
+    for (i = 0; color_memo != NULL && i < COLORMEMOLENGTH; i++) {
+        check_free(color_memo[i].tags);
+    }
+
+    check_free(color_memo);
+    color_memo = NULL;
+    color_memo_length = 0;
+} /* }}} */
+
 void free_colors(void) { /* {{{ */
     /* clean up memory allocated for colors */
     struct color_rule* this;
     struct color_rule* last;
+    int                i;
 
     check_free(pairs_used);
 
@@ -364,9 +468,18 @@ void free_colors(void) { /* {{{ */
     while (this != NULL) {
         last = this;
         this = this->next;
+
+        for (i = 0; i < last->npredicates; i++) {
+            regex_unpin(last->predicates[i].pattern, REGEX_OPTS);
+            check_free(last->predicates[i].pattern);
+        }
+
+        check_free(last->predicates);
         check_free(last->rule);
         free(last);
     }
+
+    free_color_memo();
 } /* }}} */
 
 int get_colors(const enum color_object object,
@@ -374,66 +487,42 @@ int get_colors(const enum color_object object,
                const bool selected) { /* {{{ */
     /**
      * evaluate color rules and return an argument to attrset
+     * task colors are cached on the task, and the cache is valid while the
+     * rules generation and the task's data generation are unchanged
      * object   - the object to be colored
      * tsk      - the task to be colored
      * selected - whether the task is selected
      */
-    short               pair = 0;
     int*                tskpair;
     struct color_rule*  rule;
-    bool                done = false;
-
-    /* check for cache if task */
-    if (object == OBJECT_TASK) {
-        if (selected) {
-            tskpair = &(tsk->selpair);
-        } else {
-            tskpair = &(tsk->pair);
-        }
-
-        if (*tskpair >= 0) {
-            return COLOR_PAIR(*tskpair);
-        }
-    }
-
-    /* iterate through rules */
-    rule = color_rules;
-
-    while (rule != NULL) {
-        /* check for matching object */
-        if (object == rule->object) {
-            switch (object) {
-            case OBJECT_ERROR:
-            case OBJECT_HEADER:
-                done = true;
-                break;
-
-            case OBJECT_TASK:
-                if (eval_rules(rule->rule, tsk, selected)) {
-                    pair = rule->pair;
-                }
 
-                break;
-
-            default:
-                break;
+    /* non-task objects use the first rule for their object */
+    if (object != OBJECT_TASK) {
+        for (rule = color_rules; rule != NULL; rule = rule->next) {
+            if (rule->object == object) {
+                return COLOR_PAIR(rule->pair);
             }
         }
 
-        if (done) {
-            pair = rule->pair;
-            break;
-        }
+        return COLOR_PAIR(0);
+    }
 
-        rule = rule->next;
+    /* drop a stale cache */
+    if (tsk->colorgen != rules_generation || tsk->colordatagen != tsk->datagen) {
+        tsk->colorgen     = rules_generation;
+        tsk->colordatagen = tsk->datagen;
+        tsk->pair         = -1;
+        tsk->selpair      = -1;
     }
 
-    /* assign cached color if task object */
-    if (object == OBJECT_TASK) {
-        *tskpair = (int)pair;
+    tskpair = selected ? &(tsk->selpair) : &(tsk->pair);
+
+    if (*tskpair < 0) {
+        *tskpair = color_memo_usable ? memo_task_color(tsk, selected) :
+                   task_color(tsk, selected);
     }
 
-    return COLOR_PAIR(pair);
+    return COLOR_PAIR(*tskpair);
 } /* }}} */
 
 int init_colors(void) { /* {{{ */
@@ -470,6 +559,81 @@ int init_colors(void) { /* {{{ */
     }
 } /* }}} */
 
+short memo_task_color(const struct task* tsk, const bool selected) { /* {{{ */
+    /**
+     * look up the color of a task in the memo of rule outcomes
+     * evaluating the rules only for the first task with its signature
+     * tsk      - the task to be colored
+     * selected - whether the task is selected
+     */
+    struct color_memo*  memo;
+    char                flags = (tsk->start > 0) | (selected << 1) | (tsk->marked << 2);
+    unsigned int        hash = memo_hash(tsk, flags);
+    unsigned int        slot;
+
+    /* start over when the memo fills up */
+    if (color_memo_length >= COLORMEMOLENGTH / 2) {
+        free_color_memo();
+    }
+
+    if (color_memo == NULL) {
+        color_memo = calloc(COLORMEMOLENGTH, sizeof(struct color_memo));
+    }
+
+    /* probe for the signature */
+    for (slot = hash & (COLORMEMOLENGTH - 1); color_memo[slot].pair != 0;
+            slot = (slot + 1) & (COLORMEMOLENGTH - 1)) {
+        memo = color_memo + slot;
+
+        if (memo->hash == hash && memo->flags == flags && memo->priority == tsk->priority &&
+                memo->project == tsk->projectid && memo->ntags == tsk->ntags &&
+                (tsk->ntags == 0 ||
+                 memcmp(memo->tags, tsk->tagids, tsk->ntags * sizeof(unsigned int)) == 0)) {
+            return memo->pair - 1;
+        }
+    }
+
+    /* evaluate and remember, storing pair + 1 so 0 marks an empty slot */
+    memo           = color_memo + slot;
+    memo->hash     = hash;
+    memo->project  = tsk->projectid;
+    memo->tags     = NULL;
+    memo->ntags    = 0;
+
+    if (tsk->ntags > 0) {
+        memo->tags = malloc(tsk->ntags * sizeof(unsigned int));
+
+        if (memo->tags != NULL) {
+            memcpy(memo->tags, tsk->tagids, tsk->ntags * sizeof(unsigned int));
+            memo->ntags = tsk->ntags;
+        }
+    }
+
+    memo->priority = tsk->priority;
+    memo->flags    = flags;
+    memo->pair     = task_color(tsk, selected) + 1;
+    color_memo_length++;
+
+    return memo->pair - 1;
+} /* }}} */
+
+unsigned int memo_hash(const struct task* tsk, const char flags) { /* {{{ */
+    /* fnv-1a hash of a task's color signature */
+    unsigned int    h = 2166136261u;
+    unsigned short  i;
+
+    h = (h ^ tsk->projectid) * 16777619u;
+
+    for (i = 0; i < tsk->ntags; i++) {
+        h = (h ^ tsk->tagids[i]) * 16777619u;
+    }
+
+    h = (h ^ (unsigned char)tsk->priority) * 16777619u;
+    h = (h ^ (unsigned char)flags) * 16777619u;
+
+    return h;
+} /* }}} */
+
 int parse_color(const char* name) { /* {{{ */
     /* parse a color from a string */
     unsigned int    i;
@@ -541,10 +705,31 @@ enum color_object parse_object(const char* name) { /* {{{ */
     return OBJECT_NONE;
 } /* }}} */
 
+short task_color(const struct task* tsk, const bool selected) { /* {{{ */
+    /**
+     * evaluate the task color rules for a task
+     * the last matching rule wins
+     * tsk      - the task to be colored
+     * selected - whether the task is selected
+     * return is the color pair of the task
+     */
+    short               pair = 0;
+    struct color_rule*  rule;
+
+    for (rule = color_rules; rule != NULL; rule = rule->next) {
+        if (rule->object == OBJECT_TASK && eval_rule(rule, tsk, selected)) {
+            pair = rule->pair;
+        }
+    }
+
+    return pair;
+} /* }}} */
+
 int set_default_colors(void) { /* {{{ */
     /* create initial color rules */
     add_color_rule(OBJECT_HEADER, NULL, COLOR_BLUE, COLOR_BLACK);
     add_color_rule(OBJECT_TASK, NULL, -1, -1);
+    add_color_rule(OBJECT_TASK, "~m", COLOR_YELLOW, -1);
     add_color_rule(OBJECT_TASK, "~s", COLOR_CYAN, COLOR_BLACK);
     add_color_rule(OBJECT_ERROR, NULL, COLOR_RED, -1);
 
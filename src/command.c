@@ -17,6 +17,7 @@
 #include "config.h"
 #include "keys.h"
 #include "log.h"
+#include "process.h"
 #include "statusbar.h"
 #include "tasknc.h"
 
@@ -102,10 +103,10 @@ void handle_command(char* cmdstr) { /* {{{ */
         int             counter = 0;
 
         while (this != NULL) {
-            tnc_fprintf(logfp, 0, "uuid: %s", this->uuid);
-            tnc_fprintf(logfp, 0, "description: %s", this->description);
+            tnc_fprintf(logfp, 0, "uuid: %s", this->detail->uuid);
+            tnc_fprintf(logfp, 0, "description: %s", this->detail->description);
             tnc_fprintf(logfp, 0, "project: %s", this->project);
-            tnc_fprintf(logfp, 0, "tags: %s", this->tags);
+            tnc_fprintf(logfp, 0, "tags: %s", this->detail->tags);
             this = this->next;
             counter++;
         }
@@ -135,8 +136,10 @@ void run_command_bind(char* args) { /* {{{ */
     /**
      * create a new keybind
      * syntax - mode key function [funcarg]
+     * key may be a sequence of keys separated by commas
      */
-    int             key;
+    int             keys[KEYSEQUENCELENGTH];
+    int             nkeys;
     int             ret = 0;
     char*           function  = NULL;
     char*           arg       = NULL;
@@ -170,8 +173,17 @@ void run_command_bind(char* args) { /* {{{ */
         goto cleanup;
     }
 
-    /* parse key */
-    key = parse_key(keystr);
+    /* parse keys */
+    nkeys = parse_keys(keystr, keys);
+
+    if (nkeys == 0) {
+        statusbar_message(cfg.statusbar_timeout, "bind: no key specified");
+        goto cleanup;
+    } else if (nkeys < 0) {
+        statusbar_message(cfg.statusbar_timeout, "bind: at most %d keys can be bound",
+                          KEYSEQUENCELENGTH);
+        goto cleanup;
+    }
 
     /* map function to function call */
     fmap = find_function(function, mode);
@@ -191,10 +203,10 @@ void run_command_bind(char* args) { /* {{{ */
     }
 
     /* add keybind */
-    add_keybind(key, func, arg, mode);
-    keyname = name_key(key);
+    add_keybind_sequence(keys, nkeys, func, arg, mode);
+    keyname = name_keys(keys, nkeys);
     statusbar_message(cfg.statusbar_timeout, "key %s (%d) bound to %s - %s",
-                      keyname, key, modestr, name_function(func));
+                      keyname, keys[0], modestr, name_function(func));
     goto cleanup;
 
 cleanup:
@@ -303,11 +315,21 @@ void run_command_unbind(char* argstr) { /* {{{ */
         mode = MODE_ANY;
     }
 
-    int key = parse_key(keystr);
+    int keys[KEYSEQUENCELENGTH];
+    int nkeys = parse_keys(keystr, keys);
+
+    if (nkeys == 0) {
+        statusbar_message(cfg.statusbar_timeout, "syntax: unbind <mode> <key>");
+        goto cleanup;
+    } else if (nkeys < 0) {
+        statusbar_message(cfg.statusbar_timeout, "unbind: at most %d keys can be bound",
+                          KEYSEQUENCELENGTH);
+        goto cleanup;
+    }
 
-    remove_keybinds(key, mode);
-    keyname = name_key(key);
-    statusbar_message(cfg.statusbar_timeout, "key unbound: %s (%d)", keyname, key);
+    remove_keybinds(keys, nkeys, mode);
+    keyname = name_keys(keys, nkeys);
+    statusbar_message(cfg.statusbar_timeout, "key unbound: %s (%d)", keyname, keys[0]);
     goto cleanup;
 
 cleanup:
@@ -475,7 +497,7 @@ void run_command_source(const char* filepath) { /* {{{ */
 
 void run_command_source_cmd(const char* cmdstr) { /* {{{ */
     /* run commands generated by a command */
-    FILE* cmd = popen(cmdstr, "r");
+    FILE* cmd = process_open(cmdstr);
 
     tnc_fprintf(logfp, LOG_DEBUG, "source: command \"%s\"", cmdstr);
 
@@ -501,7 +523,7 @@ void run_command_source_cmd(const char* cmdstr) { /* {{{ */
     redraw = true;
 
     /* close config file */
-    pclose(cmd);
+    process_close(cmd);
     tnc_fprintf(logfp, LOG_DEBUG, "source complete: \"%s\"", cmdstr);
     statusbar_message(cfg.statusbar_timeout, "source complete: \"%s\"", cmdstr);
 } /* }}} */
@@ -10,81 +10,416 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include "common.h"
 #include "config.h"
+#include "log.h"
+#include "metrics.h"
+
+/**
+ * regex cache entry - a compiled pattern kept for reuse
+ * pattern - the pattern string
+ * flags   - the flags the pattern was compiled with
+ * regex   - the compiled pattern
+ * valid   - whether the pattern compiled
+ * pins    - the number of users keeping the pattern in the cache
+ * used    - when the pattern was last used, for lru eviction
+ */
+struct regex_entry {
+    char* pattern;
+    int flags;
+    regex_t regex;
+    bool valid;
+    int pins;
+    unsigned long used;
+};
+
+/**
+ * regex cache - compiled patterns, which are individually allocated so
+ * that pointers to them stay valid as the cache grows
+ * entries - the cached patterns
+ * length  - the number of cached patterns
+ * size    - the number of patterns that fit in entries
+ * clock   - counter used to time stamp pattern use
+ */
+static struct {
+    struct regex_entry** entries;
+    int length;
+    int size;
+    unsigned long clock;
+} regex_cache = {NULL, 0, 0, 0};
+
+/* taskwarrior data files, relative to the data location */
+const char* data_files[DATAFILES] = {
+    "pending.data",
+    "completed.data",
+    "taskchampion.sqlite3"
+};
 
 /* externs */
 extern int selline;
 
+/* local functions */
+static void free_regex_entry(struct regex_entry* entry);
+static struct regex_entry* regex_lookup(const char* pattern, const int flags);
+
+char* data_location(void) { /* {{{ */
+    /* find the directory taskwarrior keeps its data files in
+     * this is TASKDATA, data.location from the taskrc, or ~/.task
+     * return is the malloc'd path
+     */
+    FILE*   fp;
+    char*   rcpath;
+    char*   line = NULL;
+    char*   pos;
+    char*   value = NULL;
+    char*   ret;
+    size_t  size = 0;
+    ssize_t len;
+    const char* home = getenv("HOME");
+
+    if (home == NULL) {
+        home = "";
+    }
+
+    if (getenv("TASKDATA") != NULL) {
+        return strdup(getenv("TASKDATA"));
+    }
+
+    /* look for data.location in the taskrc */
+    if (getenv("TASKRC") != NULL) {
+        rcpath = strdup(getenv("TASKRC"));
+    } else {
+        asprintf(&rcpath, "%s/.taskrc", home);
+    }
+
+    fp = fopen(rcpath, "r");
+    free(rcpath);
+
+    while (fp != NULL && (len = getline(&line, &size, fp)) >= 0) {
+        if (len > 0 && line[len - 1] == '\n') {
+            line[len - 1] = 0;
+        }
+
+        for (pos = line; *pos == ' ' || *pos == '\t'; pos++);
+
+        if (!str_starts_with(pos, "data.location")) {
+            continue;
+        }
+
+        for (pos += strlen("data.location"); *pos == ' ' || *pos == '\t'; pos++);
+
+        if (*pos != '=') {
+            continue;
+        }
+
+        /* trim the value */
+        for (pos++; *pos == ' ' || *pos == '\t'; pos++);
+
+        for (len = strlen(pos); len > 0 && strchr(" \t\r", pos[len - 1]) != NULL; len--) {
+            pos[len - 1] = 0;
+        }
+
+        free(value);
+        value = strdup(pos);
+    }
+
+    free(line);
+
+    if (fp != NULL) {
+        fclose(fp);
+    }
+
+    /* expand a leading ~ */
+    if (value == NULL) {
+        asprintf(&ret, "%s/.task", home);
+    } else if (value[0] == '~') {
+        asprintf(&ret, "%s%s", home, value + 1);
+        free(value);
+    } else {
+        ret = value;
+    }
+
+    return ret;
+} /* }}} */
+
+void free_regex_cache(void) { /* {{{ */
+    /* release every compiled pattern in the regex cache */
+    int i;
+
+    for (i = 0; i < regex_cache.length; i++) {
+        free_regex_entry(regex_cache.entries[i]);
+    }
+
+    check_free(regex_cache.entries);
+    regex_cache.entries = NULL;
+    regex_cache.length  = 0;
+    regex_cache.size    = 0;
+} /* }}} */
+
+void free_regex_entry(struct regex_entry* entry) { /* {{{ */
+    /* free a regex cache entry and its compiled pattern */
+    if (entry->valid) {
+        regfree(&(entry->regex));
+    }
+
+    free(entry->pattern);
+    free(entry);
+} /* }}} */
+
+int hex_value(const char c) { /* {{{ */
+    /* convert a hex digit to its value, or -1 if it is not a hex digit */
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+
+    return -1;
+} /* }}} */
+
+bool match_regex(const char* haystack, const regex_t* regex) { /* {{{ */
+    /* check whether a compiled regex matches a haystack
+     * haystack - the string to search (may be NULL)
+     * regex    - the compiled pattern (may be NULL)
+     */
+    if (haystack == NULL || regex == NULL) {
+        return false;
+    }
+
+    return regexec(regex, haystack, 0, 0, 0) != REG_NOMATCH;
+} /* }}} */
+
 bool match_string(const char* haystack, const char* needle) { /* {{{ */
     /* find the regex needle in a haystack */
-    regex_t regex;
-    bool    ret;
 
     /* check for NULL haystack or needle */
     if (haystack == NULL || needle == NULL) {
         return false;
     }
 
-    /* compile regex */
-    if (regcomp(&regex, needle, REGEX_OPTS) != 0) {
-        return false;
+    return match_regex(haystack, regex_get(needle, REGEX_OPTS));
+} /* }}} */
+
+long now_ms(void) { /* {{{ */
+    /* read the monotonic clock in ms */
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+} /* }}} */
+
+const regex_t* regex_get(const char* pattern, const int flags) { /* {{{ */
+    /**
+     * get a compiled pattern from the regex cache, compiling it on a miss
+     * the pattern stays valid until the next regex_get call, or until it is
+     * unpinned if it has been pinned
+     * pattern - the pattern string
+     * flags   - the flags to compile the pattern with
+     * return is the compiled pattern, or NULL if it does not compile
+     */
+    struct regex_entry* entry = regex_lookup(pattern, flags);
+
+    if (entry == NULL || !entry->valid) {
+        return NULL;
     }
 
-    /* run regex */
-    if (regexec(&regex, haystack, 0, 0, 0) != REG_NOMATCH) {
-        ret = true;
-    } else {
-        ret = false;
+    return &(entry->regex);
+} /* }}} */
+
+struct regex_entry* regex_lookup(const char* pattern, const int flags) { /* {{{ */
+    /**
+     * find or add the cache entry of a pattern
+     * when the cache is full, the least recently used unpinned entry is
+     * replaced, and the cache only grows if every entry is pinned
+     * pattern - the pattern string
+     * flags   - the flags to compile the pattern with
+     * return is the entry, or NULL on allocation failure
+     */
+    struct regex_entry*     entry;
+    struct regex_entry**    tmp;
+    int                     i;
+    int                     victim = -1;
+
+    if (pattern == NULL) {
+        return NULL;
     }
 
-    regfree(&regex);
-    return ret;
+    regex_cache.clock++;
+
+    /* look for a cached pattern */
+    for (i = 0; i < regex_cache.length; i++) {
+        entry = regex_cache.entries[i];
+
+        if (entry->flags == flags && str_eq(entry->pattern, pattern)) {
+            entry->used = regex_cache.clock;
+            return entry;
+        }
+
+        if (entry->pins == 0 &&
+                (victim < 0 || entry->used < regex_cache.entries[victim]->used)) {
+            victim = i;
+        }
+    }
+
+    /* compile the new pattern */
+    entry = calloc(1, sizeof(struct regex_entry));
+
+    if (entry == NULL) {
+        return NULL;
+    }
+
+    entry->pattern = strdup(pattern);
+    entry->flags   = flags;
+    entry->valid   = regcomp(&(entry->regex), pattern, flags) == 0;
+    metrics_count(COUNTER_REGEX);
+    entry->used    = regex_cache.clock;
+
+    /* evict the least recently used pattern, or grow the cache */
+    if (regex_cache.length == regex_cache.size && victim >= 0 &&
+            regex_cache.size >= REGEXCACHELENGTH) {
+        free_regex_entry(regex_cache.entries[victim]);
+        regex_cache.entries[victim] = entry;
+        return entry;
+    }
+
+    if (regex_cache.length == regex_cache.size) {
+        regex_cache.size = regex_cache.size > 0 ? 2 * regex_cache.size : REGEXCACHELENGTH;
+        tmp = realloc(regex_cache.entries, regex_cache.size * sizeof(struct regex_entry*));
+
+        if (tmp == NULL) {
+            free_regex_entry(entry);
+            return NULL;
+        }
+
+        regex_cache.entries = tmp;
+    }
+
+    regex_cache.entries[regex_cache.length++] = entry;
+
+    return entry;
+} /* }}} */
+
+const regex_t* regex_pin(const char* pattern, const int flags) { /* {{{ */
+    /**
+     * get a compiled pattern and keep it in the regex cache until unpinned
+     * every call must be matched by a call to regex_unpin
+     * pattern - the pattern string
+     * flags   - the flags to compile the pattern with
+     * return is the compiled pattern, or NULL if it does not compile
+     */
+    struct regex_entry* entry = regex_lookup(pattern, flags);
+
+    if (entry == NULL) {
+        return NULL;
+    }
+
+    entry->pins++;
+
+    return entry->valid ? &(entry->regex) : NULL;
+} /* }}} */
+
+void regex_unpin(const char* pattern, const int flags) { /* {{{ */
+    /**
+     * release a pin on a pattern, allowing it to be evicted from the cache
+     * pattern - the pattern string
+     * flags   - the flags the pattern was pinned with
+     */
+    int i;
+
+    if (pattern == NULL) {
+        return;
+    }
+
+    for (i = 0; i < regex_cache.length; i++) {
+        if (regex_cache.entries[i]->flags == flags &&
+                str_eq(regex_cache.entries[i]->pattern, pattern)) {
+            if (regex_cache.entries[i]->pins > 0) {
+                regex_cache.entries[i]->pins--;
+            }
+
+            return;
+        }
+    }
+} /* }}} */
+
+int thread_count(void) { /* {{{ */
+    /**
+     * get the number of threads large loads are parsed and sorted with
+     * return is the threads variable, or the number of processors if it
+     * is 0, at most MAXTHREADS
+     */
+    long n = cfg.threads > 0 ? cfg.threads : sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (n < 1) {
+        return 1;
+    }
+
+    return n < MAXTHREADS ? (int)n : MAXTHREADS;
 } /* }}} */
 
 char* utc_date(const time_t timeint) { /* {{{ */
-    /* convert a utc time uint to a string */
-    struct tm*  tmr;
-    struct tm*  now;
+    /* convert a utc time uint to a string, which the caller frees */
+    char* timestr = malloc(TIMELENGTH * sizeof(char));
+
+    return timestr != NULL ? utc_date_r(timeint, timestr) : NULL;
+} /* }}} */
+
+char* utc_date_r(const time_t timeint, char* timestr) { /* {{{ */
+    /**
+     * write the date of a utc time uint to a string
+     * dates of another year than the current one include the year
+     * timeint - the time, or 0 for now
+     * timestr - where the date is written, TIMELENGTH bytes
+     * return is timestr
+     */
+    struct tm   tmr;
+    struct tm   now;
     time_t      cur;
-    char*       timestr;
 
     /* get current time */
     time(&cur);
-    now = localtime(&cur);
+    localtime_r(&cur, &now);
 
     /* set time to either now or the specified time */
-    tmr = timeint == 0  ?  now : localtime(&timeint);
-
-    /* convert thte time to a formatted string */
-    timestr = malloc(TIMELENGTH * sizeof(char));
+    if (timeint == 0) {
+        tmr = now;
+    } else {
+        localtime_r(&timeint, &tmr);
+    }
 
-    if (now->tm_year != tmr->tm_year) {
-        strftime(timestr, TIMELENGTH, "%F", tmr);
+    if (now.tm_year != tmr.tm_year) {
+        strftime(timestr, TIMELENGTH, "%F", &tmr);
     } else {
-        strftime(timestr, TIMELENGTH, "%b %d", tmr);
+        strftime(timestr, TIMELENGTH, "%b %d", &tmr);
     }
 
     return timestr;
 } /* }}} */
 
 char* utc_time(const time_t timeint) { /* {{{ */
-    /* convert a utc time uint to a string */
-    struct tm*  tmr;
-    struct tm*  now;
-    time_t      cur;
-    char*       timestr;
+    /* convert a utc time uint to a string, which the caller frees */
+    char* timestr = malloc(TIMELENGTH * sizeof(char));
 
-    /* get current time */
-    time(&cur);
-    now = localtime(&cur);
+    return timestr != NULL ? utc_time_r(timeint, timestr) : NULL;
+} /* }}} */
 
-    /* set time to either now or the specified time */
-    tmr = timeint == 0  ?  now : localtime(&timeint);
+char* utc_time_r(const time_t timeint, char* timestr) { /* {{{ */
+    /**
+     * write the time of day of a utc time uint to a string
+     * timeint - the time, or 0 for now
+     * timestr - where the time is written, TIMELENGTH bytes
+     * return is timestr
+     */
+    struct tm   tmr;
+    const time_t cur = timeint == 0 ? time(NULL) : timeint;
 
-    /* convert thte time to a formatted string */
-    timestr = malloc(TIMELENGTH * sizeof(char));
-    strftime(timestr, TIMELENGTH, "%H:%M", tmr);
+    localtime_r(&cur, &tmr);
+    strftime(timestr, TIMELENGTH, "%H:%M", &tmr);
 
     return timestr;
 } /* }}} */
@@ -0,0 +1,349 @@
+/*
+ * filter.c - evaluation of simple filters on the loaded task list
+ * for tasknc
+ * by mjheagle
+ */
+
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <regex.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "filter.h"
+#include "intern.h"
+#include "log.h"
+#include "metrics.h"
+
+/* what a filter term tests */
+enum term_type {
+    TERM_DESCRIPTION,
+    TERM_DESCRIPTION_REGEX,
+    TERM_NOTAG,
+    TERM_PRIORITY,
+    TERM_PROJECT,
+    TERM_TAG
+};
+
+/**
+ * filter term - a condition a task must meet to be shown
+ * type  - what the term tests
+ * value - the value tested for
+ * len   - the length of value
+ * tag   - the symbol id of the tag tested for
+ * regex - the compiled value of a description regex
+ */
+struct filter_term {
+    enum term_type type;
+    char* value;
+    size_t len;
+    unsigned int tag;
+    regex_t regex;
+};
+
+/**
+ * filter view - the terms a filter adds to the filter the task list was
+ * loaded with, which are evaluated on the loaded tasks instead of exporting
+ * filter - the full filter the view applies, NULL if there is no view
+ * terms  - the terms a task must meet
+ * nterms - the number of terms
+ */
+static struct {
+    char* filter;
+    struct filter_term* terms;
+    int nterms;
+} view = {NULL, NULL, 0};
+
+/* local functions */
+static bool abbreviates(const char* name, const size_t len, const char* full);
+static bool has_tag(const struct task* tsk, const unsigned int tag);
+static bool left_match(const char* str, const struct filter_term* term);
+static bool parse_term(const char* word, struct filter_term* term);
+static int split_words(char* str, char*** words);
+static bool term_match(const struct task* tsk, const struct filter_term* term);
+
+bool abbreviates(const char* name, const size_t len, const char* full) { /* {{{ */
+    /**
+     * check whether a name is an attribute name, or an abbreviation of it
+     * which taskwarrior accepts
+     * name - the name to check, which need not be terminated
+     * len  - the length of name
+     * full - the full attribute name
+     */
+    return len >= 3 && len <= strlen(full) && strncmp(name, full, len) == 0;
+} /* }}} */
+
+void filter_clear(void) { /* {{{ */
+    /* remove the filter view, so that every loaded task is shown */
+    int i;
+
+    for (i = 0; i < view.nterms; i++) {
+        if (view.terms[i].type == TERM_DESCRIPTION_REGEX) {
+            regfree(&(view.terms[i].regex));
+        }
+
+        free(view.terms[i].value);
+    }
+
+    free(view.terms);
+    check_free(view.filter);
+    view.filter = NULL;
+    view.terms  = NULL;
+    view.nterms = 0;
+} /* }}} */
+
+bool filter_compile(const char* filter, const char* loaded) { /* {{{ */
+    /**
+     * set the filter view to the terms a filter adds to the filter the task
+     * list was loaded with, so that it applies without exporting the tasks
+     * this is only possible if the filter keeps every word of the loaded
+     * filter, which may not have alternatives, and adds only simple terms
+     * filter - the filter to apply
+     * loaded - the filter the task list was loaded with
+     * return is whether the view was set, otherwise it is cleared
+     */
+    char*   fcopy = strdup(filter);
+    char*   lcopy = strdup(loaded);
+    char**  fwords;
+    char**  lwords;
+    bool*   used;
+    int     nf;
+    int     nl;
+    int     i;
+    int     j;
+    bool    ok = true;
+
+    filter_clear();
+
+    nf = split_words(fcopy, &fwords);
+    nl = split_words(lcopy, &lwords);
+    used = calloc(nf + 1, sizeof(bool));
+    view.terms = calloc(nf + 1, sizeof(struct filter_term));
+
+    /* quoting is undone by the shell, so quoted words do not match as written */
+    for (j = 0; ok && j < nf; j++) {
+        ok = strpbrk(fwords[j], "\"'\\") == NULL;
+    }
+
+    /* every word of the loaded filter must be kept, as terms are joined by
+     * and unless there are alternatives */
+    for (i = 0; ok && i < nl; i++) {
+        if (strcasecmp(lwords[i], "or") == 0 || strcasecmp(lwords[i], "xor") == 0) {
+            ok = false;
+            break;
+        }
+
+        for (j = 0; j < nf && (used[j] || strcmp(fwords[j], lwords[i]) != 0); j++);
+
+        ok = j < nf;
+
+        if (ok) {
+            used[j] = true;
+        }
+    }
+
+    /* the words added must be terms which can be evaluated here */
+    for (j = 0; ok && j < nf; j++) {
+        if (!used[j]) {
+            ok = parse_term(fwords[j], view.terms + view.nterms);
+            view.nterms += ok ? 1 : 0;
+        }
+    }
+
+    if (ok) {
+        view.filter = strdup(filter);
+        tnc_fprintf(logfp, LOG_DEBUG, "filter view: %d terms on top of (%s)",
+                    view.nterms, loaded);
+    } else {
+        filter_clear();
+    }
+
+    free(fwords);
+    free(lwords);
+    free(fcopy);
+    free(lcopy);
+    free(used);
+
+    return ok;
+} /* }}} */
+
+bool filter_match(const struct task* tsk) { /* {{{ */
+    /**
+     * check whether a task is shown by the filter view
+     * tsk - the task to check
+     * return is true for every task if there is no view
+     */
+    int i;
+
+    for (i = 0; i < view.nterms; i++) {
+        if (!term_match(tsk, view.terms + i)) {
+            return false;
+        }
+    }
+
+    return true;
+} /* }}} */
+
+const char* filter_view(void) { /* {{{ */
+    /* get the filter the view applies, NULL if there is no view */
+    return view.filter;
+} /* }}} */
+
+bool has_tag(const struct task* tsk, const unsigned int tag) { /* {{{ */
+    /**
+     * check whether a task has a tag
+     * tsk - the task to check
+     * tag - the symbol id of the tag
+     */
+    unsigned short i;
+
+    for (i = 0; i < tsk->ntags; i++) {
+        if (tsk->tagids[i] == tag) {
+            return true;
+        }
+    }
+
+    return false;
+} /* }}} */
+
+bool left_match(const char* str, const struct filter_term* term) { /* {{{ */
+    /**
+     * match a string attribute as taskwarrior does for name:value
+     * an empty value matches an empty attribute, otherwise the attribute
+     * must start with the value
+     * str  - the attribute of the task (may be NULL)
+     * term - the term holding the value
+     */
+    if (term->len == 0) {
+        return str == NULL || *str == 0;
+    }
+
+    return str != NULL && strncmp(str, term->value, term->len) == 0;
+} /* }}} */
+
+bool parse_term(const char* word, struct filter_term* term) { /* {{{ */
+    /**
+     * parse a filter word into a term which can be evaluated here
+     * word - the word to parse
+     * term - where the term is stored
+     * return is whether the word is such a term
+     */
+    const char* value;
+    const char* dot;
+    const char* pos;
+    size_t      len;
+    size_t      modlen;
+
+    /* tags, virtual tags are upper case and need data which is not loaded */
+    if ((*word == '+' || *word == '-') && word[1] != 0) {
+        for (pos = word + 1; *pos != 0 && (isupper((unsigned char)*pos) || *pos == '_'); pos++);
+
+        if (*pos == 0) {
+            return false;
+        }
+
+        term->type  = *word == '+' ? TERM_TAG : TERM_NOTAG;
+        term->value = strdup(word + 1);
+        term->len   = strlen(term->value);
+        term->tag   = intern(term->value, term->len);
+
+        return true;
+    }
+
+    /* attributes */
+    value = strchr(word, ':');
+
+    if (value == NULL) {
+        return false;
+    }
+
+    len = value - word;
+    value++;
+    dot = memchr(word, '.', len);
+
+    if (dot != NULL) {
+        /* the only modifier supported is contains, or has, on the description */
+        modlen = word + len - dot - 1;
+
+        if (!abbreviates(word, dot - word, "description") || *value == 0 ||
+                !((modlen == 8 && strncmp(dot + 1, "contains", 8) == 0) ||
+                  (modlen == 3 && strncmp(dot + 1, "has", 3) == 0))) {
+            return false;
+        }
+
+        metrics_count(COUNTER_REGEX);
+
+        if (regcomp(&(term->regex), value, REG_EXTENDED | REG_NOSUB) != 0) {
+            return false;
+        }
+
+        term->type = TERM_DESCRIPTION_REGEX;
+    } else if (abbreviates(word, len, "project")) {
+        term->type = TERM_PROJECT;
+    } else if (abbreviates(word, len, "description")) {
+        term->type = TERM_DESCRIPTION;
+    } else if (abbreviates(word, len, "priority") && strlen(value) <= 1) {
+        term->type = TERM_PRIORITY;
+    } else {
+        return false;
+    }
+
+    term->value = strdup(value);
+    term->len   = strlen(value);
+
+    return true;
+} /* }}} */
+
+int split_words(char* str, char*** words) { /* {{{ */
+    /**
+     * split a string into words separated by white space, in place
+     * str   - the string to split
+     * words - where the malloc'd array of words is stored
+     * return is the number of words
+     */
+    char*   save;
+    char*   word;
+    int     n = 0;
+
+    *words = calloc(strlen(str) / 2 + 1, sizeof(char*));
+
+    for (word = strtok_r(str, " \t\n", &save); word != NULL;
+            word = strtok_r(NULL, " \t\n", &save)) {
+        (*words)[n++] = word;
+    }
+
+    return n;
+} /* }}} */
+
+bool term_match(const struct task* tsk, const struct filter_term* term) { /* {{{ */
+    /**
+     * check whether a task meets a filter term
+     * tsk  - the task to check
+     * term - the term to check it against
+     */
+    switch (term->type) {
+    case TERM_DESCRIPTION:
+        return left_match(tsk->detail->description, term);
+
+    case TERM_DESCRIPTION_REGEX:
+        return tsk->detail->description != NULL &&
+               regexec(&(term->regex), tsk->detail->description, 0, NULL, 0) == 0;
+
+    case TERM_NOTAG:
+        return !has_tag(tsk, term->tag);
+
+    case TERM_PRIORITY:
+        return tsk->priority == *(term->value);
+
+    case TERM_PROJECT:
+        return left_match(tsk->project, term);
+
+    case TERM_TAG:
+        return has_tag(tsk, term->tag);
+    }
+
+    return false;
+} /* }}} */
+
+// vim: et ts=4 sw=4 sts=4
@@ -9,20 +9,39 @@
 #include <stdlib.h>
 #include <string.h>
 #include "common.h"
+#include "config.h"
 #include "formats.h"
 
 /* externs */
 extern struct var vars[];
 extern struct config cfg;
 
+/**
+ * task format generation - changes whenever a task line evaluated earlier
+ * may no longer match what the task format would produce now
+ * task_generation - the current generation, 0 if task lines must never be
+ *                   reused because the format depends on more than the task
+ * project_width   - the project field width the generation was taken at
+ */
+static unsigned int task_generation = 0;
+static int project_width = 0;
+
 /* local functions */
 static char* append_buffer(char* buffer, const char append, int* bufferlen);
 static void append_field(struct fmt_field** head, struct fmt_field** last, struct fmt_field* this);
 static struct fmt_field* buffer_field(char* buffer, int bufferlen);
-static char* eval_conditional(struct conditional_fmt_field* this, struct task* tsk);
-static char* field_to_str(struct fmt_field* this, bool* free_field, struct task* tsk);
+static struct fmt_field* eval_conditional(struct conditional_fmt_field* this,
+        struct task* tsk);
+static int eval_fields(struct fmt_field* fmts, struct task* tsk, char* out,
+                       const size_t size);
+static const char* field_to_str(struct fmt_field* this, bool* free_field, char* scratch,
+                                struct task* tsk);
+static bool format_is_static(struct fmt_field* this);
 static void free_format(struct fmt_field* this);
 static struct conditional_fmt_field* parse_conditional(char** str);
+static void put_text(char* out, const size_t size, const size_t pos, const char* str,
+                     const size_t len);
+static const char* status_name(const char status);
 
 char* append_buffer(char* buffer, const char append, int* bufferlen) { /* {{{ */
     /**
@@ -74,12 +93,20 @@ void compile_formats() { /* {{{ */
     cfg.formats.task_compiled = compile_format_string(cfg.formats.task);
     cfg.formats.title_compiled = compile_format_string(cfg.formats.title);
     cfg.formats.view_compiled = compile_format_string(cfg.formats.view);
+
+    /* start a new generation of task lines */
+    if (format_is_static(cfg.formats.task_compiled)) {
+        task_generation = task_generation > 0 ? task_generation + 1 : 1;
+        project_width = cfg.fieldlengths.project;
+    } else {
+        task_generation = 0;
+    }
 } /* }}} */
 
 struct fmt_field* compile_format_string(char* fmt) { /* {{{ */
     /* compile a given format string */
     struct fmt_field* head = NULL, *this, *last = NULL;
-    int buffersize = 0, i, width;
+    int buffersize = 0, i, width, match;
     char* buffer = NULL;
     bool next, right_align;
     static const char* task_field_map[] = {
@@ -88,7 +115,10 @@ struct fmt_field* compile_format_string(char* fmt) { /* {{{ */
         [FIELD_DUE]         = "due",
         [FIELD_PRIORITY]    = "priority",
         [FIELD_UUID]        = "uuid",
-        [FIELD_INDEX]       = "index"
+        [FIELD_INDEX]       = "index",
+        [FIELD_URGENCY]     = "urgency",
+        [FIELD_STATUS]      = "status",
+        [FIELD_ANNOTATIONS] = "annotations"
     };
 
     /* check for an empty format string */
@@ -167,7 +197,7 @@ struct fmt_field* compile_format_string(char* fmt) { /* {{{ */
             }
 
             /* check for task field */
-            for (i = FIELD_PROJECT; i <= FIELD_INDEX; i++) {
+            for (i = FIELD_PROJECT; i <= FIELD_ANNOTATIONS; i++) {
                 if (str_starts_with(fmt, task_field_map[i])) {
                     this = calloc(1, sizeof(struct fmt_field));
                     this->type = i;
@@ -184,22 +214,25 @@ struct fmt_field* compile_format_string(char* fmt) { /* {{{ */
                 continue;
             }
 
-            /* check for a var */
+            /* check for a var, taking the longest name which matches, as
+             * a name may start with another */
+            match = -1;
+
             for (i = 0; vars[i].name != NULL; i++) {
-                if (str_starts_with(fmt, vars[i].name)) {
-                    this = calloc(1, sizeof(struct fmt_field));
-                    this->width = width;
-                    this->right_align = right_align;
-                    this->type = FIELD_VAR;
-                    this->variable = &(vars[i]);
-                    append_field(&head, &last, this);
-                    fmt += strlen(vars[i].name);
-                    next = true;
-                    break;
+                if (str_starts_with(fmt, vars[i].name) &&
+                        (match < 0 || strlen(vars[i].name) > strlen(vars[match].name))) {
+                    match = i;
                 }
             }
 
-            if (next) {
+            if (match >= 0) {
+                this = calloc(1, sizeof(struct fmt_field));
+                this->width = width;
+                this->right_align = right_align;
+                this->type = FIELD_VAR;
+                this->variable = &(vars[match]);
+                append_field(&head, &last, this);
+                fmt += strlen(vars[match].name);
                 continue;
             }
 
@@ -222,186 +255,235 @@ struct fmt_field* compile_format_string(char* fmt) { /* {{{ */
     return head;
 } /* }}} */
 
-static char* eval_conditional(struct conditional_fmt_field* this,
-                              struct task* tsk) { /* {{{ */
+struct fmt_field* eval_conditional(struct conditional_fmt_field* this,
+                                   struct task* tsk) { /* {{{ */
     /**
-     * evaluate a conditional struct to a string
+     * evaluate the condition of a conditional struct
+     * a condition which is empty, "(null)", or starts with '0' or ' ' is false
      * this - the conditional struct
      * tsk  - the task to evaluate the struct on
+     * return is the fields to be printed
      */
-    char* tmp = NULL, *ret = NULL;
-
-    /* handle empty conditionals */
-    if (this == NULL) {
-        ret = calloc(1, sizeof(char));
-        *ret = 0;
-        return ret;
-    }
-
-    /* evaluate conditional */
-    tmp = eval_format(this->condition, tsk);
-
-    /* check if conditional was "(null)" */
-    if (str_eq(tmp, "(null)")) {
-        *tmp = 0;
-    }
+    char    cond[8];
+    int     len;
 
-    /* check first char of evaluated format at determine
-     * whether the positive or negative condition should
-     * be returned
-     */
-    switch (*tmp) {
-    case 0:
-    case '0':
-    case ' ':
-        ret = eval_format(this->negative, tsk);
-        break;
+    len = eval_fields(this->condition, tsk, cond, sizeof(cond));
 
-    default:
-        ret = eval_format(this->positive, tsk);
-        break;
+    if (len <= 0 || (len == 6 && str_eq(cond, "(null)")) || *cond == '0' ||
+            *cond == ' ') {
+        return this->negative;
     }
 
-    free(tmp);
-
-    return ret;
+    return this->positive;
 } /* }}} */
 
-char* eval_format(struct fmt_field* fmts, struct task* tsk) { /* {{{ */
+int eval_fields(struct fmt_field* fmts, struct task* tsk, char* out,
+                const size_t size) { /* {{{ */
     /**
-     * evaluate a linked list of format fields
+     * evaluate a linked list of format fields into a buffer
+     * fields are written where they go, so nothing is allocated for them
+     * but the values of variables
      * fmts - the first element in the linked list of format fields
      * tsk  - the task to evaluate the format on
+     * out  - where the string is written, cut to size - 1 characters, or NULL
+     *        to only measure it
+     * size - the size of out
+     * return is the length of the whole string, or -1 if no field had a value
      */
-    int totallen = 1, pos = 0;
-    unsigned int fieldwidth, fieldlen, p;
-    char* str = NULL, *tmp;
-    struct fmt_field* this;
-    bool free_tmp;
+    struct fmt_field*   this;
+    struct fmt_field*   branch;
+    char                scratch[FIELDLENGTH];
+    const char*         str;
+    bool                free_str;
+    bool                any = false;
+    size_t              pos = 0;
+    unsigned int        len;
+    unsigned int        width;
+    unsigned int        copylen;
+    int                 branchlen;
 
-    /* build string */
     for (this = fmts; this != NULL; this = this->next) {
-        tmp = NULL;
+        str = NULL;
+        branch = NULL;
+        free_str = false;
+
+        /* a conditional is measured first, then evaluated in place */
+        if (this->type == FIELD_CONDITIONAL) {
+            len = 0;
+
+            if (this->conditional != NULL) {
+                branch = eval_conditional(this->conditional, tsk);
+                branchlen = eval_fields(branch, tsk, NULL, 0);
+
+                if (branchlen < 0) {
+                    continue;
+                }
 
-        /* convert field to string */
-        tmp = field_to_str(this, &free_tmp, tsk);
+                len = branchlen;
+            }
+        } else {
+            str = field_to_str(this, &free_str, scratch, tsk);
 
-        /* handle field string */
-        if (tmp == NULL) {
-            continue;
+            if (str == NULL) {
+                continue;
+            }
+
+            len = strlen(str);
         }
 
-        /* get string data */
-        fieldlen = strlen(tmp);
+        any = true;
 
         if (this->type == FIELD_PROJECT && this->width == 0) {
-            fieldwidth = cfg.fieldlengths.project;
+            width = cfg.fieldlengths.project;
         } else {
-            fieldwidth = this->width > 0 ? this->width : fieldlen;
+            width = this->width > 0 ? this->width : len;
         }
 
-        /* realloc string */
-        totallen += fieldwidth;
-        str = realloc(str, totallen * sizeof(char));
-        str[totallen - 1] = 0;
+        /* pad to the field width, truncating fields which are too long */
+        copylen = MIN(width, len);
 
-        /* buffer right-aligned string */
         if (this->right_align) {
-            for (p = 0; p < fieldwidth - fieldlen; p++) {
-                *(str + pos + p) = ' ';
-            }
+            put_text(out, size, pos, NULL, width - copylen);
+            pos += width - copylen;
+        }
 
-            pos += fieldwidth - fieldlen;
+        if (str != NULL) {
+            put_text(out, size, pos, str, copylen);
+        } else if (branch != NULL && out != NULL && pos + 1 < size) {
+            eval_fields(branch, tsk, out + pos, MIN(copylen + 1, size - pos));
         }
 
-        /* copy string */
-        strncpy(str + pos, tmp, MIN(fieldwidth, fieldlen));
+        pos += copylen;
 
-        if (free_tmp) {
-            free(tmp);
+        if (!(this->right_align)) {
+            put_text(out, size, pos, NULL, width - copylen);
+            pos += width - copylen;
         }
 
-        /* buffer left-aligned string */
-        if (!(this->right_align)) {
-            for (p = fieldlen; p < fieldwidth; p++) {
-                *(str + pos + p) = ' ';
-            }
+        if (free_str) {
+            free((char*)str);
         }
+    }
 
-        /* move current position */
-        pos += this->right_align ? fieldlen : fieldwidth;
+    if (out != NULL && size > 0) {
+        out[MIN(pos, size - 1)] = 0;
     }
 
+    return any ? (int)pos : -1;
+} /* }}} */
+
+char* eval_format(struct fmt_field* fmts, struct task* tsk) { /* {{{ */
+    /**
+     * evaluate a linked list of format fields
+     * fmts - the first element in the linked list of format fields
+     * tsk  - the task to evaluate the format on
+     * return is the string, to be freed by the caller, or NULL if no field
+     * had a value
+     */
+    char*   str;
+    int     len;
+
+    len = eval_fields(fmts, tsk, NULL, 0);
+
+    if (len < 0 || (str = malloc(len + 1)) == NULL) {
+        return NULL;
+    }
+
+    eval_fields(fmts, tsk, str, len + 1);
+
     return str;
 } /* }}} */
 
-static char* field_to_str(struct fmt_field* this, bool* free_field,
-                          struct task* tsk) { /* {{{ */
+int eval_format_buffer(struct fmt_field* fmts, struct task* tsk, char* buffer,
+                       const size_t size) { /* {{{ */
+    /**
+     * evaluate a linked list of format fields into a buffer, as snprintf does
+     * fmts   - the first element in the linked list of format fields
+     * tsk    - the task to evaluate the format on
+     * buffer - where the string is written, cut to size - 1 characters
+     * size   - the size of buffer, 0 to only measure the string
+     * return is the length of the whole string, which did not fit if it is
+     * size or more, or -1 if no field had a value
+     */
+    return eval_fields(fmts, tsk, size > 0 ? buffer : NULL, size);
+} /* }}} */
+
+const char* field_to_str(struct fmt_field* this, bool* free_field, char* scratch,
+                         struct task* tsk) { /* {{{ */
     /**
      * evaluate a field and convert it to a string
      * this       - the field to be evaluated
      * free_field - whether the field needs to be free'd after use
+     * scratch    - FIELDLENGTH bytes which short values are written to
      * tsk        - the task to evaluate the format on
+     * return is the value, or NULL if the field has none
      */
-    char* ret = NULL;
-    *free_field = true;
+    const char* ret = NULL;
+    *free_field = false;
 
     switch (this->type) {
     case FIELD_STRING:
         ret = this->field;
-        *free_field = false;
         break;
 
     case FIELD_DATE:
-        ret = utc_date(0);
+        ret = utc_date_r(0, scratch);
         break;
 
     case FIELD_TIME:
-        ret = utc_time(0);
+        ret = utc_time_r(0, scratch);
         break;
 
     case FIELD_VAR:
         ret = var_value_message(this->variable, false);
+        *free_field = true;
         break;
 
     case FIELD_PROJECT:
         ret = tsk->project;
-        *free_field = false;
         break;
 
     case FIELD_DESCRIPTION:
-        ret = tsk->description;
-        *free_field = false;
+        ret = tsk->detail->description;
         break;
 
     case FIELD_DUE:
-        if (tsk->due) {
-            ret = utc_date(tsk->due);
-        } else {
-            ret = strdup(" ");
-        }
-
+        ret = tsk->due ? utc_date_r(tsk->due, scratch) : " ";
         break;
 
     case FIELD_PRIORITY:
         if (tsk->priority) {
-            ret = calloc(2, sizeof(char));
-            *ret = tsk->priority;
+            scratch[0] = tsk->priority;
+            scratch[1] = 0;
+            ret = scratch;
         }
 
         break;
 
     case FIELD_UUID:
-        ret = tsk->uuid;
-        *free_field = false;
+        ret = tsk->detail->uuid;
         break;
 
     case FIELD_INDEX:
-        asprintf(&ret , "%d", tsk->index);
+        snprintf(scratch, FIELDLENGTH, "%u", tsk->index);
+        ret = scratch;
+        break;
+
+    case FIELD_URGENCY:
+        snprintf(scratch, FIELDLENGTH, "%.1f", tsk->detail->urgency);
+        ret = scratch;
+        break;
+
+    case FIELD_STATUS:
+        ret = status_name(tsk->detail->status);
         break;
 
-    case FIELD_CONDITIONAL:
-        ret = eval_conditional(this->conditional, tsk);
+    case FIELD_ANNOTATIONS:
+        if (tsk->detail->nannotations > 0) {
+            snprintf(scratch, FIELDLENGTH, "%u", tsk->detail->nannotations);
+            ret = scratch;
+        }
+
         break;
 
     default:
@@ -411,6 +493,37 @@ static char* field_to_str(struct fmt_field* this, bool* free_field,
     return ret;
 } /* }}} */
 
+bool format_is_static(struct fmt_field* this) { /* {{{ */
+    /**
+     * check whether a format depends on nothing but the task it is evaluated
+     * on, so that its output for a task can be reused
+     * this - the first element in the linked list of format fields
+     */
+    for (; this != NULL; this = this->next) {
+        switch (this->type) {
+        case FIELD_DATE:
+        case FIELD_TIME:
+        case FIELD_VAR:
+            return false;
+
+        case FIELD_CONDITIONAL:
+            if (this->conditional != NULL &&
+                    (!format_is_static(this->conditional->condition) ||
+                     !format_is_static(this->conditional->positive) ||
+                     !format_is_static(this->conditional->negative))) {
+                return false;
+            }
+
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return true;
+} /* }}} */
+
 void free_format(struct fmt_field* this) { /* {{{ */
     /* walk through a format list and free its elements */
     struct fmt_field* last;
@@ -504,4 +617,71 @@ done:
     return this;
 } /* }}} */
 
+void put_text(char* out, const size_t size, const size_t pos, const char* str,
+              const size_t len) { /* {{{ */
+    /**
+     * write text into a buffer, cut to what fits before its last byte
+     * out  - the buffer, NULL if nothing is written
+     * size - the size of out
+     * pos  - where the text goes
+     * str  - the text, or NULL for spaces
+     * len  - the length of the text
+     */
+    size_t n;
+
+    if (out == NULL || pos + 1 >= size) {
+        return;
+    }
+
+    n = MIN(len, size - 1 - pos);
+
+    if (str != NULL) {
+        memcpy(out + pos, str, n);
+    } else {
+        memset(out + pos, ' ', n);
+    }
+} /* }}} */
+
+const char* status_name(const char status) { /* {{{ */
+    /**
+     * name the status of a task
+     * status - the first letter of the status
+     * return is the name, or NULL if the status is unknown
+     */
+    switch (status) {
+    case 'c':
+        return "completed";
+
+    case 'd':
+        return "deleted";
+
+    case 'p':
+        return "pending";
+
+    case 'r':
+        return "recurring";
+
+    case 'w':
+        return "waiting";
+
+    default:
+        return NULL;
+    }
+} /* }}} */
+
+unsigned int task_format_generation(void) { /* {{{ */
+    /**
+     * get the generation of the task format
+     * a task line evaluated in the same generation may be drawn again as is
+     * return is the generation, or 0 if task lines must always be evaluated
+     */
+    /* the project field is padded to the longest project in the list */
+    if (task_generation > 0 && cfg.fieldlengths.project != project_width) {
+        task_generation++;
+        project_width = cfg.fieldlengths.project;
+    }
+
+    return task_generation;
+} /* }}} */
+
 // vim: et ts=4 sw=4 sts=4
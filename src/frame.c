@@ -0,0 +1,204 @@
+/*
+ * frame.c - drawing the changed parts of the screen once per frame
+ * for tasknc
+ * by mjheagle
+ */
+
+#define _GNU_SOURCE
+#include <curses.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "frame.h"
+#include "log.h"
+#include "metrics.h"
+#include "tasklist.h"
+#include "tasknc.h"
+
+/**
+ * damage - the parts of the screen which changed since the last frame
+ * all    - whether every window must be drawn
+ * header - whether the title bar must be drawn
+ * rows   - whether each line of the task list window must be drawn
+ * nrows  - the length of rows, the height of the window it was made for
+ * any    - whether any line of the task list window must be drawn
+ */
+static struct {
+    bool all;
+    bool header;
+    bool* rows;
+    int nrows;
+    bool any;
+} damage = {true, false, NULL, 0, false};
+
+/* local functions */
+static bool check_rows(void);
+
+bool check_rows(void) { /* {{{ */
+    /**
+     * make sure the damaged lines fit the task list window, which is wholly
+     * damaged if its height changed
+     * return is whether the lines can be marked
+     */
+    const int   height = getmaxy(tasklist);
+    bool*       tmp;
+
+    if (height == damage.nrows) {
+        return true;
+    }
+
+    tmp = realloc(damage.rows, (height > 0 ? height : 1) * sizeof(bool));
+
+    if (tmp == NULL) {
+        damage.all = true;
+        return false;
+    }
+
+    damage.rows  = tmp;
+    damage.nrows = height;
+    damage.all   = true;
+    memset(damage.rows, 0, (height > 0 ? height : 1) * sizeof(bool));
+
+    return true;
+} /* }}} */
+
+void frame_damage(const int first, const int count) { /* {{{ */
+    /**
+     * mark tasks of the task list to be drawn in the next frame
+     * first - the position of the first task in the task list
+     * count - the number of consecutive tasks
+     */
+    int row;
+
+    if (damage.all || tasklist == NULL || !check_rows()) {
+        return;
+    }
+
+    for (row = first - pageoffset; row < first - pageoffset + count; row++) {
+        if (row >= 0 && row < damage.nrows) {
+            damage.rows[row] = true;
+            damage.any       = true;
+        }
+    }
+} /* }}} */
+
+void frame_damage_all(void) { /* {{{ */
+    /* mark every window to be drawn in the next frame */
+    damage.all = true;
+} /* }}} */
+
+void frame_damage_header(void) { /* {{{ */
+    /* mark the title bar to be drawn in the next frame */
+    damage.header = true;
+} /* }}} */
+
+void frame_draw(void) { /* {{{ */
+    /**
+     * draw what changed since the last frame, and update the terminal once
+     * curses sends only the characters which differ from what the terminal
+     * shows, so a frame with nothing new costs nothing
+     */
+    int         row;
+    long long   start;
+
+    if (tasklist == NULL) {
+        return;
+    }
+
+    start = metrics_start();
+
+    check_rows();
+
+    if (damage.all) {
+        /* windows drawn over, such as a pager, leave every window stale */
+        print_header();
+        tasklist_print_task_list();
+        touchwin(header);
+        touchwin(tasklist);
+        touchwin(statusbar);
+        wnoutrefresh(header);
+        wnoutrefresh(tasklist);
+        wnoutrefresh(statusbar);
+    } else {
+        if (damage.header) {
+            print_header();
+        }
+
+        for (row = 0; damage.any && row < damage.nrows; row++) {
+            if (!damage.rows[row]) {
+                continue;
+            }
+
+            if (pageoffset + row < taskcount) {
+                tasklist_print_task(pageoffset + row, NULL, 1);
+            } else {
+                wattrset(tasklist, COLOR_PAIR(0));
+                wmove(tasklist, row, 0);
+                wclrtoeol(tasklist);
+            }
+        }
+
+        if (damage.any) {
+            wnoutrefresh(tasklist);
+        }
+    }
+
+    doupdate();
+    metrics_end(PHASE_RENDER, start);
+
+    tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "frame: all:%d header:%d rows:%d", damage.all,
+                damage.header, damage.any);
+
+    damage.all    = false;
+    damage.header = false;
+    damage.any    = false;
+    memset(damage.rows, 0, damage.nrows * sizeof(bool));
+} /* }}} */
+
+void frame_free(void) { /* {{{ */
+    /* release the damaged lines */
+    free(damage.rows);
+    damage.rows  = NULL;
+    damage.nrows = 0;
+    damage.all   = true;
+} /* }}} */
+
+void frame_scroll(const int lines) { /* {{{ */
+    /**
+     * scroll the task list window, after the page offset has moved
+     * the lines which are still shown move with it, so only those scrolled
+     * into view are drawn, and curses can scroll the terminal to move the
+     * rest
+     * lines - how many lines the page offset moved down, negative for up
+     */
+    int row;
+
+    if (lines == 0 || damage.all || tasklist == NULL || !check_rows()) {
+        return;
+    }
+
+    if (abs(lines) >= damage.nrows) {
+        damage.all = true;
+        return;
+    }
+
+    scrollok(tasklist, TRUE);
+    wscrl(tasklist, lines);
+    scrollok(tasklist, FALSE);
+
+    /* move the damaged lines with the window's contents */
+    if (lines > 0) {
+        memmove(damage.rows, damage.rows + lines, (damage.nrows - lines) * sizeof(bool));
+    } else {
+        memmove(damage.rows - lines, damage.rows, (damage.nrows + lines) * sizeof(bool));
+    }
+
+    for (row = 0; row < abs(lines); row++) {
+        damage.rows[lines > 0 ? damage.nrows - 1 - row : row] = true;
+    }
+
+    damage.any = true;
+} /* }}} */
+
+// vim: et ts=4 sw=4 sts=4
@@ -0,0 +1,480 @@
+/*
+ * index.c - lookup indexes over the task list
+ * for tasknc
+ * by mjheagle
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "index.h"
+#include "intern.h"
+
+/* local functions */
+static void projects_clear(void);
+static void projects_use(const struct task* tsk, const int delta);
+static size_t uuid_hash(const unsigned char* key);
+static void uuids_build(void);
+static size_t uuids_slot(const struct task* tsk);
+
+/**
+ * position index - the tasks of the list in display order
+ * tasks   - the task at each line of the task list
+ * length  - the number of tasks in the index
+ * size    - the number of tasks that fit in the allocated vector
+ * version - changes whenever a task is added, removed, replaced or moved
+ */
+static struct {
+    struct task** tasks;
+    int length;
+    int size;
+    unsigned int version;
+} positions = {NULL, 0, 0, 0};
+
+/**
+ * project index - how many tasks of the position index have each project,
+ * so the longest project is known without scanning the task list
+ * uses    - the number of tasks with each project, by symbol id
+ * size    - the number of symbol ids uses has room for
+ * longest - the length of the longest project in use, -1 if it must be found
+ */
+static struct {
+    int* uses;
+    unsigned int size;
+    int longest;
+} projects = {NULL, 0, 0};
+
+/**
+ * uuid index - an open addressing hash table from uuid to task
+ * slots - the task hashed to each slot, NULL if empty
+ * size  - the number of slots, always a power of 2
+ */
+static struct {
+    struct task** slots;
+    size_t size;
+} uuids = {NULL, 0};
+
+void index_build(struct task* first) { /* {{{ */
+    /**
+     * rebuild the position and uuid indexes from a task list
+     * this must be run whenever tasks are added to, removed from or moved
+     * within the list, including after a sort
+     * first - the first task of the list
+     */
+    struct task*    cur;
+    struct task**   tmp;
+
+    positions.length = 0;
+    positions.version++;
+    projects_clear();
+
+    for (cur = first; cur != NULL; cur = cur->next) {
+        /* grow vector */
+        if (positions.length == positions.size) {
+            positions.size = positions.size > 0 ? 2 * positions.size : INDEXLENGTH;
+            tmp = realloc(positions.tasks, positions.size * sizeof(struct task*));
+
+            if (tmp == NULL) {
+                break;
+            }
+
+            positions.tasks = tmp;
+        }
+
+        cur->position = positions.length;
+        positions.tasks[positions.length++] = cur;
+        projects_use(cur, 1);
+    }
+
+    uuids_build();
+} /* }}} */
+
+int index_find_uuid(const char* uuid) { /* {{{ */
+    /**
+     * find the line number of the task with a uuid
+     * uuid - the uuid to match
+     * return is the line number, or -1 if no task has this uuid
+     */
+    unsigned char   key[UUIDKEYLENGTH];
+    bool            binary;
+    size_t          slot;
+    struct task*    tsk;
+
+    if (uuids.size == 0) {
+        return -1;
+    }
+
+    binary = uuid_to_key(uuid, key);
+
+    /* probe for the key, non-canonical uuids are confirmed by string */
+    for (slot = uuid_hash(key) & (uuids.size - 1); uuids.slots[slot] != NULL;
+            slot = (slot + 1) & (uuids.size - 1)) {
+        tsk = uuids.slots[slot];
+
+        if (memcmp(tsk->uuidkey, key, UUIDKEYLENGTH) == 0 &&
+                (binary || strcmp(tsk->detail->uuid, uuid) == 0)) {
+            return tsk->position;
+        }
+    }
+
+    return -1;
+} /* }}} */
+
+void index_free(void) { /* {{{ */
+    /* release the position index */
+    free(positions.tasks);
+    positions.tasks  = NULL;
+    positions.length = 0;
+    positions.size   = 0;
+    positions.version++;
+
+    free(uuids.slots);
+    uuids.slots = NULL;
+    uuids.size  = 0;
+
+    free(projects.uses);
+    projects.uses    = NULL;
+    projects.size    = 0;
+    projects.longest = 0;
+} /* }}} */
+
+struct task* index_get(const int n) { /* {{{ */
+    /**
+     * get the task at a line of the task list
+     * n - the line number
+     * return is the task, or NULL if n is out of range
+     */
+    if (n < 0 || n >= positions.length) {
+        return NULL;
+    }
+
+    return positions.tasks[n];
+} /* }}} */
+
+void index_insert(const int n, struct task* tsk) { /* {{{ */
+    /**
+     * add a task to the indexes at a line
+     * lines from n on move down by one
+     * n   - the line number of the new task
+     * tsk - the task, which must not be in the indexes
+     */
+    struct task**   tmp;
+    size_t          slot;
+    int             i;
+
+    if (n < 0 || n > positions.length) {
+        return;
+    }
+
+    /* grow vector */
+    if (positions.length == positions.size) {
+        positions.size = positions.size > 0 ? 2 * positions.size : INDEXLENGTH;
+        tmp = realloc(positions.tasks, positions.size * sizeof(struct task*));
+
+        if (tmp == NULL) {
+            return;
+        }
+
+        positions.tasks = tmp;
+    }
+
+    memmove(positions.tasks + n + 1, positions.tasks + n,
+            (positions.length - n) * sizeof(struct task*));
+    positions.tasks[n] = tsk;
+    positions.length++;
+    positions.version++;
+    projects_use(tsk, 1);
+
+    for (i = n; i < positions.length; i++) {
+        positions.tasks[i]->position = i;
+    }
+
+    /* add to the uuid index, rebuilding it once it would be over half full */
+    if (2 * (size_t)positions.length > uuids.size) {
+        uuids_build();
+    } else {
+        for (slot = uuid_hash(tsk->uuidkey) & (uuids.size - 1); uuids.slots[slot] != NULL;
+                slot = (slot + 1) & (uuids.size - 1));
+
+        uuids.slots[slot] = tsk;
+    }
+} /* }}} */
+
+int index_length(void) { /* {{{ */
+    /* return the number of tasks in the index */
+    return positions.length;
+} /* }}} */
+
+int index_project_length(void) { /* {{{ */
+    /* return the length of the longest project of a task in the index */
+    unsigned int id;
+
+    if (projects.longest < 0) {
+        projects.longest = 0;
+
+        for (id = 1; id < projects.size; id++) {
+            if (projects.uses[id] > 0 && (int)intern_length(id) > projects.longest) {
+                projects.longest = intern_length(id);
+            }
+        }
+    }
+
+    return projects.longest;
+} /* }}} */
+
+void index_remove(const int n) { /* {{{ */
+    /**
+     * remove the task at a line from the indexes
+     * lines after it move up by one
+     * n - the line number of the task to remove
+     */
+    size_t  hole;
+    size_t  slot;
+    size_t  home;
+    int     i;
+
+    if (n < 0 || n >= positions.length) {
+        return;
+    }
+
+    /* delete from the uuid index, shifting back later members of its probe
+     * sequence so that no lookup stops early at the hole */
+    if (uuids.size > 0) {
+        hole = uuids_slot(positions.tasks[n]);
+        uuids.slots[hole] = NULL;
+
+        for (slot = (hole + 1) & (uuids.size - 1); uuids.slots[slot] != NULL;
+                slot = (slot + 1) & (uuids.size - 1)) {
+            home = uuid_hash(uuids.slots[slot]->uuidkey) & (uuids.size - 1);
+
+            if (((slot - home) & (uuids.size - 1)) >= ((slot - hole) & (uuids.size - 1))) {
+                uuids.slots[hole] = uuids.slots[slot];
+                uuids.slots[slot] = NULL;
+                hole = slot;
+            }
+        }
+    }
+
+    projects_use(positions.tasks[n], -1);
+
+    /* close the gap in the position index */
+    positions.length--;
+    positions.version++;
+    memmove(positions.tasks + n, positions.tasks + n + 1,
+            (positions.length - n) * sizeof(struct task*));
+
+    for (i = n; i < positions.length; i++) {
+        positions.tasks[i]->position = i;
+    }
+} /* }}} */
+
+void index_reposition(const int from, const int to, struct task* tsk) { /* {{{ */
+    /**
+     * replace the task at a line with a task of the same uuid, and move it
+     * lines between the old and new line shift by one to make room
+     * from - the line number of the task being replaced
+     * to   - the line number the replacement is moved to
+     * tsk  - the replacement task
+     */
+    int lo = from < to ? from : to;
+    int hi = from < to ? to : from;
+    int i;
+
+    if (from < 0 || from >= positions.length || to < 0 || to >= positions.length) {
+        return;
+    }
+
+    /* the uuid is unchanged, so the replacement takes the same slot */
+    if (uuids.size > 0) {
+        uuids.slots[uuids_slot(positions.tasks[from])] = tsk;
+    }
+
+    projects_use(positions.tasks[from], -1);
+    projects_use(tsk, 1);
+
+    if (from < to) {
+        memmove(positions.tasks + from, positions.tasks + from + 1,
+                (to - from) * sizeof(struct task*));
+    } else {
+        memmove(positions.tasks + to + 1, positions.tasks + to,
+                (from - to) * sizeof(struct task*));
+    }
+
+    positions.tasks[to] = tsk;
+    positions.version++;
+
+    for (i = lo; i <= hi; i++) {
+        positions.tasks[i]->position = i;
+    }
+} /* }}} */
+
+unsigned int index_version(void) { /* {{{ */
+    /* return the version of the position index, so that data derived from
+     * it can tell when it is stale */
+    return positions.version;
+} /* }}} */
+
+void projects_clear(void) { /* {{{ */
+    /* forget the projects in use, before the position index is rebuilt */
+    if (projects.uses != NULL) {
+        memset(projects.uses, 0, projects.size * sizeof(int));
+    }
+
+    projects.longest = 0;
+} /* }}} */
+
+void projects_use(const struct task* tsk, const int delta) { /* {{{ */
+    /**
+     * count a task's project in or out of the projects in use
+     * tsk   - the task added to or removed from the position index
+     * delta - 1 if it was added, -1 if it was removed
+     */
+    const unsigned int  id = tsk->projectid;
+    const int           len = intern_length(id);
+    unsigned int        size;
+    int*                tmp;
+
+    if (id == NOSYMBOL) {
+        return;
+    }
+
+    /* grow vector to cover the symbol ids handed out so far */
+    if (id >= projects.size) {
+        size = intern_count() > id ? intern_count() : id + 1;
+        tmp = realloc(projects.uses, size * sizeof(int));
+
+        if (tmp == NULL) {
+            return;
+        }
+
+        memset(tmp + projects.size, 0, (size - projects.size) * sizeof(int));
+        projects.uses = tmp;
+        projects.size = size;
+    }
+
+    projects.uses[id] += delta;
+
+    if (delta > 0 && projects.longest >= 0 && len > projects.longest) {
+        projects.longest = len;
+    } else if (delta < 0 && projects.uses[id] == 0 && len == projects.longest) {
+        projects.longest = -1;
+    }
+} /* }}} */
+
+size_t uuid_hash(const unsigned char* key) { /* {{{ */
+    /* hash a binary uuid by mixing its first half */
+    uint64_t h;
+
+    memcpy(&h, key, sizeof(h));
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+
+    return (size_t)h;
+} /* }}} */
+
+bool uuid_to_key(const char* uuid, unsigned char* key) { /* {{{ */
+    /**
+     * convert a uuid string to its binary key
+     * uuid - the uuid string, in canonical 8-4-4-4-12 hex form
+     * key  - where the UUIDKEYLENGTH byte key is stored
+     * return is whether the uuid was canonical
+     * a non-canonical uuid is given a key by hashing its characters,
+     * so matching keys must then be confirmed by comparing the strings
+     */
+    const char* pos = uuid;
+    int         hi;
+    int         lo;
+    int         i;
+    uint64_t    h = 0xcbf29ce484222325ULL;
+
+    for (i = 0; i < UUIDKEYLENGTH; i++) {
+        if (i == 4 || i == 6 || i == 8 || i == 10) {
+            if (*pos != '-') {
+                goto fallback;
+            }
+
+            pos++;
+        }
+
+        hi = hex_value(pos[0]);
+        lo = hi < 0 ? -1 : hex_value(pos[1]);
+
+        if (lo < 0) {
+            goto fallback;
+        }
+
+        key[i] = (hi << 4) | lo;
+        pos += 2;
+    }
+
+    if (*pos == 0) {
+        return true;
+    }
+
+fallback:
+    /* fnv-1a over the string, spread across both halves of the key */
+    for (pos = uuid; *pos != 0; pos++) {
+        h = (h ^ (unsigned char)*pos) * 0x100000001b3ULL;
+    }
+
+    memcpy(key, &h, sizeof(h));
+    h = ~h;
+    memcpy(key + sizeof(h), &h, sizeof(h));
+
+    return false;
+} /* }}} */
+
+void uuids_build(void) { /* {{{ */
+    /* rebuild the uuid index from the position index */
+    size_t          size;
+    size_t          slot;
+    int             i;
+    struct task**   tmp;
+
+    /* keep the table at most half full */
+    for (size = INDEXLENGTH; size < 2 * (size_t)positions.length; size *= 2);
+
+    if (size != uuids.size) {
+        tmp = realloc(uuids.slots, size * sizeof(struct task*));
+
+        if (tmp == NULL) {
+            free(uuids.slots);
+            uuids.slots = NULL;
+            uuids.size  = 0;
+            return;
+        }
+
+        uuids.slots = tmp;
+        uuids.size  = size;
+    }
+
+    memset(uuids.slots, 0, uuids.size * sizeof(struct task*));
+
+    for (i = 0; i < positions.length; i++) {
+        slot = uuid_hash(positions.tasks[i]->uuidkey) & (uuids.size - 1);
+
+        while (uuids.slots[slot] != NULL) {
+            slot = (slot + 1) & (uuids.size - 1);
+        }
+
+        uuids.slots[slot] = positions.tasks[i];
+    }
+} /* }}} */
+
+size_t uuids_slot(const struct task* tsk) { /* {{{ */
+    /**
+     * find the slot of the uuid index holding a task
+     * tsk - a task which is in the index
+     */
+    size_t slot = uuid_hash(tsk->uuidkey) & (uuids.size - 1);
+
+    while (uuids.slots[slot] != tsk) {
+        slot = (slot + 1) & (uuids.size - 1);
+    }
+
+    return slot;
+} /* }}} */
+
+// vim: et ts=4 sw=4 sts=4
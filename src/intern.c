@@ -0,0 +1,217 @@
+/*
+ * intern.c - a shared table of project and tag names
+ * for tasknc
+ * by mjheagle
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "intern.h"
+#include "log.h"
+
+/**
+ * symbol - a distinct string in the symbol table
+ * name   - the string, which lives as long as the table
+ * length - the length of name
+ * hash   - the hash of name
+ */
+struct symbol {
+    const char* name;
+    size_t length;
+    unsigned int hash;
+};
+
+/**
+ * symbol table - every project and tag name seen, each stored once
+ * ids are handed out in order from 1, and stay valid until the table is freed
+ * symbols  - the symbol of each id, symbols[0] is unused
+ * nsymbols - the number of ids handed out, plus one
+ * size     - the number of symbols that fit in the allocated vector
+ * slots    - an open addressing hash table of ids, 0 if empty
+ * nslots   - the number of slots, always a power of 2
+ * names    - the arena the names are copied into
+ */
+static struct {
+    struct symbol* symbols;
+    unsigned int nsymbols;
+    unsigned int size;
+    unsigned int* slots;
+    unsigned int nslots;
+    struct arena names;
+} table = {NULL, 1, 0, NULL, 0, {NULL, NULL, 0, 0}};
+
+/* local functions */
+static unsigned int hash_string(const char* str, const size_t len);
+static void rehash(void);
+
+unsigned int hash_string(const char* str, const size_t len) { /* {{{ */
+    /* fnv-1a hash of a string, which need not be terminated */
+    unsigned int    h = 2166136261u;
+    size_t          i;
+
+    for (i = 0; i < len; i++) {
+        h = (h ^ (unsigned char)str[i]) * 16777619u;
+    }
+
+    return h;
+} /* }}} */
+
+unsigned int intern(const char* str, const size_t len) { /* {{{ */
+    /**
+     * find the symbol id of a string, adding it to the table if it is new
+     * str - the string, which need not be terminated
+     * len - the length of str
+     * return is the id, or NOSYMBOL on failure
+     */
+    unsigned int        h = hash_string(str, len);
+    unsigned int        slot;
+    unsigned int        id;
+    struct symbol*      sym;
+    struct symbol*      tmp;
+
+    for (slot = h & (table.nslots - 1); table.nslots > 0 && table.slots[slot] != 0;
+            slot = (slot + 1) & (table.nslots - 1)) {
+        sym = table.symbols + table.slots[slot];
+
+        if (sym->hash == h && sym->length == len && memcmp(sym->name, str, len) == 0) {
+            return table.slots[slot];
+        }
+    }
+
+    /* grow vector */
+    if (table.nsymbols >= table.size) {
+        table.size = table.size > 0 ? 2 * table.size : SYMBOLTABLELENGTH;
+        tmp = realloc(table.symbols, table.size * sizeof(struct symbol));
+
+        if (tmp == NULL) {
+            return NOSYMBOL;
+        }
+
+        table.symbols = tmp;
+    }
+
+    if (table.names.blocksize == 0) {
+        arena_init(&(table.names), SYMBOLARENALENGTH);
+    }
+
+    sym = table.symbols + table.nsymbols;
+    sym->name = arena_strndup(&(table.names), str, len);
+    sym->length = len;
+    sym->hash = h;
+
+    if (sym->name == NULL) {
+        return NOSYMBOL;
+    }
+
+    id = table.nsymbols++;
+
+    /* keep the hash table at most half full */
+    if (2 * table.nsymbols > table.nslots) {
+        rehash();
+    } else {
+        table.slots[slot] = id;
+    }
+
+    tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "intern: %u = %s", id, sym->name);
+
+    return id;
+} /* }}} */
+
+unsigned int intern_count(void) { /* {{{ */
+    /* return the number of symbol ids, plus one for NOSYMBOL */
+    return table.nsymbols;
+} /* }}} */
+
+void intern_free(void) { /* {{{ */
+    /* release the symbol table, invalidating every id and name */
+    free(table.symbols);
+    free(table.slots);
+    arena_free(&(table.names));
+    table.symbols  = NULL;
+    table.nsymbols = 1;
+    table.size     = 0;
+    table.slots    = NULL;
+    table.nslots   = 0;
+} /* }}} */
+
+size_t intern_length(const unsigned int id) { /* {{{ */
+    /* return the length of the string with a symbol id, 0 for NOSYMBOL */
+    return id > NOSYMBOL && id < table.nsymbols ? table.symbols[id].length : 0;
+} /* }}} */
+
+const char* intern_name(const unsigned int id) { /* {{{ */
+    /* return the string with a symbol id, NULL for NOSYMBOL */
+    return id > NOSYMBOL && id < table.nsymbols ? table.symbols[id].name : NULL;
+} /* }}} */
+
+void intern_task(struct task* tsk, struct arena* arena) { /* {{{ */
+    /**
+     * intern the project and tags of a task
+     * the project is pointed at the shared copy of its name, and the tags
+     * string of the form "tag1","tag2" is split into symbol ids
+     * tsk   - the task
+     * arena - the arena the ids of the tags are allocated from
+     */
+    const char*     pos;
+    const char*     end;
+    unsigned int    n = 1;
+
+    tsk->projectid = NOSYMBOL;
+    tsk->tagids    = NULL;
+    tsk->ntags     = 0;
+
+    if (tsk->project != NULL) {
+        tsk->projectid = intern(tsk->project, strlen(tsk->project));
+        tsk->project   = tsk->projectid != NOSYMBOL ? intern_name(tsk->projectid) :
+                         tsk->project;
+    }
+
+    if (tsk->detail->tags == NULL || *tsk->detail->tags != '"' || strlen(tsk->detail->tags) < 2) {
+        return;
+    }
+
+    for (pos = tsk->detail->tags; (pos = strstr(pos, "\",\"")) != NULL; pos += 3, n++);
+
+    tsk->tagids = arena_alloc(arena, n * sizeof(unsigned int));
+
+    if (tsk->tagids == NULL) {
+        return;
+    }
+
+    /* each tag is quoted, tags are separated by commas */
+    for (pos = tsk->detail->tags + 1; tsk->ntags < n; pos = end + 3) {
+        end = strstr(pos, "\",\"");
+
+        if (end == NULL) {
+            end = pos + strlen(pos) - 1;
+        }
+
+        tsk->tagids[tsk->ntags++] = intern(pos, end - pos);
+    }
+} /* }}} */
+
+void rehash(void) { /* {{{ */
+    /* rebuild the hash table of ids, doubling its size */
+    unsigned int    size = table.nslots > 0 ? 2 * table.nslots : 2 * SYMBOLTABLELENGTH;
+    unsigned int*   tmp = calloc(size, sizeof(unsigned int));
+    unsigned int    slot;
+    unsigned int    id;
+
+    if (tmp == NULL) {
+        return;
+    }
+
+    for (id = 1; id < table.nsymbols; id++) {
+        for (slot = table.symbols[id].hash & (size - 1); tmp[slot] != 0;
+                slot = (slot + 1) & (size - 1));
+
+        tmp[slot] = id;
+    }
+
+    free(table.slots);
+    table.slots  = tmp;
+    table.nslots = size;
+} /* }}} */
+
+// vim: et ts=4 sw=4 sts=4
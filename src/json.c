@@ -0,0 +1,327 @@
+/*
+ * json.c - single pass json tokenizer for task export
+ * for tasknc
+ * by mjheagle
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "json.h"
+
+/* local functions */
+static char* put_utf8(char* out, unsigned long cp);
+static char* read_hex4(char* pos, unsigned long* cp);
+
+char* json_expect(char* pos, const char c) { /* {{{ */
+    /**
+     * skip whitespace and consume a single structural character
+     * pos - the position to start at
+     * c   - the character that must come next
+     * return is the position after the character, or NULL if it is missing
+     */
+    pos = json_skip_ws(pos);
+
+    if (*pos != c) {
+        return NULL;
+    }
+
+    return pos + 1;
+} /* }}} */
+
+char* json_parse_number(char* pos, double* value) { /* {{{ */
+    /**
+     * parse a json number
+     * pos   - the position of the first character of the number
+     * value - where the parsed number is stored
+     * return is the position after the number, or NULL on failure
+     */
+    char* end;
+
+    *value = strtod(pos, &end);
+
+    if (end == pos) {
+        return NULL;
+    }
+
+    return end;
+} /* }}} */
+
+char* json_parse_string(char* pos, char** str, size_t* len) { /* {{{ */
+    /**
+     * parse a json string, unescaping it in place
+     * the unescaped string is never longer than its source, so it is written
+     * over the source text and null terminated there
+     * pos - the position of the opening quote
+     * str - where a pointer to the unescaped string is stored
+     * len - where the length of the unescaped string is stored (may be NULL)
+     * return is the position after the closing quote, or NULL on failure
+     */
+    char*           out;
+    unsigned long   cp;
+    unsigned long   low;
+
+    if (*pos != '"') {
+        return NULL;
+    }
+
+    pos++;
+    *str = pos;
+    out = pos;
+
+    while (*pos != '"') {
+        /* copy plain characters */
+        if (*pos != '\\') {
+            if (*pos == 0) {
+                return NULL;
+            }
+
+            *(out++) = *(pos++);
+            continue;
+        }
+
+        /* handle escapes */
+        pos++;
+
+        switch (*pos) {
+        case '"':
+        case '\\':
+        case '/':
+            *(out++) = *pos;
+            break;
+
+        case 'b':
+            *(out++) = '\b';
+            break;
+
+        case 'f':
+            *(out++) = '\f';
+            break;
+
+        case 'n':
+            *(out++) = '\n';
+            break;
+
+        case 'r':
+            *(out++) = '\r';
+            break;
+
+        case 't':
+            *(out++) = '\t';
+            break;
+
+        case 'u':
+            pos = read_hex4(pos + 1, &cp);
+
+            if (pos == NULL) {
+                return NULL;
+            }
+
+            /* combine utf-16 surrogate pairs */
+            if (cp >= 0xd800 && cp <= 0xdbff && pos[1] == '\\' && pos[2] == 'u') {
+                char* next = read_hex4(pos + 3, &low);
+
+                if (next != NULL && low >= 0xdc00 && low <= 0xdfff) {
+                    cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                    pos = next;
+                }
+            }
+
+            out = put_utf8(out, cp);
+            break;
+
+        default:
+            return NULL;
+        }
+
+        pos++;
+    }
+
+    *out = 0;
+
+    if (len != NULL) {
+        *len = out - *str;
+    }
+
+    return pos + 1;
+} /* }}} */
+
+enum json_type json_peek(const char* pos) { /* {{{ */
+    /**
+     * determine the type of the value starting at pos
+     * pos - the first non-whitespace character of a value
+     */
+    switch (*pos) {
+    case '"':
+        return JSON_STRING;
+
+    case '{':
+        return JSON_OBJECT;
+
+    case '[':
+        return JSON_ARRAY;
+
+    case 't':
+        return JSON_TRUE;
+
+    case 'f':
+        return JSON_FALSE;
+
+    case 'n':
+        return JSON_NULL;
+
+    case '-':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+        return JSON_NUMBER;
+
+    default:
+        return JSON_ERROR;
+    }
+} /* }}} */
+
+char* json_skip_value(char* pos) { /* {{{ */
+    /**
+     * skip over a json value of any type, including nested objects and arrays
+     * strings are only scanned, not unescaped
+     * pos - the position of the value
+     * return is the position after the value, or NULL on failure
+     */
+    int depth = 0;
+
+    pos = json_skip_ws(pos);
+
+    do {
+        switch (*pos) {
+        case '"':
+            pos++;
+
+            while (*pos != '"') {
+                if (*pos == 0) {
+                    return NULL;
+                }
+
+                if (*pos == '\\' && pos[1] != 0) {
+                    pos++;
+                }
+
+                pos++;
+            }
+
+            pos++;
+            break;
+
+        case '{':
+        case '[':
+            depth++;
+            pos++;
+            break;
+
+        case '}':
+        case ']':
+            if (depth == 0) {
+                return NULL;
+            }
+
+            depth--;
+            pos++;
+            break;
+
+        case ',':
+        case ':':
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+            if (depth == 0) {
+                return NULL;
+            }
+
+            pos++;
+            break;
+
+        case 0:
+            return NULL;
+
+        default:
+            /* literals and numbers */
+            while (*pos != 0 && strchr(",:]} \t\r\n", *pos) == NULL) {
+                pos++;
+            }
+
+            break;
+        }
+    } while (depth > 0);
+
+    return pos;
+} /* }}} */
+
+char* json_skip_ws(char* pos) { /* {{{ */
+    /* skip json whitespace */
+    while (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r') {
+        pos++;
+    }
+
+    return pos;
+} /* }}} */
+
+char* put_utf8(char* out, unsigned long cp) { /* {{{ */
+    /**
+     * write a code point as utf-8
+     * out - where to write the encoded character
+     * cp  - the code point
+     * return is the position after the written bytes
+     */
+    if (cp < 0x80) {
+        *(out++) = cp;
+    } else if (cp < 0x800) {
+        *(out++) = 0xc0 | (cp >> 6);
+        *(out++) = 0x80 | (cp & 0x3f);
+    } else if (cp < 0x10000) {
+        *(out++) = 0xe0 | (cp >> 12);
+        *(out++) = 0x80 | ((cp >> 6) & 0x3f);
+        *(out++) = 0x80 | (cp & 0x3f);
+    } else {
+        *(out++) = 0xf0 | (cp >> 18);
+        *(out++) = 0x80 | ((cp >> 12) & 0x3f);
+        *(out++) = 0x80 | ((cp >> 6) & 0x3f);
+        *(out++) = 0x80 | (cp & 0x3f);
+    }
+
+    return out;
+} /* }}} */
+
+char* read_hex4(char* pos, unsigned long* cp) { /* {{{ */
+    /**
+     * read the four hex digits of a \u escape
+     * pos - the first hex digit
+     * cp  - where the value is stored
+     * return is the position of the last hex digit, or NULL on failure
+     */
+    int i;
+    int v;
+
+    *cp = 0;
+
+    for (i = 0; i < 4; i++) {
+        v = hex_value(pos[i]);
+
+        if (v < 0) {
+            return NULL;
+        }
+
+        *cp = (*cp << 4) | v;
+    }
+
+    return pos + 3;
+} /* }}} */
+
+// vim: et ts=4 sw=4 sts=4
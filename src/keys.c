@@ -151,6 +151,61 @@ struct keymap keymaps[] = {
 const int nkeys = sizeof(keymaps) / sizeof(struct keymap);
 /* }}} */
 
+/* the modes with binds of their own, binds in MODE_ANY apply in each */
+#define KEYMODES                2
+
+/**
+ * key slot - the binds of a key in the dispatch table
+ * key      - the key, only set for keys past the table
+ * start    - the position of the first bind in the table's binds
+ * count    - the number of binds
+ * sequence - whether any of the binds is to a sequence of keys
+ */
+struct key_slot {
+    int key;
+    int start;
+    int count;
+    bool sequence;
+};
+
+/**
+ * dispatch table - the keybinds of each mode, found by the first key of
+ * each bind, which is built from the list of keybinds when it is next needed
+ * after a bind is added or removed
+ * binds       - the binds of every slot, each slot's in the order they
+ *               were added
+ * slots       - the slot of each key below KEYTABLELENGTH, for each mode
+ * high        - the slots of other keys, for each mode
+ * nhigh       - the number of those slots
+ * built       - whether the table matches the list of keybinds
+ * changes     - counts the binds being added or removed and the table
+ *               being freed, so a loop running binds can tell when one of
+ *               them left its slot or binds stale
+ * pending     - the keys of a sequence typed so far
+ * npending    - the number of those keys
+ * pendingmode - the mode they were typed in
+ * due         - when the sequence ends if no other key is typed, by now_ms
+ */
+static struct {
+    struct keybind** binds;
+    struct key_slot slots[KEYMODES][KEYTABLELENGTH];
+    struct key_slot* high[KEYMODES];
+    int nhigh[KEYMODES];
+    bool built;
+    unsigned int changes;
+    int pending[KEYSEQUENCELENGTH];
+    int npending;
+    enum prog_mode pendingmode;
+    long due;
+} table;
+
+/* local functions */
+static void build_table(void);
+static void end_sequence(void);
+static struct key_slot* find_slot(const int mode, const int key, const bool add);
+static void free_table(void);
+static void run_bind(struct keybind* this_bind, const enum prog_mode mode);
+
 void add_int_keybind(const int key,
                      void* function,
                      const int argint,
@@ -180,16 +235,41 @@ void add_keybind(const int key,
      * arg      - the argument to the function
      * mode     - the mode the bind applies in
      */
+    add_keybind_sequence(&key, 1, function, arg, mode);
+} /* }}} */
+
+void add_keybind_sequence(const int* keys,
+                          const int nkeys,
+                          void* function,
+                          char* arg,
+                          const enum prog_mode mode) { /* {{{ */
+    /**
+     * add a keybind to a sequence of keys to the linked list of keybinds
+     * keys     - the keys to be bound, pressed one after the other
+     * nkeys    - the number of keys, at most KEYSEQUENCELENGTH
+     * function - the function to be bound
+     * arg      - the argument to the function
+     * mode     - the mode the bind applies in
+     */
     struct keybind* this_bind;
     struct keybind* new;
     int             n = 0;
     char*           modestr;
     char*           name;
 
+    if (nkeys < 1 || nkeys > KEYSEQUENCELENGTH) {
+        tnc_fprintf(logfp, LOG_ERROR, "bind: %d keys cannot be bound, at most %d can",
+                    nkeys, KEYSEQUENCELENGTH);
+        return;
+    }
+
     /* create new bind */
     new = calloc(1, sizeof(struct keybind));
-    new->key        = key;
+    new->nkeys      = nkeys;
+    memcpy(new->keys, keys, nkeys * sizeof(int));
+    new->key        = keys[0];
     new->function   = function;
+    new->funcname   = name_function(function);
     new->argint     = 0;
     new->argstr     = arg != NULL ? strdup(arg) : NULL;
     new->next       = NULL;
@@ -209,6 +289,9 @@ void add_keybind(const int key,
         n++;
     }
 
+    table.built = false;
+    table.changes++;
+
     /* write log */
     if (mode == MODE_PAGER) {
         modestr = "pager - ";
@@ -218,70 +301,307 @@ void add_keybind(const int key,
         modestr = " ";
     }
 
-    name = name_key(key);
+    name = name_keys(new->keys, new->nkeys);
     tnc_fprintf(logfp, LOG_DEBUG,
                 "bind #%d: key %s (%d) bound to @%p %s%s(args: %d/%s)", n, name,
-                key, function, modestr, name_function(function), new->argint,
+                new->key, function, modestr, new->funcname, new->argint,
                 new->argstr);
     free(name);
 } /* }}} */
 
+void build_table(void) { /* {{{ */
+    /* build the dispatch table from the list of keybinds */
+    struct keybind* this;
+    struct key_slot* slot;
+    int             total = 0;
+    int             mode;
+    int             i;
+
+    free_table();
+
+    /* count the binds of each key, then give each its place in binds */
+    for (mode = 0; mode < KEYMODES; mode++) {
+        for (this = keybinds; this != NULL; this = this->next) {
+            if ((int)this->mode == mode || this->mode == MODE_ANY) {
+                slot = find_slot(mode, this->key, true);
+
+                if (slot != NULL) {
+                    slot->count++;
+                    slot->sequence |= this->nkeys > 1;
+                    total++;
+                }
+            }
+        }
+    }
+
+    table.binds = calloc(total + 1, sizeof(struct keybind*));
+    total = 0;
+
+    for (mode = 0; mode < KEYMODES; mode++) {
+        for (i = 0; i < KEYTABLELENGTH + table.nhigh[mode]; i++) {
+            slot = i < KEYTABLELENGTH ? table.slots[mode] + i :
+                   table.high[mode] + i - KEYTABLELENGTH;
+            slot->start = total;
+            total += slot->count;
+            slot->count = 0;
+        }
+    }
+
+    /* fill in the binds of each key, in the order they were added */
+    for (mode = 0; mode < KEYMODES; mode++) {
+        for (this = keybinds; this != NULL; this = this->next) {
+            if ((int)this->mode == mode || this->mode == MODE_ANY) {
+                slot = find_slot(mode, this->key, false);
+
+                if (slot != NULL) {
+                    table.binds[slot->start + slot->count] = this;
+                    slot->count++;
+                }
+            }
+        }
+    }
+
+    table.built = true;
+    tnc_fprintf(logfp, LOG_DEBUG, "built keybind table (%d binds)", total);
+} /* }}} */
+
+void end_sequence(void) { /* {{{ */
+    /**
+     * end a key sequence which was not completed, running the binds to the
+     * keys typed so far, if there are any
+     */
+    struct key_slot*    slot;
+    struct keybind*     this_bind;
+    const int           n = table.npending;
+    unsigned int        changes;
+    int                 i;
+
+    table.npending = 0;
+
+    if (!table.built) {
+        build_table();
+    }
+
+    changes = table.changes;
+
+    slot = find_slot(table.pendingmode, table.pending[0], false);
+
+    for (i = 0; slot != NULL && i < slot->count; i++) {
+        this_bind = table.binds[slot->start + i];
+
+        if (this_bind->nkeys != n ||
+                memcmp(this_bind->keys, table.pending, n * sizeof(int)) != 0) {
+            continue;
+        }
+
+        run_bind(this_bind, table.pendingmode);
+
+#ifndef ENABLE_MACROS
+        break;
+#endif
+
+        /* a bind which changed the binds freed what this loop reads */
+        if (table.changes != changes) {
+            break;
+        }
+    }
+} /* }}} */
+
+struct key_slot* find_slot(const int mode, const int key, const bool add) { /* {{{ */
+    /**
+     * find the slot of the dispatch table holding the binds of a key
+     * mode - the mode the binds apply in
+     * key  - the key
+     * add  - whether a slot is added for a key which has none
+     * return is the slot, or NULL if there is none
+     */
+    struct key_slot*    tmp;
+    int                 i;
+
+    if (key >= 0 && key < KEYTABLELENGTH) {
+        return table.slots[mode] + key;
+    }
+
+    /* keys past the table are rare, and kept in a short list */
+    for (i = 0; i < table.nhigh[mode]; i++) {
+        if (table.high[mode][i].key == key) {
+            return table.high[mode] + i;
+        }
+    }
+
+    if (!add) {
+        return NULL;
+    }
+
+    tmp = realloc(table.high[mode], (table.nhigh[mode] + 1) * sizeof(struct key_slot));
+
+    if (tmp == NULL) {
+        return NULL;
+    }
+
+    table.high[mode] = tmp;
+    tmp += table.nhigh[mode]++;
+    memset(tmp, 0, sizeof(struct key_slot));
+    tmp->key = key;
+
+    return tmp;
+} /* }}} */
+
+void free_keybinds(void) { /* {{{ */
+    /* free every keybind and the dispatch table */
+    struct keybind* this;
+
+    while (keybinds != NULL) {
+        this = keybinds;
+        keybinds = keybinds->next;
+        check_free(this->argstr);
+        free(this);
+    }
+
+    free_table();
+} /* }}} */
+
+void free_table(void) { /* {{{ */
+    /* empty the dispatch table, and any key sequence being typed */
+    int mode;
+
+    free(table.binds);
+    table.binds = NULL;
+
+    for (mode = 0; mode < KEYMODES; mode++) {
+        free(table.high[mode]);
+        table.high[mode] = NULL;
+        table.nhigh[mode] = 0;
+        memset(table.slots[mode], 0, sizeof(table.slots[mode]));
+    }
+
+    table.npending = 0;
+    table.built = false;
+    table.changes++;
+} /* }}} */
+
 void handle_keypress(const int c,
                      const enum prog_mode mode) { /* {{{ */
     /* handle a key press on the main screen */
     /**
      * handle a key pressed
-     * c    - the key pressed
+     * a key which starts a key sequence waits for the rest of it, other keys
+     * run their binds at once
+     * c    - the key pressed, or ERR if none was before a timeout
      * mode - the mode the key was pressed during
      */
-    struct keybind* this_bind;
-    char*           modestr;
-    char*           keyname;
-    bool            match = false;
-
-    /* exit if timeout occurred */
+    struct key_slot*    slot;
+    struct keybind*     this_bind;
+    char*               keyname;
+    int                 n = table.npending;
+    unsigned int        changes;
+    int                 i;
+    bool                match = false;
+    bool                started = false;
+
+    /* a sequence which was not continued in time ends with the keys typed */
     if (c == ERR) {
+        if (n > 0 && now_ms() >= table.due) {
+            end_sequence();
+        }
+
         return;
     }
 
-    /* iterate through keybinds */
-    this_bind = keybinds;
+    if (mode >= KEYMODES) {
+        return;
+    }
 
-    while (this_bind != NULL) {
-        if ((this_bind->mode == mode || this_bind->mode == MODE_ANY) &&
-            c == this_bind->key) {
-            if (this_bind->function != NULL) {
-                if (this_bind->mode == MODE_PAGER) {
-                    modestr = "pager - ";
-                } else if (this_bind->mode == MODE_TASKLIST) {
-                    modestr = "tasklist - ";
-                } else {
-                    modestr = "any - ";
-                }
+    if (!table.built) {
+        build_table();
+    }
 
-                tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "calling function @%p %s%s(%s)",
-                            this_bind->function, modestr, name_function(this_bind->function),
-                            this_bind->argstr);
-                (*(this_bind->function))(this_bind->argstr);
-            }
+    /* a sequence typed in another mode is dropped */
+    if (n > 0 && table.pendingmode != mode) {
+        n = table.npending = 0;
+    }
+
+    slot = find_slot(mode, n > 0 ? table.pending[0] : c, false);
+
+    if (slot == NULL || slot->count == 0) {
+        keyname = name_key(c);
+        statusbar_message(cfg.statusbar_timeout, "unhandled key: %s (%d)", keyname, c);
+        free(keyname);
+        return;
+    }
+
+    /* the first key of a sequence waits for the next */
+    if (n == 0 && slot->sequence) {
+        table.pending[0] = c;
+        table.npending = 1;
+        table.pendingmode = mode;
+        table.due = now_ms() + KEYSEQUENCEWAIT;
+        return;
+    }
+
+    table.npending = 0;
+    changes = table.changes;
+
+    for (i = 0; i < slot->count; i++) {
+        this_bind = table.binds[slot->start + i];
+
+        /* the bind must be the keys typed so far, followed by this one */
+        if (this_bind->nkeys < n + 1 || this_bind->keys[n] != c ||
+                memcmp(this_bind->keys, table.pending, n * sizeof(int)) != 0) {
+            continue;
+        }
+
+        if (this_bind->nkeys > n + 1) {
+            started = true;
+            continue;
+        }
+
+        run_bind(this_bind, mode);
+        match = true;
 
-            match = true;
 #ifndef ENABLE_MACROS
-            break;
+        break;
 #endif
-        }
 
-        this_bind = this_bind->next;
+        /* a bind which changed the binds freed what this loop reads */
+        if (table.changes != changes) {
+            break;
+        }
     }
 
-    /* no match found */
-    if (!match) {
+    /* a longer sequence goes on, one which went wrong ends with the keys
+     * typed before this one, which is then handled as if pressed on its own */
+    if (!match && started && n + 1 < KEYSEQUENCELENGTH) {
+        table.pending[n] = c;
+        table.npending = n + 1;
+        table.pendingmode = mode;
+        table.due = now_ms() + KEYSEQUENCEWAIT;
+    } else if (!match && n > 0) {
+        table.npending = n;
+        end_sequence();
+        handle_keypress(c, mode);
+    } else if (!match) {
         keyname = name_key(c);
         statusbar_message(cfg.statusbar_timeout, "unhandled key: %s (%d)", keyname, c);
         free(keyname);
     }
 } /* }}} */
 
+int keys_timeout(void) { /* {{{ */
+    /* get the time until a partly typed key sequence ends in ms
+     * return is -1 if no sequence is being typed
+     */
+    long wait;
+
+    if (table.npending == 0) {
+        return -1;
+    }
+
+    wait = table.due - now_ms();
+
+    return wait > 0 ? wait : 0;
+} /* }}} */
+
 char* name_key(const int val) { /* {{{ */
     /* return a string naming the key */
     char*   name = NULL;
@@ -315,6 +635,27 @@ char* name_key(const int val) { /* {{{ */
     return name;
 } /* }}} */
 
+char* name_keys(const int* keys, const int nkeys) { /* {{{ */
+    /* return a string naming a sequence of keys, separated by commas
+     * keys  - the keys
+     * nkeys - the number of keys
+     */
+    char*   name = name_key(keys[0]);
+    char*   next;
+    char*   tmp;
+    int     i;
+
+    for (i = 1; i < nkeys; i++) {
+        next = name_key(keys[i]);
+        asprintf(&tmp, "%s,%s", name, next);
+        free(name);
+        free(next);
+        name = tmp;
+    }
+
+    return name;
+} /* }}} */
+
 int parse_key(const char* keystr) { /* {{{ */
     /* parse a key value from a string specifier */
     int key;
@@ -336,11 +677,47 @@ int parse_key(const char* keystr) { /* {{{ */
     return (int)(*keystr);
 } /* }}} */
 
-int remove_keybinds(const int key, const enum prog_mode mode) { /* {{{ */
+int parse_keys(const char* keystr, int* keys) { /* {{{ */
+    /**
+     * parse a sequence of keys, separated by commas
+     * a comma on its own, or after another comma, is the comma key
+     * keystr - the string specifying the keys
+     * keys   - where up to KEYSEQUENCELENGTH keys are stored
+     * return is the number of keys, or -1 if there are more than
+     * KEYSEQUENCELENGTH
+     */
+    const char* pos = keystr;
+    const char* end;
+    char*       part;
+    int         n = 0;
+
+    while (*pos != 0) {
+        if (n == KEYSEQUENCELENGTH) {
+            return -1;
+        }
+
+        end = strchr(*pos == ',' ? pos + 1 : pos, ',');
+
+        if (end == NULL) {
+            keys[n++] = parse_key(pos);
+            break;
+        }
+
+        part = strndup(pos, end - pos);
+        keys[n++] = parse_key(part);
+        free(part);
+        pos = end + 1;
+    }
+
+    return n;
+} /* }}} */
+
+int remove_keybinds(const int* keys, const int nkeys, const enum prog_mode mode) { /* {{{ */
     /**
-     * remove all keybinds to key
-     * key  - which key to unbind
-     * mode - what mode to unbind a key in
+     * remove all keybinds to a sequence of keys
+     * keys  - which keys to unbind
+     * nkeys - the number of keys
+     * mode  - what mode to unbind a key in
      */
     int             counter = 0;
     struct keybind* this;
@@ -352,13 +729,15 @@ int remove_keybinds(const int key, const enum prog_mode mode) { /* {{{ */
     while (this != NULL) {
         next = this->next;
 
-        if (this->key == (int)key && this->mode == mode) {
+        if (this->nkeys == nkeys && memcmp(this->keys, keys, nkeys * sizeof(int)) == 0 &&
+                this->mode == mode) {
             if (last != NULL) {
                 last->next = next;
             } else {
                 keybinds = next;
             }
 
+            check_free(this->argstr);
             free(this);
             counter++;
         } else {
@@ -368,7 +747,26 @@ int remove_keybinds(const int key, const enum prog_mode mode) { /* {{{ */
         this = next;
     }
 
+    table.built = false;
+    table.changes++;
+
     return counter;
 } /* }}} */
 
+void run_bind(struct keybind* this_bind, const enum prog_mode mode) { /* {{{ */
+    /**
+     * run the function of a keybind
+     * this_bind - the keybind
+     * mode      - the mode its keys were pressed in
+     */
+    if (this_bind->function == NULL) {
+        return;
+    }
+
+    tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "calling function @%p %s%s(%s)",
+                this_bind->function, mode == MODE_PAGER ? "pager - " : "tasklist - ",
+                this_bind->funcname, this_bind->argstr);
+    (*(this_bind->function))(this_bind->argstr);
+} /* }}} */
+
 // vim: et ts=4 sw=4 sts=4
@@ -4,28 +4,31 @@
  * by mjheagle
  */
 
+#define _GNU_SOURCE
 #include <stdarg.h>
 #include <stdio.h>
 #include <time.h>
 #include "common.h"
 #include "log.h"
 
-void tnc_fprintf(FILE* fp,
-                 const enum log_mode minloglvl,
-                 const char* format,
-                 ...) { /* {{{ */
+/* the timestamp of the last log, formatted once per second
+ * each thread keeps its own, as parse threads may log errors */
+static __thread time_t  stamp = -1;
+static __thread char    timestr[32];
+
+void tnc_log(FILE* fp,
+             const enum log_mode minloglvl,
+             const char* format,
+             ...) { /* {{{ */
     /**
-     * log a message to a file
+     * log a message to a file, called by tnc_fprintf
      * fp        - the file handle to write the log to
      * minloglvl - what cfg.loglvl must be above for this log to be written
      * format    - printf format string for log
      */
     time_t      lt;
-    struct tm*  t;
+    struct tm   t;
     va_list     args;
-    int         ret;
-    const int   timesize = 32;
-    char        timestr[timesize];
 
     /* determine if msg should be logged */
     if (minloglvl > cfg.loglvl) {
@@ -34,11 +37,14 @@ void tnc_fprintf(FILE* fp,
 
     /* get time */
     lt = time(NULL);
-    t = localtime(&lt);
-    ret = strftime(timestr, timesize, "%F %H:%M:%S", t);
 
-    if (ret == 0) {
-        return;
+    if (lt != stamp) {
+        if (localtime_r(&lt, &t) == NULL ||
+                strftime(timestr, sizeof(timestr), "%F %H:%M:%S", &t) == 0) {
+            return;
+        }
+
+        stamp = lt;
     }
 
     /* timestamp */
@@ -0,0 +1,72 @@
+/*
+ * metrics.c - timers and counters of the work done
+ * for tasknc
+ * by mjheagle
+ */
+
+#define _GNU_SOURCE
+#include <limits.h>
+#include <stdio.h>
+#include <time.h>
+#include "common.h"
+#include "log.h"
+#include "metrics.h"
+
+struct metrics metrics;
+
+static const char* phase_names[PHASES] = {"export", "parse", "sort", "filter", "render",
+                                          "spawn"
+                                         };
+static const char* counter_names[COUNTERS] = {"regex compiles", "arena blocks"};
+
+void metrics_count(const enum metric_counter counter) { /* {{{ */
+    /**
+     * count an event
+     * counter - the event which happened
+     */
+    /* counted from worker threads as well */
+    __atomic_fetch_add(metrics.counters + counter, 1, __ATOMIC_RELAXED);
+} /* }}} */
+
+void metrics_dump(void) { /* {{{ */
+    /* write every timer and counter to the log, whatever the log level */
+    int i;
+
+    for (i = 0; i < PHASES; i++) {
+        tnc_fprintf(logfp, LOG_DEFAULT, "metrics: %-14s %8d calls %12lld us",
+                    phase_names[i], metrics.phases[i].calls,
+                    metrics.phases[i].ns / 1000);
+    }
+
+    for (i = 0; i < COUNTERS; i++) {
+        tnc_fprintf(logfp, LOG_DEFAULT, "metrics: %-14s %8d", counter_names[i],
+                    metrics.counters[i]);
+    }
+} /* }}} */
+
+void metrics_end(const enum metric_phase phase, const long long start) { /* {{{ */
+    /**
+     * add a run of a phase to its timer
+     * phase - the phase which ran
+     * start - when it started, as returned by metrics_start
+     */
+    struct phase_timer* timer = metrics.phases + phase;
+
+    timer->ns += metrics_start() - start;
+    timer->us = timer->ns / 1000 < INT_MAX ? (int)(timer->ns / 1000) : INT_MAX;
+    timer->calls++;
+} /* }}} */
+
+long long metrics_start(void) { /* {{{ */
+    /**
+     * read the clock a phase is timed by, which only moves forward
+     * return is the time in nanoseconds
+     */
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+} /* }}} */
+
+// vim: et ts=4 sw=4 sts=4
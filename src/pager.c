@@ -7,10 +7,14 @@
 #define _GNU_SOURCE
 #define _XOPEN_SOURCE
 #include <curses.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include "color.h"
 #include "common.h"
 #include "config.h"
@@ -18,15 +22,84 @@
 #include "keys.h"
 #include "log.h"
 #include "pager.h"
+#include "process.h"
 #include "statusbar.h"
 #include "tasklist.h"
 #include "tasknc.h"
 
+/**
+ * pager text - the lines shown by a pager, kept in one buffer
+ * text      - the lines, each terminated in place of its newline
+ * length    - the length of text
+ * size      - the allocated size of text
+ * partial   - the offset of the line being read, which is not yet complete
+ * starts    - the offset of each complete line in text
+ * nlines    - the number of complete lines
+ * slots     - the allocated length of starts
+ * head_skip - how many lines are not shown at the beginning
+ * tail_skip - how many lines are not shown at the end
+ * fp        - the output of the command the lines are read from, NULL once
+ *             it has all been read or if they are not from a command
+ */
+struct pager_text {
+    char* text;
+    size_t length;
+    size_t size;
+    size_t partial;
+    size_t* starts;
+    int nlines;
+    int slots;
+    int head_skip;
+    int tail_skip;
+    FILE* fp;
+};
+
+/**
+ * view cache entry - the info of a task, kept to show it again while the
+ * task is unchanged
+ * uuid     - the uuid of the task, NULL if the entry is unused
+ * modified - the modification time of the task when its info was read
+ * width    - the terminal width the info was formatted for
+ * used     - when the entry was last shown, by the count of views
+ * text     - the lines of the info
+ */
+struct view_entry {
+    char* uuid;
+    time_t modified;
+    int width;
+    unsigned int used;
+    struct pager_text text;
+};
+
+/**
+ * view cache - the info of the tasks viewed most recently
+ * entries    - the entries, the least recently shown of which is replaced
+ * views      - the count of views, which orders the entries
+ * generation - counts when the cache was cleared, so that info which was
+ *              being shown meanwhile is not stored
+ */
+static struct {
+    struct view_entry entries[VIEWCACHELENGTH];
+    unsigned int views;
+    unsigned int generation;
+} view_cache;
+
 /* local functions */
-static void pager_window(struct line* head,
+static void add_text(struct pager_text* text, const char* str, const size_t len);
+static void end_text(struct pager_text* text);
+static void free_text(struct pager_text* text);
+static bool open_text(struct pager_text* text, const char* cmdstr,
+                      const int head_skip, const int tail_skip);
+static int pager_getch(const struct pager_text* text);
+static void pager_window(struct pager_text* text,
                          const bool fullscreen,
-                         int nlines,
                          char* title);
+static void read_text(struct pager_text* text, const bool block);
+static bool reserve_text(struct pager_text* text, const size_t len);
+static int shown_lines(const struct pager_text* text);
+static void split_lines(struct pager_text* text, size_t from);
+static struct view_entry* view_cache_find(const struct task* tsk);
+static void view_cache_store(const struct task* tsk, struct pager_text* text);
 
 /* global variables */
 int     offset;
@@ -34,30 +107,65 @@ int     height;
 int     linecount;
 bool    pager_done;
 
-void free_lines(struct line* head) { /* {{{ */
-    /* iterate through linked list of lines and free all elements */
-    struct line* cur;
-    struct line* last;
+void add_text(struct pager_text* text, const char* str, const size_t len) { /* {{{ */
+    /**
+     * append a string to the lines of a pager
+     * text - the pager text
+     * str  - the string, whose newlines end lines
+     * len  - the length of str
+     */
+    const size_t from = text->length;
+
+    if (!reserve_text(text, len)) {
+        return;
+    }
+
+    memcpy(text->text + text->length, str, len);
+    text->length += len;
+    split_lines(text, from);
+} /* }}} */
 
-    cur = head;
+void end_text(struct pager_text* text) { /* {{{ */
+    /**
+     * complete the lines of a pager once all of them have been added
+     * text - the pager text
+     */
+    if (text->partial < text->length && reserve_text(text, 1)) {
+        text->text[text->length++] = '\n';
+        split_lines(text, text->length - 1);
+    }
 
-    while (cur != NULL) {
-        last = cur;
-        cur = cur->next;
-        free(last->str);
-        free(last);
+    if (text->fp != NULL) {
+        process_close(text->fp);
+        text->fp = NULL;
     }
+
+    tnc_fprintf(logfp, LOG_DEBUG, "pager: read %d lines (%zu bytes)", text->nlines,
+                text->length);
+} /* }}} */
+
+void free_text(struct pager_text* text) { /* {{{ */
+    /**
+     * release the lines of a pager, and the command they are read from
+     * text - the pager text
+     */
+    if (text->fp != NULL) {
+        process_close(text->fp);
+    }
+
+    free(text->text);
+    free(text->starts);
+    memset(text, 0, sizeof(struct pager_text));
 } /* }}} */
 
 void help_window(void) { /* {{{ */
     /* display a help window */
-    struct line*    head;
-    struct line*    cur;
-    struct line*    last;
-    struct keybind* this;
-    char*           modestr;
-    char*           keyname;
-    static bool     help_running = false;
+    struct pager_text   text;
+    struct keybind*     this;
+    char*               modestr;
+    char*               keyname;
+    char*               str;
+    static bool         help_running = false;
 
     /* check for existing help window */
     if (help_running) {
@@ -69,10 +177,8 @@ void help_window(void) { /* {{{ */
     help_running = true;
 
     /* list keybinds */
-    head = calloc(1, sizeof(struct line));
-    head->str = strdup("keybinds");
-
-    last = head;
+    memset(&text, 0, sizeof(struct pager_text));
+    add_text(&text, "keybinds\n", 9);
     this = keybinds;
 
     while (this != NULL) {
@@ -81,9 +187,6 @@ void help_window(void) { /* {{{ */
             continue;
         }
 
-        cur = calloc(1, sizeof(struct line));
-        last->next = cur;
-
         if (this->mode == MODE_TASKLIST) {
             modestr = "tasklist";
         } else if (this->mode == MODE_PAGER) {
@@ -92,23 +195,23 @@ void help_window(void) { /* {{{ */
             modestr = "unknown ";
         }
 
-        keyname = name_key(this->key);
+        keyname = name_keys(this->keys, this->nkeys);
 
         if (this->argstr == NULL) {
-            asprintf(&(cur->str), "%8s    %-8s    %s", keyname, modestr,
-                     name_function(this->function));
+            asprintf(&str, "%8s    %-8s    %s\n", keyname, modestr, this->funcname);
         } else {
-            asprintf(&(cur->str), "%8s    %-8s    %s %s", keyname, modestr,
-                     name_function(this->function), this->argstr);
+            asprintf(&str, "%8s    %-8s    %s %s\n", keyname, modestr, this->funcname,
+                     this->argstr);
         }
 
+        add_text(&text, str, strlen(str));
+        free(str);
         free(keyname);
         this = this->next;
-        last = cur;
     }
 
-    pager_window(head, 1, -1, " help");
-    free_lines(head);
+    pager_window(&text, 1, " help");
+    free_text(&text);
     help_running = false;
 } /* }}} */
 
@@ -145,6 +248,33 @@ void key_pager_scroll_up(void) { /* {{{ */
     }
 } /* }}} */
 
+bool open_text(struct pager_text* text, const char* cmdstr,
+               const int head_skip, const int tail_skip) { /* {{{ */
+    /**
+     * start a command whose output a pager shows
+     * the output is read as it arrives, between keys
+     * text      - where the pager text is stored
+     * cmdstr    - the command to be run
+     * head_skip - how many lines to skip at the beginning of output
+     * tail_skip - how many lines to skip at the end of output
+     * return is whether the command was started
+     */
+    memset(text, 0, sizeof(struct pager_text));
+    text->head_skip = head_skip;
+    text->tail_skip = tail_skip;
+    text->fp = process_open(cmdstr);
+
+    if (text->fp == NULL) {
+        statusbar_message(cfg.statusbar_timeout, "failed to run command");
+        tnc_fprintf(logfp, LOG_ERROR, "pager: failed to run %s", cmdstr);
+        return false;
+    }
+
+    fcntl(fileno(text->fp), F_SETFL, fcntl(fileno(text->fp), F_GETFL) | O_NONBLOCK);
+
+    return true;
+} /* }}} */
+
 void pager_command(const char* cmdstr,
                    const char* title,
                    const bool fullscreen,
@@ -152,73 +282,71 @@ void pager_command(const char* cmdstr,
                    const int tail_skip) { /* {{{ */
     /**
      * run a command and page through its results
+     * the pager opens once the output fills it, and the rest is read while
+     * it is shown
      * cmdstr     - the command to be run
      * title      - the title of the pager
      * fullscreen - whether the pager should be fullscreen
      * head_skip  - how many lines to skip at the beginning of output
      * tail_skip  - how many lines to skip at the end of output
      */
-    FILE*           cmd;
-    char*           str;
-    int             count = 0;
-    int             maxlen = 0;
-    int             len;
-    struct line*    head = NULL;
-    struct line*    last = NULL;
-    struct line*    cur;
-
-    /* run command, gathering strs into a buffer */
-    cmd = popen(cmdstr, "r");
-    str = calloc(TOTALLENGTH, sizeof(char));
-
-    while (fgets(str, TOTALLENGTH, cmd) != NULL) {
-        /* determine max width */
-        len = strlen(str);
-
-        if (len > maxlen) {
-            maxlen = len;
-        }
+    struct pager_text text;
 
-        /* create line */
-        cur = calloc(1, sizeof(struct line));
-        cur->str = str;
-
-        /* place line in list */
-        if (count == head_skip) {
-            head = cur;
-        } else if (count < head_skip) {
-            free(cur->str);
-            free(cur);
-        } else if (last != NULL) {
-            last->next = cur;
-        }
+    if (!open_text(&text, cmdstr, head_skip, tail_skip)) {
+        return;
+    }
 
-        /* move to next line */
-        str = calloc(256, sizeof(char));
-        count++;
-        last = cur;
+    /* run pager */
+    pager_window(&text, fullscreen, (char*)title);
+
+    /* a command whose output was not all read ends with a closed pipe */
+    free_text(&text);
+} /* }}} */
+
+int pager_getch(const struct pager_text* text) { /* {{{ */
+    /**
+     * wait for a keypress, or for more of the output the pager reads
+     * text - the pager text
+     * return is the key pressed, or ERR
+     */
+    struct pollfd   fds[2];
+    int             timeout = cfg.nc_timeout;
+    int             c;
+
+    /* take input curses has already buffered, which poll does not see */
+    wtimeout(statusbar, 0);
+    c = wgetch(statusbar);
+    wtimeout(statusbar, cfg.nc_timeout);
+
+    if (c != ERR) {
+        return c;
     }
 
-    free(str);
-    pclose(cmd);
-    count -= tail_skip;
+    /* descriptors which are -1 are not polled */
+    fds[0].fd     = STDIN_FILENO;
+    fds[0].events = POLLIN;
+    fds[1].fd     = text->fp != NULL ? fileno(text->fp) : -1;
+    fds[1].events = POLLIN;
 
-    /* run pager */
-    pager_window(head, fullscreen, count, (char*)title);
+    /* a partly typed key sequence ends when it is not continued in time */
+    if (keys_timeout() >= 0) {
+        timeout = timeout < 0 ? keys_timeout() : MIN(timeout, keys_timeout());
+    }
+
+    if (poll(fds, 2, timeout) <= 0 || !(fds[0].revents & POLLIN)) {
+        return ERR;
+    }
 
-    /* free lines */
-    free_lines(head);
+    return wgetch(statusbar);
 } /* }}} */
 
-void pager_window(struct line* head,
+void pager_window(struct pager_text* text,
                   const bool fullscreen,
-                  int nlines,
                   char* title) { /* {{{ */
     /**
-     * page through a linked list of lines
-     * head       - the first line to print
+     * page through lines, reading any which are still to come
+     * text       - the lines to print
      * fullscreen - whether the pager should be fullscreen
-     * nlines     - the number of lines that will be printed
      * title      - the title of the pager
      */
     int             startx;
@@ -226,7 +354,6 @@ void pager_window(struct line* head,
     int             lineno;
     int             c;
     int             taskheight;
-    struct line* tmp;
     offset = 0;
     WINDOW*         last_pager      = NULL;
     const int       orig_offset     = offset;
@@ -238,29 +365,26 @@ void pager_window(struct line* head,
         last_pager = pager;
     }
 
-    /* count lines if necessary */
-    if (nlines <= 0) {
-        tmp = head;
-        nlines = 0;
+    /* read enough lines to fill the pager */
+    taskheight = getmaxy(tasklist);
 
-        while (tmp != NULL) {
-            nlines++;
-            tmp = tmp->next;
-        }
+    while (text->fp != NULL && shown_lines(text) < taskheight) {
+        read_text(text, true);
     }
 
+    linecount = shown_lines(text);
+
     /* exit if there are no lines */
     tnc_fprintf(logfp, LOG_DEBUG, "pager: linecount=%d", linecount);
 
-    if (nlines == 0) {
+    if (linecount == 0) {
+        offset    = orig_offset;
+        height    = orig_height;
+        linecount = orig_linecount;
         return;
     }
 
-    linecount = nlines;
-
     /* determine screen dimensions and create window */
-    taskheight = getmaxy(tasklist);
-
     if (fullscreen) {
         height = taskheight;
         starty = 1;
@@ -285,34 +409,31 @@ void pager_window(struct line* head,
     pager_done = false;
 
     while (1) {
-        tnc_fprintf(logfp, LOG_DEBUG, "offset:%d height:%d lines:%d", offset, height,
-                    linecount);
+        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "offset:%d height:%d lines:%d", offset,
+                    height, linecount);
 
         /* print title */
         wattrset(pager, get_colors(OBJECT_HEADER, NULL, NULL));
-        mvwhline(pager, offset, 0, ' ', cols);
-        umvaddstr_align(pager, offset, title);
+        mvwhline(pager, 0, 0, ' ', cols);
+        umvaddstr_align(pager, 0, title);
 
         /* print lines */
         wattrset(pager, COLOR_PAIR(0));
-        tmp = head;
-        lineno = 1;
 
-        while (tmp != NULL && lineno <= linecount && lineno - offset <= height) {
-            if (lineno > offset) {
-                mvwhline(pager, lineno - offset, 0, ' ', cols);
-                umvaddstr(pager, lineno - offset, 0, tmp->str);
-            }
+        for (lineno = 1; lineno < height; lineno++) {
+            mvwhline(pager, lineno, 0, ' ', cols);
 
-            lineno++;
-            tmp = tmp->next;
+            if (offset + lineno <= linecount) {
+                umvaddstr(pager, lineno, 0, "%s", text->text +
+                          text->starts[text->head_skip + offset + lineno - 1]);
+            }
         }
 
         touchwin(pager);
         wrefresh(pager);
 
         /* accept keys */
-        c = wgetch(statusbar);
+        c = pager_getch(text);
         handle_keypress(c, MODE_PAGER);
 
         if (pager_done) {
@@ -320,6 +441,10 @@ void pager_window(struct line* head,
             break;
         }
 
+        /* take in what more of the output has arrived */
+        read_text(text, false);
+        linecount = shown_lines(text);
+
         statusbar_timeout();
     }
 
@@ -340,6 +465,174 @@ void pager_window(struct line* head,
     linecount = orig_linecount;
 } /* }}} */
 
+void read_text(struct pager_text* text, const bool block) { /* {{{ */
+    /**
+     * read the output of the command a pager shows, as far as it has arrived
+     * text  - the pager text
+     * block - whether to wait for output if none has arrived
+     */
+    struct pollfd   pfd;
+    const size_t    from = text->length;
+    ssize_t         len;
+
+    if (text->fp == NULL) {
+        return;
+    }
+
+    if (block) {
+        pfd.fd     = fileno(text->fp);
+        pfd.events = POLLIN;
+
+        while (poll(&pfd, 1, -1) < 0 && errno == EINTR);
+    }
+
+    if (!reserve_text(text, PAGERREADLENGTH)) {
+        end_text(text);
+        return;
+    }
+
+    len = read(fileno(text->fp), text->text + text->length, PAGERREADLENGTH);
+
+    if (len > 0) {
+        text->length += len;
+        split_lines(text, from);
+    } else if (len == 0 || (errno != EAGAIN && errno != EINTR)) {
+        end_text(text);
+    }
+} /* }}} */
+
+bool reserve_text(struct pager_text* text, const size_t len) { /* {{{ */
+    /**
+     * make room to add to the lines of a pager, and for their terminator
+     * text - the pager text
+     * len  - the length to be added
+     * return is whether there is room
+     */
+    size_t  size = text->size > 0 ? text->size : PAGERTEXTLENGTH;
+    char*   tmp;
+
+    if (text->length + len + 1 <= text->size) {
+        return true;
+    }
+
+    while (text->length + len + 1 > size) {
+        size *= 2;
+    }
+
+    tmp = realloc(text->text, size);
+
+    if (tmp == NULL) {
+        tnc_fprintf(logfp, LOG_ERROR, "pager: failed to allocate %zu bytes", size);
+        return false;
+    }
+
+    text->text = tmp;
+    text->size = size;
+
+    return true;
+} /* }}} */
+
+int shown_lines(const struct pager_text* text) { /* {{{ */
+    /**
+     * count the lines a pager shows
+     * until the output has been read, lines which may end it are not shown
+     * text - the pager text
+     */
+    const int n = text->nlines - text->head_skip - text->tail_skip;
+
+    return n > 0 ? n : 0;
+} /* }}} */
+
+void split_lines(struct pager_text* text, size_t from) { /* {{{ */
+    /**
+     * find the lines completed by text added to a pager
+     * text - the pager text
+     * from - the offset the text was added at
+     */
+    size_t* tmp;
+    char*   end;
+
+    while ((end = memchr(text->text + from, '\n', text->length - from)) != NULL) {
+        if (text->nlines == text->slots) {
+            tmp = realloc(text->starts, (text->slots + PAGERLINESLENGTH) * sizeof(size_t));
+
+            if (tmp == NULL) {
+                return;
+            }
+
+            text->starts = tmp;
+            text->slots += PAGERLINESLENGTH;
+        }
+
+        *end = 0;
+        text->starts[text->nlines++] = text->partial;
+        from = end + 1 - text->text;
+        text->partial = from;
+    }
+} /* }}} */
+
+void view_cache_clear(void) { /* {{{ */
+    /* forget the info of every task, once a command may have changed it */
+    int i;
+
+    for (i = 0; i < VIEWCACHELENGTH; i++) {
+        check_free(view_cache.entries[i].uuid);
+        view_cache.entries[i].uuid = NULL;
+        free_text(&(view_cache.entries[i].text));
+    }
+
+    view_cache.generation++;
+} /* }}} */
+
+struct view_entry* view_cache_find(const struct task* tsk) { /* {{{ */
+    /**
+     * find the stored info of a task, if it is unchanged since it was read
+     * tsk - the task
+     * return is the entry, or NULL if there is none
+     */
+    struct view_entry*  this;
+    int                 i;
+
+    for (i = 0; i < VIEWCACHELENGTH; i++) {
+        this = view_cache.entries + i;
+
+        if (this->uuid != NULL && this->width == cols &&
+                this->modified == tsk->detail->modified &&
+                strcmp(this->uuid, tsk->detail->uuid) == 0) {
+            return this;
+        }
+    }
+
+    return NULL;
+} /* }}} */
+
+void view_cache_store(const struct task* tsk, struct pager_text* text) { /* {{{ */
+    /**
+     * store the info of a task in place of the least recently shown
+     * tsk  - the task
+     * text - the info, which the cache takes
+     */
+    struct view_entry*  this = view_cache.entries;
+    int                 i;
+
+    for (i = 1; i < VIEWCACHELENGTH && this->uuid != NULL; i++) {
+        if (view_cache.entries[i].uuid == NULL ||
+                view_cache.entries[i].used < this->used) {
+            this = view_cache.entries + i;
+        }
+    }
+
+    check_free(this->uuid);
+    free_text(&(this->text));
+
+    this->uuid     = strdup(tsk->detail->uuid);
+    this->modified = tsk->detail->modified;
+    this->width    = cols;
+    this->used     = ++view_cache.views;
+    this->text     = *text;
+    memset(text, 0, sizeof(struct pager_text));
+} /* }}} */
+
 void view_stats(void) { /* {{{ */
     /* run `task stat` and page the output */
     char* cmdstr;
@@ -358,7 +651,7 @@ void view_stats(void) { /* {{{ */
     stats_running = true;
 
     /* run pager */
-    pager_command(cmdstr, title, 1, 1, 4);
+    pager_command(cmdstr, title, 1, 1, 3);
 
     /* clean up */
     stats_running = false;
@@ -366,21 +659,51 @@ void view_stats(void) { /* {{{ */
 } /* }}} */
 
 void view_task(struct task* this) { /* {{{ */
-    /* run `task info` and print it to a window */
-    char* cmdstr;
-    char* title;
+    /**
+     * run `task info` and print it to a window
+     * the info is kept, and shown again at once until the task or the
+     * terminal width changes
+     * this - the task to view
+     */
+    struct pager_text   text;
+    struct view_entry*  entry;
+    char*               cmdstr;
+    char*               title;
+    bool                started;
+    const unsigned int  generation = view_cache.generation;
+
+    /* the entry is taken while it is shown, as commands run meanwhile may
+     * clear the cache */
+    entry = view_cache_find(this);
+
+    if (entry != NULL) {
+        tnc_fprintf(logfp, LOG_DEBUG, "view: info of %s is cached", this->detail->uuid);
+        text = entry->text;
+        memset(&(entry->text), 0, sizeof(struct pager_text));
+        free(entry->uuid);
+        entry->uuid = NULL;
+    } else {
+        asprintf(&cmdstr, "task %s info rc._forcecolor=no rc.defaultwidth=%d 2>&1",
+                 this->detail->uuid, cols - 4);
+        started = open_text(&text, cmdstr, 1, 3);
+        free(cmdstr);
 
-    /* build command and title */
-    asprintf(&cmdstr, "task %s info rc._forcecolor=no rc.defaultwidth=%d 2>&1",
-             this->uuid, cols - 4);
-    title = (char*)eval_format(cfg.formats.view_compiled, this);
+        if (!started) {
+            return;
+        }
+    }
 
     /* run pager */
-    pager_command(cmdstr, title, 0, 1, 4);
-
-    /* clean up */
-    free(cmdstr);
+    title = (char*)eval_format(cfg.formats.view_compiled, this);
+    pager_window(&text, 0, title);
     free(title);
+
+    /* only info which was read to the end, and is still current, is kept */
+    if (text.fp == NULL && generation == view_cache.generation) {
+        view_cache_store(this, &text);
+    }
+
+    free_text(&text);
 } /* }}} */
 
 // vim: et ts=4 sw=4 sts=4
@@ -0,0 +1,515 @@
+/*
+ * process.c - run commands without a shell
+ * for tasknc
+ * by mjheagle
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "common.h"
+#include "log.h"
+#include "metrics.h"
+#include "process.h"
+
+/* characters which need a shell when they are not quoted */
+#define SHELLCHARS              "|&;<>()$`*?[]{}"
+
+/**
+ * parsed command - a command line split into the arguments of a program
+ * argv   - the arguments, NULL terminated
+ * argc   - the number of arguments
+ * merge  - whether stderr is sent to stdout, as by 2>&1
+ * null   - whether stdin is read from /dev/null, as by < /dev/null
+ */
+struct command {
+    char** argv;
+    int argc;
+    bool merge;
+    bool null;
+};
+
+/**
+ * child - a command started by process_open, until process_close reaps it
+ * fp   - the stream its output is read from
+ * pid  - the process id of the command
+ * next - the next child
+ */
+struct child {
+    FILE* fp;
+    pid_t pid;
+    struct child* next;
+};
+
+/**
+ * job - a command queued to run in the background
+ * cmdstr - the command line
+ * done   - called with the return of the command and arg once it exits
+ * arg    - a string passed to done
+ * next   - the job queued after this one
+ */
+struct job {
+    char* cmdstr;
+    void (*done)(const int, const char*);
+    char* arg;
+    struct job* next;
+};
+
+/* commands started by process_open */
+static struct child* children = NULL;
+
+/**
+ * job queue - background commands, which run one at a time in order
+ * first - the running job, followed by the jobs waiting to run
+ * last  - the last job queued
+ * pid   - the process id of the running job
+ * fd    - the pipe the running job's output is read from, -1 if none runs
+ */
+static struct {
+    struct job* first;
+    struct job* last;
+    pid_t pid;
+    int fd;
+} queue = {NULL, NULL, 0, -1};
+
+/* externs */
+extern char** environ;
+
+/* local functions */
+static void add_argument(struct command* cmd, const char* word, const size_t len);
+static void free_command(struct command* cmd);
+static bool parse_command(const char* cmdstr, struct command* cmd);
+static pid_t start_command(const char* cmdstr, int* fd);
+static void start_job(void);
+static bool word_ends(const char c);
+
+void add_argument(struct command* cmd, const char* word, const size_t len) { /* {{{ */
+    /**
+     * append an argument to a parsed command, keeping argv NULL terminated
+     * cmd  - the command
+     * word - the argument
+     * len  - the length of the argument
+     */
+    cmd->argv = realloc(cmd->argv, (cmd->argc + 2) * sizeof(char*));
+    cmd->argv[cmd->argc] = strndup(word, len);
+    cmd->argc++;
+    cmd->argv[cmd->argc] = NULL;
+} /* }}} */
+
+void free_command(struct command* cmd) { /* {{{ */
+    /* free the arguments of a parsed command */
+    int i;
+
+    for (i = 0; i < cmd->argc; i++) {
+        free(cmd->argv[i]);
+    }
+
+    free(cmd->argv);
+    cmd->argv = NULL;
+    cmd->argc = 0;
+} /* }}} */
+
+bool parse_command(const char* cmdstr, struct command* cmd) { /* {{{ */
+    /**
+     * split a command line into arguments as the shell would
+     * quotes and backslashes are handled, as are the 2>&1 and < /dev/null
+     * redirections, anything else the shell would expand or interpret is not
+     * cmdstr - the command line
+     * cmd    - the command the arguments are stored in
+     * return is false if the command line needs a shell to run
+     */
+    const char* pos = cmdstr;
+    char*       word = malloc(strlen(cmdstr) + 1);
+    size_t      len;
+    bool        quoted;
+
+    memset(cmd, 0, sizeof(struct command));
+
+    while (true) {
+        while (*pos == ' ' || *pos == '\t') {
+            pos++;
+        }
+
+        if (*pos == 0) {
+            break;
+        }
+
+        /* redirections */
+        if (str_starts_with(pos, "2>&1") && word_ends(pos[4])) {
+            cmd->merge = true;
+            pos += 4;
+            continue;
+        }
+
+        if (*pos == '<') {
+            for (pos++; *pos == ' ' || *pos == '\t'; pos++);
+
+            if (!str_starts_with(pos, "/dev/null") || !word_ends(pos[9])) {
+                goto shell;
+            }
+
+            cmd->null = true;
+            pos += 9;
+            continue;
+        }
+
+        /* a leading ~ or # is expanded or starts a comment */
+        if (*pos == '~' || *pos == '#') {
+            goto shell;
+        }
+
+        len    = 0;
+        quoted = false;
+
+        while (!word_ends(*pos)) {
+            if (*pos == '\'') {
+                for (pos++; *pos != '\''; pos++) {
+                    if (*pos == 0) {
+                        goto shell;
+                    }
+
+                    word[len++] = *pos;
+                }
+
+                pos++;
+                quoted = true;
+            } else if (*pos == '"') {
+                for (pos++; *pos != '"'; pos++) {
+                    if (*pos == 0 || *pos == '$' || *pos == '`') {
+                        goto shell;
+                    }
+
+                    if (*pos == '\\' && pos[1] != 0 && strchr("\\\"$`", pos[1]) != NULL) {
+                        pos++;
+                    }
+
+                    word[len++] = *pos;
+                }
+
+                pos++;
+                quoted = true;
+            } else if (*pos == '\\') {
+                if (pos[1] == 0 || pos[1] == '\n') {
+                    goto shell;
+                }
+
+                word[len++] = pos[1];
+                pos += 2;
+            } else if (strchr(SHELLCHARS, *pos) != NULL || *pos == '\n') {
+                goto shell;
+            } else {
+                /* variable assignments before the program are for the shell */
+                if (*pos == '=' && cmd->argc == 0 && !quoted) {
+                    goto shell;
+                }
+
+                word[len++] = *pos++;
+            }
+        }
+
+        add_argument(cmd, word, len);
+    }
+
+    free(word);
+
+    return cmd->argc > 0;
+
+shell:
+    free(word);
+    free_command(cmd);
+
+    return false;
+} /* }}} */
+
+int process_close(FILE* fp) { /* {{{ */
+    /**
+     * close the output of a command started by process_open and wait for it
+     * fp - the stream returned by process_open
+     * return is the wait status of the command, as from pclose
+     */
+    struct child**  link;
+    struct child*   this;
+    int             status = -1;
+
+    for (link = &children; *link != NULL && (*link)->fp != fp; link = &((*link)->next));
+
+    this = *link;
+    fclose(fp);
+
+    if (this == NULL) {
+        return -1;
+    }
+
+    *link = this->next;
+
+    while (waitpid(this->pid, &status, 0) < 0 && errno == EINTR);
+
+    free(this);
+
+    return status;
+} /* }}} */
+
+int process_fd(void) { /* {{{ */
+    /* get the descriptor to wait on for a background command to exit
+     * return is -1 if no background command runs
+     */
+    return queue.fd;
+} /* }}} */
+
+void process_flush(void) { /* {{{ */
+    /* wait for every queued background command to complete */
+    struct pollfd pfd;
+
+    while (queue.first != NULL) {
+        if (queue.fd >= 0) {
+            pfd.fd     = queue.fd;
+            pfd.events = POLLIN;
+            poll(&pfd, 1, -1);
+        }
+
+        process_poll();
+    }
+} /* }}} */
+
+FILE* process_open(const char* cmdstr) { /* {{{ */
+    /**
+     * start a command and read its output, like popen(cmdstr, "r")
+     * queued background commands are completed first, so commands always
+     * run in the order they were issued
+     * cmdstr - the command line
+     * return is the stream of the command's output, or NULL on failure
+     */
+    struct child*   this;
+    pid_t           pid;
+    int             fd;
+    FILE*           fp;
+
+    process_flush();
+
+    pid = start_command(cmdstr, &fd);
+
+    if (pid < 0) {
+        return NULL;
+    }
+
+    fp = fdopen(fd, "r");
+
+    if (fp == NULL) {
+        close(fd);
+        waitpid(pid, NULL, 0);
+        return NULL;
+    }
+
+    this = calloc(1, sizeof(struct child));
+    this->fp   = fp;
+    this->pid  = pid;
+    this->next = children;
+    children   = this;
+
+    return fp;
+} /* }}} */
+
+bool process_pending(void) { /* {{{ */
+    /* check whether any background command is queued or running */
+    return queue.first != NULL;
+} /* }}} */
+
+void process_poll(void) { /* {{{ */
+    /* log the output of the running background command without blocking,
+     * and once it has exited, report its return and start the next one */
+    struct job* this = queue.first;
+    char        buffer[1024];
+    ssize_t     len;
+    int         status;
+    int         ret;
+
+    if (this == NULL) {
+        return;
+    }
+
+    /* the job could not be started */
+    if (queue.fd < 0) {
+        ret = 127;
+    } else {
+        while ((len = read(queue.fd, buffer, sizeof(buffer) - 1)) > 0) {
+            buffer[len] = 0;
+            tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "%s", buffer);
+        }
+
+        /* the job is still running */
+        if (len < 0 && (errno == EAGAIN || errno == EINTR)) {
+            return;
+        }
+
+        close(queue.fd);
+
+        while (waitpid(queue.pid, &status, 0) < 0 && errno == EINTR);
+
+        ret = process_status(status);
+    }
+
+    tnc_fprintf(logfp, LOG_DEBUG, "background command returned: %d", ret);
+
+    /* start the next job before reporting, as the report may run commands */
+    queue.first = this->next;
+
+    if (queue.first == NULL) {
+        queue.last = NULL;
+    }
+
+    queue.fd  = -1;
+    queue.pid = 0;
+    start_job();
+
+    if (this->done != NULL) {
+        this->done(ret, this->arg);
+    }
+
+    free(this->cmdstr);
+    check_free(this->arg);
+    free(this);
+} /* }}} */
+
+void process_queue(const char* cmdstr, void (*done)(const int, const char*),
+                 const char* arg) { /* {{{ */
+    /**
+     * run a command in the background, after those already queued
+     * cmdstr - the command line
+     * done   - called with the return of the command and arg once it exits,
+     *          from process_poll (may be NULL)
+     * arg    - a string passed to done (may be NULL)
+     */
+    struct job* this = calloc(1, sizeof(struct job));
+
+    this->cmdstr = strdup(cmdstr);
+    this->done   = done;
+    this->arg    = arg != NULL ? strdup(arg) : NULL;
+
+    if (queue.last != NULL) {
+        queue.last->next = this;
+    } else {
+        queue.first = this;
+    }
+
+    queue.last = this;
+
+    if (queue.first == this) {
+        start_job();
+    }
+} /* }}} */
+
+int process_status(const int status) { /* {{{ */
+    /**
+     * convert the wait status of a command to its return
+     * a command killed by a closed pipe, after its output was no longer
+     * wanted, is considered successful
+     * status - the wait status
+     */
+    if (status < 0) {
+        return -1;
+    } else if (WIFSIGNALED(status)) {
+        return WTERMSIG(status) == SIGPIPE ? 0 : 128 + WTERMSIG(status);
+    } else if (WEXITSTATUS(status) == 128 + SIGPIPE) {
+        return 0;
+    }
+
+    return WEXITSTATUS(status);
+} /* }}} */
+
+pid_t start_command(const char* cmdstr, int* fd) { /* {{{ */
+    /**
+     * start a command with its output sent to a pipe
+     * the program is run directly when the command line can be parsed,
+     * otherwise, or if it can not be found, it is run by /bin/sh
+     * cmdstr - the command line
+     * fd     - where the read end of the pipe is stored
+     * return is the process id of the command, or -1 on failure
+     */
+    posix_spawn_file_actions_t  actions;
+    struct command              cmd;
+    char*                       shell[] = {"/bin/sh", "-c", (char*) cmdstr, NULL};
+    int                         pipefd[2];
+    pid_t                       pid;
+    int                         err = -1;
+    bool                        parsed;
+    const long long             start = metrics_start();
+
+    if (pipe2(pipefd, O_CLOEXEC) != 0) {
+        tnc_fprintf(logfp, LOG_ERROR, "could not create a pipe for: %s", cmdstr);
+        return -1;
+    }
+
+    parsed = parse_command(cmdstr, &cmd);
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, pipefd[1], STDOUT_FILENO);
+
+    if (parsed && cmd.merge) {
+        posix_spawn_file_actions_adddup2(&actions, pipefd[1], STDERR_FILENO);
+    }
+
+    if (parsed && cmd.null) {
+        posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    }
+
+    if (parsed) {
+        err = posix_spawnp(&pid, cmd.argv[0], &actions, NULL, cmd.argv, environ);
+        free_command(&cmd);
+    }
+
+    if (err != 0) {
+        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "running with a shell: %s", cmdstr);
+        err = posix_spawn(&pid, shell[0], &actions, NULL, shell, environ);
+    }
+
+    posix_spawn_file_actions_destroy(&actions);
+    close(pipefd[1]);
+    metrics_end(PHASE_SPAWN, start);
+
+    if (err != 0) {
+        tnc_fprintf(logfp, LOG_ERROR, "could not execute command: %s", cmdstr);
+        close(pipefd[0]);
+        return -1;
+    }
+
+    *fd = pipefd[0];
+
+    return pid;
+} /* }}} */
+
+void start_job(void) { /* {{{ */
+    /* start the first queued background command, if none is running */
+    int fd;
+
+    if (queue.first == NULL || queue.fd >= 0) {
+        return;
+    }
+
+    tnc_fprintf(logfp, LOG_DEBUG, "running background command: %s", queue.first->cmdstr);
+    queue.pid = start_command(queue.first->cmdstr, &fd);
+
+    if (queue.pid < 0) {
+        queue.pid = 0;
+        return;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    queue.fd = fd;
+} /* }}} */
+
+bool word_ends(const char c) { /* {{{ */
+    /* check whether a character ends an unquoted word */
+    return c == 0 || c == ' ' || c == '\t';
+} /* }}} */
+
+// vim: et ts=4 sw=4 sts=4
@@ -0,0 +1,326 @@
+/*
+ * search.c - searching the task list
+ * for tasknc
+ * by mjheagle
+ */
+
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "config.h"
+#include "index.h"
+#include "log.h"
+#include "search.h"
+#include "tasks.h"
+
+/* characters which give a pattern a meaning other than its literal text */
+#define REGEXCHARS ".[]()*+?{}|^$\\"
+
+/**
+ * search text - the searched fields of every task in the position index,
+ * folded to lower case and joined, so literal patterns need no regex
+ * text    - each task's project, description and tags, each ending in '\n'
+ * length  - the length of text
+ * size    - the allocated size of text
+ * starts  - the offset of each task's fields in text, by line
+ * ntasks  - the number of tasks in starts
+ * version - the version of the position index the text was built from
+ * built   - whether the text has been built
+ */
+static struct {
+    char* text;
+    size_t length;
+    size_t size;
+    size_t* starts;
+    int ntasks;
+    unsigned int version;
+    bool built;
+} corpus;
+
+/**
+ * match set - the lines of the task list matching the last pattern searched
+ * pattern - the pattern, NULL if there has been no search
+ * lines   - the lines which match, in order
+ * nlines  - the number of lines which match
+ * version - the version of the position index the lines were found in
+ */
+static struct {
+    char* pattern;
+    int* lines;
+    int nlines;
+    unsigned int version;
+} matches;
+
+/* local functions */
+static void add_field(const char* field);
+static void build_corpus(void);
+static void build_matches(const char* pattern);
+static bool fold_literal(const char* pattern, char* folded);
+static int task_at_offset(const size_t offset);
+
+void add_field(const char* field) { /* {{{ */
+    /**
+     * append a task field to the search text, folded to lower case
+     * field - the field (may be NULL)
+     */
+    size_t  len = field != NULL ? strlen(field) : 0;
+    size_t  size;
+    char*   tmp;
+    char*   pos;
+
+    if (corpus.length + len + 1 > corpus.size) {
+        size = corpus.size + len + 1 + SEARCHTEXTLENGTH;
+        tmp = realloc(corpus.text, size);
+
+        if (tmp == NULL) {
+            return;
+        }
+
+        corpus.text = tmp;
+        corpus.size = size;
+    }
+
+    for (pos = corpus.text + corpus.length; len > 0; len--, field++, pos++) {
+        *pos = *field >= 'A' && *field <= 'Z' ? *field - 'A' + 'a' : *field;
+    }
+
+    *pos = '\n';
+    corpus.length = pos + 1 - corpus.text;
+} /* }}} */
+
+void build_corpus(void) { /* {{{ */
+    /* rebuild the search text if the task list changed since it was built */
+    struct task*    cur;
+    size_t*         tmp;
+    int             n = index_length();
+    int             i;
+
+    if (corpus.built && corpus.version == index_version()) {
+        return;
+    }
+
+    tmp = realloc(corpus.starts, (n + 1) * sizeof(size_t));
+
+    if (tmp == NULL) {
+        return;
+    }
+
+    corpus.starts = tmp;
+    corpus.length = 0;
+
+    for (i = 0; i < n; i++) {
+        cur = index_get(i);
+        corpus.starts[i] = corpus.length;
+        add_field(cur->project);
+        add_field(cur->detail->description);
+        add_field(cur->detail->tags);
+    }
+
+    corpus.starts[n] = corpus.length;
+    corpus.ntasks    = n;
+    corpus.version   = index_version();
+    corpus.built     = true;
+} /* }}} */
+
+void build_matches(const char* pattern) { /* {{{ */
+    /**
+     * find every line of the task list a pattern matches, unless they were
+     * already found for the current task list
+     * pattern - the pattern, matched as by task_match
+     */
+    const regex_t*  regex;
+    char*           folded;
+    char*           found;
+    int*            tmp;
+    size_t          len = strlen(pattern);
+    size_t          offset = 0;
+    int             n = index_length();
+    int             line;
+
+    if (matches.pattern != NULL && matches.version == index_version() &&
+            strcmp(matches.pattern, pattern) == 0) {
+        return;
+    }
+
+    check_free(matches.pattern);
+    matches.pattern = strdup(pattern);
+    matches.version = index_version();
+    matches.nlines  = 0;
+    tmp = realloc(matches.lines, (n + 1) * sizeof(int));
+
+    if (tmp == NULL) {
+        return;
+    }
+
+    matches.lines = tmp;
+    folded = malloc(len + 1);
+
+    /* a literal pattern is found in the folded text of the whole list, a
+     * task at a time, as a case insensitive regex would match it */
+    if (folded != NULL && fold_literal(pattern, folded)) {
+        build_corpus();
+
+        while (len > 0 && offset < corpus.length &&
+                (found = memmem(corpus.text + offset, corpus.length - offset,
+                                folded, len)) != NULL) {
+            line = task_at_offset(found - corpus.text);
+            matches.lines[matches.nlines++] = line;
+            offset = corpus.starts[line + 1];
+        }
+
+        /* an empty pattern matches every task */
+        for (line = 0; len == 0 && line < n; line++) {
+            matches.lines[matches.nlines++] = line;
+        }
+    } else {
+        regex = regex_get(pattern, REGEX_OPTS);
+
+        for (line = 0; regex != NULL && line < n; line++) {
+            if (task_match_regex(index_get(line), regex)) {
+                matches.lines[matches.nlines++] = line;
+            }
+        }
+    }
+
+    free(folded);
+    tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "search: %d tasks match %s",
+                matches.nlines, pattern);
+} /* }}} */
+
+bool fold_literal(const char* pattern, char* folded) { /* {{{ */
+    /**
+     * fold a pattern to lower case, if it matches only its literal text
+     * patterns which are not ascii are left to the regex, which folds the
+     * case of multibyte characters
+     * pattern - the pattern
+     * folded  - where the folded pattern is stored, as long as pattern
+     * return is whether the pattern is literal
+     */
+    const char* pos;
+
+    for (pos = pattern; *pos != 0; pos++, folded++) {
+        if ((unsigned char)*pos >= 0x80 || strchr(REGEXCHARS, *pos) != NULL) {
+            return false;
+        }
+
+        *folded = *pos >= 'A' && *pos <= 'Z' ? *pos - 'A' + 'a' : *pos;
+    }
+
+    *folded = 0;
+
+    return true;
+} /* }}} */
+
+int search_find(const char* pattern, const int from, const int direction,
+                bool* wrapped) { /* {{{ */
+    /**
+     * find the next line of the task list matching a pattern
+     * pattern   - the pattern, matched as by task_match
+     * from      - the line to search from, which is only matched after
+     *             wrapping around the task list
+     * direction - 1 to search down the list, -1 to search up
+     * wrapped   - where whether the search wrapped around the end of the
+     *             task list is stored (may be NULL)
+     * return is the line found, or -1 if no task matches
+     */
+    int lo = 0;
+    int hi;
+    int mid;
+
+    if (wrapped != NULL) {
+        *wrapped = false;
+    }
+
+    build_matches(pattern);
+
+    if (matches.nlines == 0) {
+        return -1;
+    }
+
+    /* find the first match after from */
+    hi = matches.nlines;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+
+        if (matches.lines[mid] <= from) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    /* going up, take the last match before from instead */
+    if (direction < 0) {
+        lo--;
+
+        if (lo >= 0 && matches.lines[lo] == from) {
+            lo--;
+        }
+    }
+
+    if (lo < 0 || lo >= matches.nlines) {
+        if (wrapped != NULL) {
+            *wrapped = true;
+        }
+
+        lo = lo < 0 ? matches.nlines - 1 : 0;
+    }
+
+    return matches.lines[lo];
+} /* }}} */
+
+void search_free(void) { /* {{{ */
+    /* release the search text and match set */
+    free(corpus.text);
+    free(corpus.starts);
+    memset(&corpus, 0, sizeof(corpus));
+
+    check_free(matches.pattern);
+    free(matches.lines);
+    memset(&matches, 0, sizeof(matches));
+} /* }}} */
+
+int search_matches(const char* pattern, const int** lines) { /* {{{ */
+    /**
+     * find every line of the task list matching a pattern
+     * pattern - the pattern, matched as by task_match
+     * lines   - where the lines are stored, in order, which stay valid until
+     *           the next search (may be NULL)
+     * return is the number of lines which match
+     */
+    build_matches(pattern);
+
+    if (lines != NULL) {
+        *lines = matches.lines;
+    }
+
+    return matches.nlines;
+} /* }}} */
+
+int task_at_offset(const size_t offset) { /* {{{ */
+    /**
+     * find the line of the task whose fields hold an offset of the search text
+     * offset - the offset
+     */
+    int lo = 0;
+    int hi = corpus.ntasks;
+    int mid;
+
+    /* find the last task starting at or before the offset */
+    while (hi - lo > 1) {
+        mid = (lo + hi) / 2;
+
+        if (corpus.starts[mid] <= offset) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+} /* }}} */
+
+// vim: et ts=4 sw=4 sts=4
@@ -0,0 +1,426 @@
+/*
+ * snapshot.c - on-disk cache of the parsed task list
+ * for tasknc
+ * by mjheagle
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "common.h"
+#include "config.h"
+#include "intern.h"
+#include "log.h"
+#include "snapshot.h"
+#include "tasks.h"
+
+/* identification of the snapshot format, bumped with its layout */
+#define SNAPSHOTMAGIC           "tncsnap"
+#define SNAPSHOTVERSION         3
+
+/**
+ * snapshot header - the start of a snapshot file
+ * it is followed by ntasks records, in display order, then the string table
+ * magic    - SNAPSHOTMAGIC
+ * version  - SNAPSHOTVERSION
+ * ntasks   - the number of task records
+ * strings  - the length of the string table
+ * filter   - the filter the task list was loaded with
+ * sortmode - the sort mode the task list is ordered by
+ * stamp    - the state of the data files when the export was started
+ * strings are stored as an offset into the string table plus 1, 0 is NULL
+ */
+struct snapshot_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t ntasks;
+    uint64_t strings;
+    uint32_t filter;
+    uint32_t sortmode;
+    struct snapshot_stamp stamp;
+};
+
+/* snapshot record - the data of a task, as in struct task and its detail */
+struct snapshot_record {
+    time_t start;
+    time_t end;
+    time_t entry;
+    time_t due;
+    time_t modified;
+    double urgency;
+    uint32_t uuid;
+    uint32_t tags;
+    uint32_t project;
+    uint32_t description;
+    uint32_t annotations;
+    uint32_t nannotations;
+    uint32_t index;
+    char priority;
+    char status;
+    unsigned char uuidkey[UUIDKEYLENGTH];
+};
+
+/**
+ * string table - a growing buffer of null terminated strings
+ * data   - the strings
+ * length - the number of bytes used
+ * size   - the allocated size of data
+ */
+struct string_table {
+    char* data;
+    size_t length;
+    size_t size;
+};
+
+/* externs */
+extern struct config cfg;
+
+/* local functions */
+static bool offset_valid(const uint32_t offset, const uint64_t strings);
+static char* snapshot_path(void);
+static char* snapshot_string(char* strings, const uint32_t offset);
+static uint32_t string_table_add(struct string_table* table, const char* str);
+static bool string_eq(const char* a, const char* b);
+
+bool offset_valid(const uint32_t offset, const uint64_t strings) { /* {{{ */
+    /* check that a string offset of a snapshot points into its string table */
+    return offset <= strings;
+} /* }}} */
+
+char* snapshot_path(void) { /* {{{ */
+    /* return the malloc'd path of the snapshot file */
+    char* path;
+
+    asprintf(&path, SNAPSHOTFILE, getenv("USER"));
+
+    return path;
+} /* }}} */
+
+struct task* snapshot_read(struct arena* arena, const char* filter, void** map,
+                           size_t* maplen) { /* {{{ */
+    /**
+     * map the snapshot and rebuild the task list it holds
+     * the snapshot is only used if it was written by this user for the
+     * filter and sort mode, and the data files have not changed
+     * arena  - the arena the tasks are allocated from
+     * filter - the filter the task list is loaded with
+     * map    - where the mapping is stored, the task strings point into it
+     * maplen - where the length of the mapping is stored
+     * return is the first task, or NULL if there is no valid snapshot
+     */
+    struct snapshot_header*         header;
+    const struct snapshot_record*   records;
+    const struct snapshot_record*   rec;
+    struct snapshot_stamp           stamp;
+    struct stat                     st;
+    struct task*                    first = NULL;
+    struct task*                    last = NULL;
+    struct task*                    tsk;
+    struct task_detail*             detail;
+    char*                           path;
+    char*                           base;
+    char*                           strings;
+    uint32_t                        i;
+    int                             fd;
+
+    path = snapshot_path();
+    fd = open(path, O_RDONLY);
+    free(path);
+
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (fstat(fd, &st) != 0 || st.st_uid != getuid() ||
+            (size_t)st.st_size < sizeof(struct snapshot_header)) {
+        close(fd);
+        return NULL;
+    }
+
+    base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+
+    /* validate header */
+    header = (struct snapshot_header*)base;
+    records = (const struct snapshot_record*)(base + sizeof(struct snapshot_header));
+    strings = (char*)(records + header->ntasks);
+    snapshot_stamp(&stamp);
+
+    if (memcmp(header->magic, SNAPSHOTMAGIC, sizeof(SNAPSHOTMAGIC)) != 0 ||
+            header->version != SNAPSHOTVERSION || header->ntasks == 0 ||
+            header->strings == 0 || header->strings > (uint64_t)st.st_size ||
+            header->ntasks > (st.st_size - sizeof(struct snapshot_header)) /
+            sizeof(struct snapshot_record) ||
+            sizeof(struct snapshot_header) + header->ntasks * sizeof(struct snapshot_record) +
+            header->strings != (uint64_t)st.st_size ||
+            strings[header->strings - 1] != 0 ||
+            !offset_valid(header->filter, header->strings) ||
+            !offset_valid(header->sortmode, header->strings)) {
+        tnc_fprintf(logfp, LOG_DEBUG, "snapshot is malformed");
+        goto invalid;
+    }
+
+    if (memcmp(&(header->stamp), &stamp, sizeof(stamp)) != 0 ||
+            !string_eq(snapshot_string(strings, header->filter), filter) ||
+            !string_eq(snapshot_string(strings, header->sortmode), cfg.sortmode)) {
+        tnc_fprintf(logfp, LOG_DEBUG, "snapshot is out of date");
+        goto invalid;
+    }
+
+    /* build tasks */
+    for (i = 0; i < header->ntasks; i++) {
+        rec = records + i;
+
+        if (rec->uuid == 0 || rec->description == 0 ||
+                !offset_valid(rec->uuid, header->strings) ||
+                !offset_valid(rec->tags, header->strings) ||
+                !offset_valid(rec->project, header->strings) ||
+                !offset_valid(rec->description, header->strings) ||
+                !offset_valid(rec->annotations, header->strings)) {
+            tnc_fprintf(logfp, LOG_DEBUG, "snapshot task %u is malformed", i);
+            goto invalid;
+        }
+
+        tsk = malloc_task(arena);
+
+        if (tsk == NULL) {
+            goto invalid;
+        }
+
+        tsk->index          = rec->index;
+        tsk->start          = rec->start;
+        tsk->due            = rec->due;
+        tsk->project        = snapshot_string(strings, rec->project);
+        tsk->priority       = rec->priority;
+        memcpy(tsk->uuidkey, rec->uuidkey, UUIDKEYLENGTH);
+
+        detail               = tsk->detail;
+        detail->uuid         = snapshot_string(strings, rec->uuid);
+        detail->description  = snapshot_string(strings, rec->description);
+        detail->tags         = snapshot_string(strings, rec->tags);
+        detail->annotations  = snapshot_string(strings, rec->annotations);
+        detail->entry        = rec->entry;
+        detail->end          = rec->end;
+        detail->modified     = rec->modified;
+        detail->urgency      = rec->urgency;
+        detail->nannotations = rec->nannotations;
+        detail->status       = rec->status;
+        intern_task(tsk, arena);
+
+        tsk->prev = last;
+
+        if (last == NULL) {
+            first = tsk;
+        } else {
+            last->next = tsk;
+        }
+
+        last = tsk;
+    }
+
+    tnc_fprintf(logfp, LOG_DEBUG, "read %u tasks from snapshot", header->ntasks);
+    *map = base;
+    *maplen = st.st_size;
+
+    return first;
+
+invalid:
+    munmap(base, st.st_size);
+
+    return NULL;
+} /* }}} */
+
+void snapshot_stamp(struct snapshot_stamp* stamp) { /* {{{ */
+    /* record the current state of the taskwarrior data files
+     * stamp - where the state is stored
+     */
+    struct stat st;
+    char*       dir = data_location();
+    char*       path;
+    int         i;
+
+    memset(stamp, 0, sizeof(struct snapshot_stamp));
+
+    for (i = 0; i < DATAFILES; i++) {
+        asprintf(&path, "%s/%s", dir, data_files[i]);
+
+        if (stat(path, &st) == 0) {
+            stamp->mtime[i] = st.st_mtim.tv_sec;
+            stamp->nsec[i]  = st.st_mtim.tv_nsec;
+            stamp->size[i]  = st.st_size;
+        }
+
+        free(path);
+    }
+
+    free(dir);
+} /* }}} */
+
+char* snapshot_string(char* strings, const uint32_t offset) { /* {{{ */
+    /* resolve a string offset of a snapshot, 0 is NULL */
+    return offset == 0 ? NULL : strings + offset - 1;
+} /* }}} */
+
+bool snapshot_write(struct task* first, const char* filter,
+                    const struct snapshot_stamp* stamp) { /* {{{ */
+    /**
+     * write the task list to the snapshot file
+     * the file is replaced atomically so a reader never sees a partial one
+     * first  - the first task of the sorted task list
+     * filter - the filter the task list was exported with
+     * stamp  - the state of the data files when the task list was exported
+     * return is whether the snapshot was written
+     */
+    struct snapshot_header  header;
+    struct snapshot_record  rec;
+    struct string_table     table = {NULL, 0, 0};
+    struct task*            cur;
+    struct task_detail*     detail;
+    size_t                  n;
+    uint32_t                ntasks = 0;
+    FILE*                   fp;
+    char*                   path;
+    char*                   tmppath;
+    bool                    ret = false;
+    int                     fd;
+
+    path = snapshot_path();
+    asprintf(&tmppath, "%s.XXXXXX", path);
+    fd = mkstemp(tmppath);
+
+    if (fd < 0 || (fp = fdopen(fd, "w")) == NULL) {
+        tnc_fprintf(logfp, LOG_ERROR, "could not create snapshot %s", tmppath);
+
+        if (fd >= 0) {
+            close(fd);
+            unlink(tmppath);
+        }
+
+        goto done;
+    }
+
+    for (cur = first; cur != NULL; cur = cur->next) {
+        ntasks++;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOTMAGIC, sizeof(SNAPSHOTMAGIC));
+    header.version  = SNAPSHOTVERSION;
+    header.ntasks   = ntasks;
+    header.filter   = string_table_add(&table, filter);
+    header.sortmode = string_table_add(&table, cfg.sortmode);
+    header.stamp    = *stamp;
+
+    /* the header is rewritten once the string table is complete */
+    n = fwrite(&header, sizeof(header), 1, fp);
+
+    for (cur = first; cur != NULL && n == 1; cur = cur->next) {
+        memset(&rec, 0, sizeof(rec));
+        detail           = cur->detail;
+        rec.index        = cur->index;
+        rec.start        = cur->start;
+        rec.due          = cur->due;
+        rec.project      = string_table_add(&table, cur->project);
+        rec.priority     = cur->priority;
+        rec.uuid         = string_table_add(&table, detail->uuid);
+        rec.description  = string_table_add(&table, detail->description);
+        rec.tags         = string_table_add(&table, detail->tags);
+        rec.annotations  = string_table_add(&table, detail->annotations);
+        rec.entry        = detail->entry;
+        rec.end          = detail->end;
+        rec.modified     = detail->modified;
+        rec.urgency      = detail->urgency;
+        rec.nannotations = detail->nannotations;
+        rec.status       = detail->status;
+        memcpy(rec.uuidkey, cur->uuidkey, UUIDKEYLENGTH);
+        n = fwrite(&rec, sizeof(rec), 1, fp);
+    }
+
+    header.strings = table.length;
+
+    if (n != 1 || table.data == NULL ||
+            fwrite(table.data, table.length, 1, fp) != 1 ||
+            fseek(fp, 0, SEEK_SET) != 0 ||
+            fwrite(&header, sizeof(header), 1, fp) != 1) {
+        tnc_fprintf(logfp, LOG_ERROR, "could not write snapshot %s", tmppath);
+        fclose(fp);
+        unlink(tmppath);
+        goto done;
+    }
+
+    if (fclose(fp) != 0 || rename(tmppath, path) != 0) {
+        tnc_fprintf(logfp, LOG_ERROR, "could not replace snapshot %s", path);
+        unlink(tmppath);
+        goto done;
+    }
+
+    tnc_fprintf(logfp, LOG_DEBUG, "wrote %u tasks to snapshot %s", ntasks, path);
+    ret = true;
+
+done:
+    free(table.data);
+    free(tmppath);
+    free(path);
+
+    return ret;
+} /* }}} */
+
+bool string_eq(const char* a, const char* b) { /* {{{ */
+    /* compare two strings, either of which may be NULL */
+    if (a == NULL || b == NULL) {
+        return a == b;
+    }
+
+    return str_eq(a, b);
+} /* }}} */
+
+uint32_t string_table_add(struct string_table* table, const char* str) { /* {{{ */
+    /**
+     * copy a string into a string table
+     * table - the string table
+     * str   - the string to add (may be NULL)
+     * return is the offset of the string plus 1, or 0 for NULL or on failure
+     */
+    size_t  len;
+    size_t  size;
+    char*   tmp;
+    uint32_t ret;
+
+    if (str == NULL) {
+        return 0;
+    }
+
+    len = strlen(str) + 1;
+
+    if (table->length + len > table->size) {
+        for (size = table->size > 0 ? table->size : EXPORTLENGTH;
+                size < table->length + len; size *= 2);
+
+        tmp = realloc(table->data, size);
+
+        if (tmp == NULL) {
+            return 0;
+        }
+
+        table->data = tmp;
+        table->size = size;
+    }
+
+    memcpy(table->data + table->length, str, len);
+    ret = table->length + 1;
+    table->length += len;
+
+    return ret;
+} /* }}} */
+
+// vim: et ts=4 sw=4 sts=4
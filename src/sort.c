@@ -4,118 +4,477 @@
  * by mjheagle
  */
 
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 #include "common.h"
+#include "config.h"
+#include "index.h"
+#include "intern.h"
+#include "metrics.h"
 #include "sort.h"
 
-/* local functions */
-static bool compare_tasks(const struct task* a,
-                          const struct task* b,
-                          const char* mode_queue);
+/* fields a task list can be sorted by */
+enum sort_field {
+    SORT_DUE,
+    SORT_INDEX,
+    SORT_PRIORITY,
+    SORT_PROJECT,
+    SORT_UUID
+};
+
+/**
+ * sort key - one compiled component of a sort mode
+ * field  - the field compared
+ * invert - whether the order of this field is reversed
+ */
+struct sort_key {
+    enum sort_field field;
+    bool invert;
+};
+
+/**
+ * sort entry - a task and its precomputed sort keys
+ * task     - the task being sorted
+ * due      - the due date of the task
+ * project  - the rank of the task's project among all projects, or -1 if
+ *            projects have not been ranked (they are then compared by name)
+ * priority - the priority of the task as a number
+ * index    - the index of the task
+ */
+struct sort_entry {
+    struct task* task;
+    time_t due;
+    int project;
+    int priority;
+    unsigned int index;
+};
+
+/**
+ * project name - a distinct project name found while ranking projects
+ * name   - the project name
+ * number - the symbol id of the name
+ */
+struct project_name {
+    const char* name;
+    int number;
+};
+
+/**
+ * sort part - a share of a parallel sort, which sorts a run of entries or
+ * merges two sorted runs
+ * src     - the entries
+ * dst     - where the merged entries are stored, or scratch space for a sort
+ * lo      - the first entry
+ * mid     - the first entry of the second run of a merge, or -1 for a sort
+ * hi      - the entry after the last
+ * keys    - the compiled sort mode
+ * nkeys   - the number of sort keys
+ * thread  - the thread doing the work
+ * started - whether the thread was started
+ */
+struct sort_part {
+    struct sort_entry* src;
+    struct sort_entry* dst;
+    int lo;
+    int mid;
+    int hi;
+    const struct sort_key* keys;
+    int nkeys;
+    pthread_t thread;
+    bool started;
+};
 
+/* local functions */
+static int compare_entries(const struct sort_entry* a,
+                           const struct sort_entry* b,
+                           const struct sort_key* keys,
+                           const int nkeys);
+static int compare_project_names(const void* a, const void* b);
+static int compile_sort_mode(const char* mode, struct sort_key* keys);
+static void fill_entry(struct sort_entry* entry, struct task* tsk);
+static int find_line(struct task* tsk, const int skip);
+static struct task* link_line(struct task* first, struct task* tsk, const int line);
+static void merge_runs(const struct sort_entry* src,
+                       struct sort_entry* dst,
+                       const int lo,
+                       const int mid,
+                       const int hi,
+                       const struct sort_key* keys,
+                       const int nkeys);
+static void merge_sort(struct sort_entry* entries,
+                       struct sort_entry* tmp,
+                       const int n,
+                       const struct sort_key* keys,
+                       const int nkeys);
+static void parallel_sort(struct sort_entry* entries,
+                          struct sort_entry* tmp,
+                          const int n,
+                          const struct sort_key* keys,
+                          const int nkeys,
+                          const int nthreads);
 static int priority_to_int(const char pri);
-static void sort_tasks(struct task* first, struct task* last);
-static void swap_tasks(struct task* a, struct task* b);
-
-bool compare_tasks(const struct task* a,
-                   const struct task* b,
-                   const char* mode_queue) { /* {{{ */
+static void rank_projects(struct sort_entry* entries, const int n);
+static void run_parts(struct sort_part* parts, const int nparts);
+static void* sort_worker(void* arg);
+
+int compare_entries(const struct sort_entry* a,
+                    const struct sort_entry* b,
+                    const struct sort_key* keys,
+                    const int nkeys) { /* {{{ */
     /**
      * compare two tasks to determine order
-     * a return of 1 means that the tasks should be swapped (b comes before a)
-     * a          - the first task to be compared
-     * b          - the second task to be compared
-     * mode_queue - the remaining tests to be evaluated
+     * a     - the first task to be compared
+     * b     - the second task to be compared
+     * keys  - the compiled sort mode
+     * nkeys - the number of sort keys
+     * return is negative if a comes before b, positive if b comes before a
+     * and 0 if they are equal according to every sort key
      */
-    bool    ret = false;
-    int     tmp;
-    int     pri0;
-    int     pri1;
-    char    sort_mode = *mode_queue;
-    bool    invert = false;
-
-    /* check for inverted order */
-    if (sort_mode >= 'A' && sort_mode <= 'Z') {
-        sort_mode += 32;
-        invert = true;
-    }
+    int i;
+    int ret;
 
-    /* determine sort algorithm and apply it */
-    switch (sort_mode) {
-    case 'n':       // sort by index
-        if (XOR(invert, a->index < b->index)) {
-            ret = true;
-        }
+    for (i = 0; i < nkeys; i++) {
+        switch (keys[i].field) {
+        case SORT_INDEX:
+            ret = (a->index > b->index) - (a->index < b->index);
+            break;
 
-        break;
+        case SORT_PROJECT:
+            /* tasks without a project come first in either order */
+            if (a->task->project == NULL || b->task->project == NULL) {
+                ret = (b->task->project == NULL) - (a->task->project == NULL);
+                goto next;
+            }
 
-    case 'p':       // sort by project name
-        if (a->project == NULL) {
-            if (b->project != NULL) {
-                ret = true;
+            if (a->project >= 0 && b->project >= 0) {
+                ret = a->project - b->project;
+            } else if (a->task->projectid != NOSYMBOL &&
+                       a->task->projectid == b->task->projectid) {
+                ret = 0;
+            } else {
+                ret = strcmp(a->task->project, b->task->project);
             }
 
             break;
-        }
 
-        if (b->project == NULL) {
+        case SORT_DUE:
+            /* tasks without a due date come last in either order */
+            if (a->due == 0 || b->due == 0) {
+                ret = (a->due == 0) - (b->due == 0);
+                goto next;
+            }
+
+            ret = (a->due > b->due) - (a->due < b->due);
+            break;
+
+        case SORT_PRIORITY:
+            ret = b->priority - a->priority;
+            break;
+
+        case SORT_UUID:
+        default:
+            ret = strcmp(a->task->detail->uuid, b->task->detail->uuid);
             break;
         }
 
-        tmp = strcmp(a->project, b->project);
+        if (keys[i].invert) {
+            ret = -ret;
+        }
+
+next:
 
-        if (XOR(invert, tmp < 0)) {
-            ret = true;
+        if (ret != 0) {
+            return ret;
         }
+    }
+
+    return 0;
+} /* }}} */
+
+int compare_project_names(const void* a, const void* b) { /* {{{ */
+    /* qsort comparison of two project names */
+    return strcmp(((const struct project_name*)a)->name,
+                  ((const struct project_name*)b)->name);
+} /* }}} */
+
+int compile_sort_mode(const char* mode, struct sort_key* keys) { /* {{{ */
+    /**
+     * compile a sort mode string into sort keys
+     * each character of the mode is a field, capitalized to invert its order
+     * compiling stops at the first character which is not a sort field
+     * mode - the sort mode string
+     * keys - where the SORTKEYS keys (at most) are stored
+     * return is the number of keys compiled
+     */
+    int     n;
+    char    c;
 
-        if (tmp == 0) {
-            ret = compare_tasks(a, b, mode_queue + 1);
+    for (n = 0; mode != NULL && mode[n] != 0 && n < SORTKEYS; n++) {
+        c = mode[n];
+        keys[n].invert = c >= 'A' && c <= 'Z';
+
+        if (keys[n].invert) {
+            c += 32;
         }
 
-        break;
+        switch (c) {
+        case 'd':
+            keys[n].field = SORT_DUE;
+            break;
 
-    case 'd':       // sort by due date
-        if (a->due == 0) {
-            if (b->due == 0) {
-                ret = compare_tasks(a, b, mode_queue + 1);
-            }
+        case 'n':
+            keys[n].field = SORT_INDEX;
+            break;
 
+        case 'p':
+            keys[n].field = SORT_PROJECT;
             break;
-        } else if (b->due == 0) {
-            ret = true;
+
+        case 'r':
+            keys[n].field = SORT_PRIORITY;
+            break;
+
+        case 'u':
+            keys[n].field = SORT_UUID;
             break;
-        } else if (XOR(invert, a->due < b->due)) {
-            ret = true;
+
+        default:
+            return n;
         }
+    }
 
-        break;
+    return n;
+} /* }}} */
+
+void fill_entry(struct sort_entry* entry, struct task* tsk) { /* {{{ */
+    /**
+     * compute the sort keys of a task, leaving its project unranked
+     * entry - the entry to fill in
+     * tsk   - the task
+     */
+    entry->task     = tsk;
+    entry->due      = tsk->due;
+    entry->project  = -1;
+    entry->priority = priority_to_int(tsk->priority);
+    entry->index    = tsk->index;
+} /* }}} */
 
-    case 'r':       // sort by priority
-        pri0 = priority_to_int(a->priority);
-        pri1 = priority_to_int(b->priority);
+int find_line(struct task* tsk, const int skip) { /* {{{ */
+    /**
+     * binary search the position index for the line a task sorts to
+     * tsk  - the task to place
+     * skip - a line to search as if its task was not in the list, or -1
+     * return is the line, after any equal tasks
+     */
+    struct sort_key     keys[SORTKEYS];
+    struct sort_entry   entry;
+    struct sort_entry   other;
+    int                 nkeys;
+    int                 lo = 0;
+    int                 hi = index_length() - (skip >= 0 ? 1 : 0);
+    int                 mid;
+
+    nkeys = compile_sort_mode(cfg.sortmode, keys);
+    fill_entry(&entry, tsk);
+
+    /* without a sort mode, tasks keep their line or go last */
+    if (nkeys == 0) {
+        return skip >= 0 ? skip : hi;
+    }
 
-        if (pri0 == pri1) {
-            ret = compare_tasks(a, b, mode_queue + 1);
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        fill_entry(&other, index_get(skip >= 0 && mid >= skip ? mid + 1 : mid));
+
+        if (compare_entries(&other, &entry, keys, nkeys) <= 0) {
+            lo = mid + 1;
         } else {
-            ret = XOR(invert, pri0 > pri1);
+            hi = mid;
         }
+    }
 
-        break;
+    return lo;
+} /* }}} */
 
-    case 'u':       // sort by uuid
-        if (XOR(invert, strcmp(a->uuid, b->uuid) < 0)) {
-            ret = true;
+struct task* link_line(struct task* first, struct task* tsk, const int line) { /* {{{ */
+    /**
+     * link a task into the list between its neighbours in the position index
+     * first - the first task of the list
+     * tsk   - the task, which is already at its line in the index
+     * line  - the line of the task
+     * return is the first task of the list
+     */
+    struct task* prev = index_get(line - 1);
+    struct task* next = index_get(line + 1);
+
+    tsk->prev = prev;
+    tsk->next = next;
+
+    if (prev != NULL) {
+        prev->next = tsk;
+    } else {
+        first = tsk;
+    }
+
+    if (next != NULL) {
+        next->prev = tsk;
+    }
+
+    return first;
+} /* }}} */
+
+void merge_runs(const struct sort_entry* src,
+                struct sort_entry* dst,
+                const int lo,
+                const int mid,
+                const int hi,
+                const struct sort_key* keys,
+                const int nkeys) { /* {{{ */
+    /**
+     * merge two adjacent sorted runs of entries
+     * src   - the entries holding the runs
+     * dst   - where the merged run is stored, at the same positions
+     * lo    - the first entry of the first run
+     * mid   - the first entry of the second run
+     * hi    - the entry after the last of the second run
+     * keys  - the compiled sort mode
+     * nkeys - the number of sort keys
+     */
+    int i;
+    int j;
+    int k;
+
+    /* runs that are already in order are copied as they are,
+     * which makes sorting a nearly sorted list close to linear */
+    if (mid == hi || compare_entries(src + mid - 1, src + mid, keys, nkeys) <= 0) {
+        memcpy(dst + lo, src + lo, (hi - lo) * sizeof(struct sort_entry));
+        return;
+    }
+
+    /* merge, taking from the left run on ties to keep the sort stable */
+    for (i = lo, j = mid, k = lo; k < hi; k++) {
+        if (j >= hi || (i < mid && compare_entries(src + i, src + j, keys, nkeys) <= 0)) {
+            dst[k] = src[i++];
+        } else {
+            dst[k] = src[j++];
         }
+    }
+} /* }}} */
 
-        break;
+void merge_sort(struct sort_entry* entries,
+                struct sort_entry* tmp,
+                const int n,
+                const struct sort_key* keys,
+                const int nkeys) { /* {{{ */
+    /**
+     * stable bottom-up merge sort of the sort entries
+     * entries - the entries to sort, which hold the sorted entries on return
+     * tmp     - scratch space for n entries
+     * n       - the number of entries
+     * keys    - the compiled sort mode
+     * nkeys   - the number of sort keys
+     */
+    struct sort_entry*  src = entries;
+    struct sort_entry*  dst = tmp;
+    struct sort_entry*  swap;
+    int                 width;
+    int                 lo;
+    int                 mid;
+    int                 hi;
+
+    for (width = 1; width < n; width *= 2) {
+        for (lo = 0; lo < n; lo += 2 * width) {
+            mid = lo + width < n ? lo + width : n;
+            hi  = lo + 2 * width < n ? lo + 2 * width : n;
+            merge_runs(src, dst, lo, mid, hi, keys, nkeys);
+        }
 
-    case 0:
-    default:
-        return false;
-        break;
+        swap = src;
+        src  = dst;
+        dst  = swap;
     }
 
-    return ret;
+    if (src != entries) {
+        memcpy(entries, src, n * sizeof(struct sort_entry));
+    }
+} /* }}} */
+
+void parallel_sort(struct sort_entry* entries,
+                   struct sort_entry* tmp,
+                   const int n,
+                   const struct sort_key* keys,
+                   const int nkeys,
+                   const int nthreads) { /* {{{ */
+    /**
+     * stable merge sort of the sort entries, shared between threads
+     * each thread sorts a run of the entries, then pairs of runs are merged
+     * in parallel until one is left
+     * entries  - the entries to sort, which hold the sorted entries on return
+     * tmp      - scratch space for n entries
+     * n        - the number of entries
+     * keys     - the compiled sort mode
+     * nkeys    - the number of sort keys
+     * nthreads - the number of threads, and of runs, at most MAXTHREADS
+     */
+    struct sort_part    parts[MAXTHREADS];
+    int                 bounds[MAXTHREADS + 1];
+    struct sort_entry*  src = entries;
+    struct sort_entry*  dst = tmp;
+    struct sort_entry*  swap;
+    int                 nruns = nthreads;
+    int                 nparts;
+    int                 i;
+
+    for (i = 0; i <= nruns; i++) {
+        bounds[i] = (int)((long long)n * i / nruns);
+    }
+
+    /* sort each run in place */
+    for (i = 0; i < nruns; i++) {
+        parts[i] = (struct sort_part) {
+            entries, tmp, bounds[i], -1, bounds[i + 1], keys, nkeys, 0, false
+        };
+    }
+
+    run_parts(parts, nruns);
+
+    /* merge pairs of runs, a run left without a partner is copied over */
+    while (nruns > 1) {
+        nparts = nruns / 2;
+
+        for (i = 0; i < nparts; i++) {
+            parts[i] = (struct sort_part) {
+                src, dst, bounds[2 * i], bounds[2 * i + 1], bounds[2 * i + 2], keys, nkeys, 0,
+                false
+            };
+        }
+
+        if (nruns % 2 == 1) {
+            memcpy(dst + bounds[nruns - 1], src + bounds[nruns - 1],
+                   (bounds[nruns] - bounds[nruns - 1]) * sizeof(struct sort_entry));
+        }
+
+        run_parts(parts, nparts);
+
+        for (i = 0; i < nparts; i++) {
+            bounds[i + 1] = bounds[2 * i + 2];
+        }
+
+        if (nruns % 2 == 1) {
+            bounds[nparts + 1] = bounds[nruns];
+        }
+
+        nruns = nparts + nruns % 2;
+        swap  = src;
+        src   = dst;
+        dst   = swap;
+    }
+
+    if (src != entries) {
+        memcpy(entries, src, n * sizeof(struct sort_entry));
+    }
 } /* }}} */
 
 int priority_to_int(const char pri) { /* {{{ */
@@ -140,125 +499,221 @@ int priority_to_int(const char pri) { /* {{{ */
     }
 } /* }}} */
 
-void sort_wrapper(struct task* first) { /* {{{ */
+void rank_projects(struct sort_entry* entries, const int n) { /* {{{ */
     /**
-     * a wrapper around sort_tasks that finds the last element
-     * in the linked list to pass to the aforementioned function
+     * give every entry the rank of its project among the distinct projects
+     * so projects are compared as integers while sorting
+     * projects are told apart by their symbol ids, so only the distinct names
+     * are compared
+     * entries - the entries to rank, whose project field is filled in
+     * n       - the number of entries
      */
-    struct task* last;
+    struct project_name*    names;
+    int*                    ranks;
+    int                     nnames = 0;
+    int                     i;
+    unsigned int            id;
+    const unsigned int      nids = intern_count();
+
+    names = malloc((n + 1) * sizeof(struct project_name));
+    ranks = malloc((nids + 1) * sizeof(int));
+
+    if (names == NULL || ranks == NULL) {
+        free(names);
+        free(ranks);
+        return;
+    }
+
+    for (id = 0; id < nids; id++) {
+        ranks[id] = -1;
+    }
 
-    /* loop through looking for last item */
-    last = first;
+    /* collect distinct projects, numbered in the order they are found */
+    for (i = 0; i < n; i++) {
+        id = entries[i].task->projectid;
 
-    while (last->next != NULL) {
-        last = last->next;
+        if (id != NOSYMBOL && id < nids && ranks[id] < 0) {
+            names[nnames].name   = intern_name(id);
+            names[nnames].number = id;
+            ranks[id] = nnames++;
+        }
     }
 
-    /* run sort with last value */
-    sort_tasks(first, last);
-} /* }}} */
+    /* sort the distinct names, then give each entry its project's rank
+     * projects which are not interned are left to be compared by name */
+    qsort(names, nnames, sizeof(struct project_name), compare_project_names);
 
-void sort_tasks(struct task* first,
-                struct task* last) { /* {{{ */
-    /* sort a list of tasks from first to last */
-    struct task* start;
-    struct task* cur;
-    struct task* oldcur;
+    for (i = 0; i < nnames; i++) {
+        ranks[names[i].number] = i;
+    }
 
-    /* check if we are done */
-    if (first == last) {
-        return;
+    for (i = 0; i < n; i++) {
+        id = entries[i].task->projectid;
+        entries[i].project = id != NOSYMBOL && id < nids ? ranks[id] : -1;
     }
 
-    /* set start and current */
-    start = first;
-    cur = start->next;
+    free(ranks);
+    free(names);
+} /* }}} */
+
+void run_parts(struct sort_part* parts, const int nparts) { /* {{{ */
+    /**
+     * do the parts of a parallel sort, each in a thread of its own
+     * the last part is done by this thread, as are those a thread could not
+     * be started for
+     * parts  - the parts
+     * nparts - the number of parts
+     */
+    int i;
+
+    for (i = 0; i < nparts - 1; i++) {
+        parts[i].started = pthread_create(&(parts[i].thread), NULL, sort_worker,
+                                          parts + i) == 0;
 
-    /* iterate through to right end, sorting as we go */
-    while (1) {
-        if (compare_tasks(start, cur, cfg.sortmode)) {
-            swap_tasks(start, cur);
+        if (!parts[i].started) {
+            sort_worker(parts + i);
         }
+    }
 
-        if (cur == last) {
-            break;
+    sort_worker(parts + nparts - 1);
+
+    for (i = 0; i < nparts - 1; i++) {
+        if (parts[i].started) {
+            pthread_join(parts[i].thread, NULL);
         }
+    }
+} /* }}} */
+
+struct task* sort_insert(struct task* first, struct task* tsk) { /* {{{ */
+    /**
+     * add a task to the list at its place in the sort order
+     * the place is found by a binary search of the position index, then the
+     * task is linked in O(1)
+     * ties are placed after equal tasks
+     * first - the first task of the list
+     * tsk   - the task to add, which must not be in the list
+     * return is the first task of the list
+     */
+    int line = find_line(tsk, -1);
+
+    index_insert(line, tsk);
 
-        cur = cur->next;
+    return link_line(first, tsk, line);
+} /* }}} */
+
+struct task* sort_reposition(struct task* first,
+                             struct task* old,
+                             struct task* tsk) { /* {{{ */
+    /**
+     * replace a task with its reloaded version at its place in the sort order
+     * the place is found by a binary search of the position index, so only
+     * O(log n) comparisons are made, then the task is relinked in O(1)
+     * ties are placed after equal tasks
+     * first - the first task of the list
+     * old   - the task being replaced, which is in the list and its indexes
+     * tsk   - the replacement, which must have the same uuid
+     * return is the first task of the list
+     */
+    int from = old->position;
+    int line = find_line(tsk, from);
+
+    /* unlink the old task */
+    if (old->prev != NULL) {
+        old->prev->next = old->next;
+    } else {
+        first = old->next;
     }
 
-    /* swap first and cur */
-    swap_tasks(first, cur);
+    if (old->next != NULL) {
+        old->next->prev = old->prev;
+    }
 
-    /* save this cur */
-    oldcur = cur;
+    index_reposition(from, line, tsk);
 
-    /* sort left side */
-    cur = cur->prev;
+    return link_line(first, tsk, line);
+} /* }}} */
 
-    if (cur != NULL) {
-        if ((first->prev != cur) && (cur->next != first)) {
-            sort_tasks(first, cur);
-        }
+struct task* sort_tasks(struct task* first) { /* {{{ */
+    /**
+     * sort a task list according to the active sort mode
+     * the sort mode is compiled once and each task's sort keys are computed
+     * once, then the list is sorted stably and relinked in its new order
+     * first - the first task of the list
+     * return is the first task of the sorted list
+     */
+    struct sort_key     keys[SORTKEYS];
+    struct sort_entry*  entries;
+    struct task*        cur;
+    int                 nkeys;
+    int                 nthreads;
+    int                 n = 0;
+    int                 i;
+    long long           start;
+
+    nkeys = compile_sort_mode(cfg.sortmode, keys);
+
+    if (first == NULL || nkeys == 0) {
+        return first;
     }
 
-    /* sort right side */
-    cur = oldcur->next;
+    start = metrics_start();
 
-    if (cur != NULL) {
-        if ((cur->prev != last) && (last->next != cur)) {
-            sort_tasks(cur, last);
-        }
+    /* count tasks */
+    for (cur = first; cur != NULL; cur = cur->next) {
+        n++;
+    }
+
+    entries = malloc(2 * n * sizeof(struct sort_entry));
+
+    if (entries == NULL) {
+        return first;
+    }
+
+    /* precompute sort keys */
+    for (cur = first, i = 0; cur != NULL; cur = cur->next, i++) {
+        fill_entry(entries + i, cur);
+    }
+
+    rank_projects(entries, n);
+
+    /* sort, in parallel if there are enough tasks for it to pay */
+    nthreads = n >= PARALLELSORTLENGTH ? thread_count() : 1;
+
+    if (nthreads > 1) {
+        parallel_sort(entries, entries + n, n, keys, nkeys, nthreads);
+    } else {
+        merge_sort(entries, entries + n, n, keys, nkeys);
+    }
+
+    /* relink list in sorted order */
+    for (i = 0; i < n; i++) {
+        entries[i].task->prev = i > 0 ? entries[i - 1].task : NULL;
+        entries[i].task->next = i < n - 1 ? entries[i + 1].task : NULL;
     }
+
+    first = entries[0].task;
+    free(entries);
+    metrics_end(PHASE_SORT, start);
+
+    return first;
 } /* }}} */
 
-void swap_tasks(struct task* a,
-                struct task* b) { /* {{{ */
-    /* swap the contents of two tasks */
-    unsigned short  ustmp;
-    unsigned int    uitmp;
-    char*           strtmp;
-    char            ctmp;
-
-    ustmp    = a->index;
-    a->index = b->index;
-    b->index = ustmp;
-
-    strtmp  = a->uuid;
-    a->uuid = b->uuid;
-    b->uuid = strtmp;
-
-    strtmp  = a->tags;
-    a->tags = b->tags;
-    b->tags = strtmp;
-
-    uitmp    = a->start;
-    a->start = b->start;
-    b->start = uitmp;
-
-    uitmp  = a->end;
-    a->end = b->end;
-    b->end = uitmp;
-
-    uitmp    = a->entry;
-    a->entry = b->entry;
-    b->entry = uitmp;
-
-    uitmp  = a->due;
-    a->due = b->due;
-    b->due = uitmp;
-
-    strtmp     = a->project;
-    a->project = b->project;
-    b->project = strtmp;
-
-    ctmp        = a->priority;
-    a->priority = b->priority;
-    b->priority = ctmp;
-
-    strtmp         = a->description;
-    a->description = b->description;
-    b->description = strtmp;
+void* sort_worker(void* arg) { /* {{{ */
+    /**
+     * do a part of a parallel sort
+     * arg - the part
+     */
+    struct sort_part* part = arg;
+
+    if (part->mid < 0) {
+        merge_sort(part->src + part->lo, part->dst + part->lo, part->hi - part->lo,
+                   part->keys, part->nkeys);
+    } else {
+        merge_runs(part->src, part->dst, part->lo, part->mid, part->hi, part->keys,
+                   part->nkeys);
+    }
+
+    return NULL;
 } /* }}} */
 
 // vim: et ts=4 sw=4 sts=4
@@ -245,12 +245,26 @@ int statusbar_getstr(char** str, const char* msg) { /* {{{ */
      * str - where the string to be stored
      * msg - the prompt message
      */
+    return statusbar_getstr_live(str, msg, NULL);
+} /* }}} */
+
+int statusbar_getstr_live(char** str, const char* msg,
+                          void (*update)(const char*)) { /* {{{ */
+    /**
+     * get a string from user input (like readline), following it as it is typed
+     * str    - where the string to be stored
+     * msg    - the prompt message
+     * update - the function to pass the string to each time it is edited,
+     *          before the prompt is drawn again (may be NULL)
+     */
     int                         position = 0;
     int                         histindex = -1;
     int                         str_len = 0;
     int                         charlen;
     int                         ret;
     bool                        done = false;
+    bool                        edited;
+    char*                       partial;
     const int                   msglen = strlen(msg);
     const struct prompt_index*  pindex = get_prompt_index(msg);
     wchar_t*                    tmp;
@@ -275,13 +289,17 @@ int statusbar_getstr(char** str, const char* msg) { /* {{{ */
             continue;
         }
 
+        edited = true;
+
         switch (c) {
         case ERR:
+            edited = false;
             break;
 
         case '\r':
         case '\n':
             done = true;
+            edited = false;
             break;
 
         case 21: /* C-u (discard line) */
@@ -334,10 +352,12 @@ int statusbar_getstr(char** str, const char* msg) { /* {{{ */
 
         case KEY_LEFT:
             position = position > 0 ? position - 1 : 0;
+            edited = false;
             break;
 
         case KEY_RIGHT:
             position = wstr[position] != 0 ? position + 1 : position;
+            edited = false;
             break;
 
         case KEY_UP:
@@ -361,10 +381,12 @@ int statusbar_getstr(char** str, const char* msg) { /* {{{ */
 
         case KEY_HOME:
             position = 0;
+            edited = false;
             break;
 
         case KEY_END:
             position = str_len;
+            edited = false;
             break;
 
         default:
@@ -373,6 +395,15 @@ int statusbar_getstr(char** str, const char* msg) { /* {{{ */
             str_len++;
             break;
         }
+
+        /* pass the string as it now stands to be followed */
+        if (update != NULL && edited) {
+            charlen = wcstombs(NULL, wstr, 0) + 1;
+            partial = calloc(charlen, sizeof(char));
+            wcstombs(partial, wstr, charlen);
+            update(partial);
+            free(partial);
+        }
     }
 
     /* convert wchar_t to char */
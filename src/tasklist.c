@@ -9,15 +9,19 @@
 #define _GNU_SOURCE
 
 #include <curses.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 #include "color.h"
 #include "common.h"
 #include "config.h"
 #include "formats.h"
+#include "frame.h"
+#include "index.h"
 #include "keys.h"
 #include "log.h"
 #include "sort.h"
@@ -26,42 +30,79 @@
 #include "tasknc.h"
 #include "tasks.h"
 #include "pager.h"
+#include "process.h"
+#include "search.h"
+#include "watch.h"
+
+/* the line selected when the search being typed was started */
+static int search_origin = 0;
 
 /* local functions */
 void tasklist_command_message(const int ret,
                               const char* fail,
                               const char* success);
+static void tasklist_batch_command(const char* cmd, const char* fail,
+                                   const char* success);
+static void tasklist_completed(const int ret, const char* uuid);
+static void tasklist_deleted(const int ret, const char* uuid);
+static int tasklist_getch(void);
+static bool tasklist_keys_waiting(void);
+static void tasklist_queue_command(const struct task* tsk, const char* cmd,
+                                   void (*done)(const int, const char*));
+static void tasklist_reconcile(const int ret, const char* uuid,
+                               const char* fail, const char* success);
+static void tasklist_search_preview(const char* pattern);
+static void tasklist_started(const int ret, const char* uuid);
+static void tasklist_stopped(const int ret, const char* uuid);
 
 void key_tasklist_add(void) { /* {{{ */
     /* handle a keyboard direction to add new task */
     tasklist_task_add();
-    reload = 1;
+    reload_changed = true;
 } /* }}} */
 
 void key_tasklist_complete(void) { /* {{{ */
-    /* complete selected task */
+    /* complete selected task, or the marked tasks if there are any
+     * the task is removed from the list at once, while the command runs in
+     * the background and is reported by tasklist_completed
+     */
     struct task* cur = get_task_by_position(selline);
-    int          ret;
 
-    statusbar_message(cfg.statusbar_timeout, "completing task");
+    if (task_marks() > 0) {
+        tasklist_batch_command("done", "complete failed (%d)", "complete successful");
+        return;
+    }
 
-    ret = task_background_command("task %s done");
+    if (cur == NULL) {
+        return;
+    }
+
+    tasklist_queue_command(cur, "done", tasklist_completed);
     tasklist_remove_task(cur);
 
-    tasklist_command_message(ret, "complete failed (%d)", "complete successful");
+    statusbar_message(cfg.statusbar_timeout, "completing task");
 } /* }}} */
 
 void key_tasklist_delete(void) { /* {{{ */
-    /* complete selected task */
+    /* delete selected task, or the marked tasks if there are any
+     * the task is removed from the list at once, while the command runs in
+     * the background and is reported by tasklist_deleted
+     */
     struct task* cur = get_task_by_position(selline);
-    int          ret;
 
-    statusbar_message(cfg.statusbar_timeout, "deleting task");
+    if (task_marks() > 0) {
+        tasklist_batch_command("delete", "delete failed (%d)", "delete successful");
+        return;
+    }
+
+    if (cur == NULL) {
+        return;
+    }
 
-    ret = task_background_command("task %s delete");
+    tasklist_queue_command(cur, "delete", tasklist_deleted);
     tasklist_remove_task(cur);
 
-    tasklist_command_message(ret, "delete failed (%d)", "delete successful");
+    statusbar_message(cfg.statusbar_timeout, "deleting task");
 } /* }}} */
 
 void key_tasklist_edit(void) { /* {{{ */
@@ -73,7 +114,7 @@ void key_tasklist_edit(void) { /* {{{ */
     statusbar_message(cfg.statusbar_timeout, "editing task");
 
     ret = task_interactive_command("task %s edit");
-    uuid = strdup(cur->uuid);
+    uuid = strdup(cur->detail->uuid);
     reload_task(cur);
 
     if (cfg.follow_task) {
@@ -91,6 +132,9 @@ void key_tasklist_filter(const char* arg) { /* {{{ */
      * arg - string to filter by (pass NULL to prompt user)
      *       see the manual page for how filter strings are parsed
      */
+    struct task*    cur = get_task_by_position(selline);
+    char*           uuid = NULL;
+
     check_free(active_filter);
 
     if (arg == NULL) {
@@ -100,17 +144,83 @@ void key_tasklist_filter(const char* arg) { /* {{{ */
         active_filter = strdup(arg);
     }
 
-    /* force reload of task list */
     statusbar_message(cfg.statusbar_timeout, "filter applied");
-    reload = true;
+
+    /* a filter narrowing down the loaded tasks applies at once,
+     * any other forces a reload of the task list */
+    if (cur != NULL) {
+        uuid = strdup(cur->detail->uuid);
+    }
+
+    if (task_filter(active_filter)) {
+        if (cfg.follow_task) {
+            set_position_by_uuid(uuid);
+        }
+
+        tasklist_check_curs_pos();
+        redraw = true;
+    } else {
+        reload = true;
+    }
+
+    check_free(uuid);
+} /* }}} */
+
+void key_tasklist_mark(void) { /* {{{ */
+    /* toggle the mark of the selected task, then move to the next task */
+    struct task* cur = get_task_by_position(selline);
+
+    if (cur == NULL) {
+        return;
+    }
+
+    task_mark(cur, !cur->marked);
+    frame_damage(selline, 1);
+
+    if (selline < taskcount - 1) {
+        key_tasklist_scroll_down();
+    }
+
+    statusbar_message(cfg.statusbar_timeout, "%d tasks marked", task_marks());
+} /* }}} */
+
+void key_tasklist_mark_matching(const char* arg) { /* {{{ */
+    /* handle a keyboard direction to mark the tasks matching a pattern
+     * arg - the pattern to match (pass NULL to prompt user)
+     *       tasks are matched like searches are
+     */
+    const int*  lines;
+    char*       pattern;
+    int         n;
+    int         i;
+
+    if (arg == NULL) {
+        statusbar_getstr(&pattern, "mark matching: ");
+        wipe_statusbar();
+    } else {
+        pattern = strdup(arg);
+    }
+
+    n = search_matches(pattern, &lines);
+
+    for (i = 0; i < n; i++) {
+        task_mark(index_get(lines[i]), true);
+    }
+
+    free(pattern);
+
+    statusbar_message(cfg.statusbar_timeout, "%d tasks marked", task_marks());
+    redraw = true;
 } /* }}} */
 
 void key_tasklist_modify(const char* arg) { /* {{{ */
     /* handle a keyboard direction to modify a task
      * arg - the modifications to apply (pass NULL to prompt user)
      *       this will be appended to `task UUID modify `
+     *       the marked tasks are modified instead if there are any
      */
     char* argstr;
+    char* cmd;
 
     if (arg == NULL) {
         statusbar_getstr(&argstr, "modify: ");
@@ -119,6 +229,14 @@ void key_tasklist_modify(const char* arg) { /* {{{ */
         argstr = strdup(arg);
     }
 
+    if (task_marks() > 0) {
+        asprintf(&cmd, "modify %s", argstr != NULL ? argstr : "");
+        tasklist_batch_command(cmd, "modify failed (%d)", "tasks modified");
+        free(cmd);
+        check_free(argstr);
+        return;
+    }
+
     task_modify(argstr);
     free(argstr);
 
@@ -128,7 +246,7 @@ void key_tasklist_modify(const char* arg) { /* {{{ */
 
 void key_tasklist_reload(void) { /* {{{ */
     /* wrapper function to handle keyboard instruction to reload task list */
-    reload = true;
+    reload_changed = true;
     statusbar_message(cfg.statusbar_timeout, "task list reloaded");
 } /* }}} */
 
@@ -140,8 +258,8 @@ void key_tasklist_scroll(const int direction) { /* {{{ */
      *             h = to first element in list
      *             e = to last element in list
      */
-    const char oldsel    = selline;
-    const char oldoffset = pageoffset;
+    const int  oldsel    = selline;
+    const int  oldoffset = pageoffset;
 
     switch (direction) {
     case 'u':
@@ -195,20 +313,12 @@ void key_tasklist_scroll(const int direction) { /* {{{ */
         break;
     }
 
-    if (pageoffset != oldoffset) {
-        redraw = true;
-    } else {
-        if (oldsel - selline == 1) {
-            tasklist_print_task(selline, NULL, 2);
-        } else if (selline - oldsel == 1) {
-            tasklist_print_task(oldsel, NULL, 2);
-        } else {
-            tasklist_print_task(oldsel, NULL, 1);
-            tasklist_print_task(selline, NULL, 1);
-        }
-    }
-
-    print_header();
+    /* the tasks still shown move with the window, so that only the lines
+     * scrolled into view and the selection change are drawn */
+    frame_scroll(pageoffset - oldoffset);
+    frame_damage(oldsel, 1);
+    frame_damage(selline, 1);
+    frame_damage_header();
     tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "selline:%d offset:%d tasks:%d", selline,
                 pageoffset, taskcount);
 } /* }}} */
@@ -232,19 +342,27 @@ void key_tasklist_scroll_up(void) { /* {{{ */
 void key_tasklist_search(const char* arg) { /* {{{ */
     /* handle a keyboard direction to search
      * arg - the string to search for (pass NULL to prompt user)
+     *       when prompting, the first result is selected as the string is typed
+     * the active search string is pinned in the regex cache
      */
+    struct task* origin = get_task_by_position(selline);
+
+    regex_unpin(searchstring, REGEX_OPTS);
     check_free(searchstring);
 
     if (arg == NULL) {
         /* store search string  */
-        statusbar_getstr(&searchstring, "/");
+        search_origin = selline;
+        statusbar_getstr_live(&searchstring, "/", tasklist_search_preview);
         wipe_statusbar();
     } else {
         searchstring = strdup(arg);
     }
 
+    regex_pin(searchstring, REGEX_OPTS);
+
     /* go to first result */
-    find_next_search_result(head, get_task_by_position(selline));
+    find_search_result(origin, 1);
     tasklist_check_curs_pos();
     redraw = true;
 } /* }}} */
@@ -252,7 +370,18 @@ void key_tasklist_search(const char* arg) { /* {{{ */
 void key_tasklist_search_next(void) { /* {{{ */
     /* handle a keyboard direction to move to next search result */
     if (searchstring != NULL) {
-        find_next_search_result(head, get_task_by_position(selline));
+        find_search_result(get_task_by_position(selline), 1);
+        tasklist_check_curs_pos();
+        redraw = true;
+    } else {
+        statusbar_message(cfg.statusbar_timeout, "no active search string");
+    }
+} /* }}} */
+
+void key_tasklist_search_prev(void) { /* {{{ */
+    /* handle a keyboard direction to move to previous search result */
+    if (searchstring != NULL) {
+        find_search_result(get_task_by_position(selline), -1);
         tasklist_check_curs_pos();
         redraw = true;
     } else {
@@ -271,7 +400,7 @@ void key_tasklist_sort(const char* arg) { /* {{{ */
     struct task* cur = get_task_by_position(selline);
 
     if (cur != NULL) {
-        uuid = strdup(cur->uuid);
+        uuid = strdup(cur->detail->uuid);
     }
 
     tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "sort: initial task uuid=%s", uuid);
@@ -288,7 +417,8 @@ void key_tasklist_sort(const char* arg) { /* {{{ */
     }
 
     /* run sort */
-    sort_wrapper(head);
+    head = sort_tasks(head);
+    index_build(head);
 
     /* follow original task */
     if (cfg.follow_task) {
@@ -319,44 +449,27 @@ void key_tasklist_sync(void) { /* {{{ */
 } /* }}} */
 
 void key_tasklist_toggle_started(void) { /* {{{ */
-    /* toggle whether a task is started */
-    time_t          now;
+    /* toggle whether a task is started
+     * the task is updated at once, while the command runs in the background
+     * and is reported by tasklist_started or tasklist_stopped
+     */
     struct task*    cur = get_task_by_position(selline);
-    char*           cmdstr;
-    char*           action;
-    char*           actionpast;
-    char*           reply;
-    FILE*           cmdout;
-    int             ret;
-    bool            started = cur->start > 0;/* check whether task is started */
-
-    /* generate command */
-    cmdstr = calloc(UUIDLENGTH + 16, sizeof(char));
-    strcpy(cmdstr, "task ");
-    strcat(cmdstr, cur->uuid);
-    action = started ? " stop" : " start";
-    strcat(cmdstr, action);
-
-    /* run command */
-    cmdout = popen(cmdstr, "r");
-    free(cmdstr);
-    ret = pclose(cmdout);
-
-    /* check return value */
-    if (WEXITSTATUS(ret) == 0) {
-        time(&now);
-        cur->start = started ? 0 : now;
-        actionpast = started ? "stopped" : "started";
-        asprintf(&reply, "task %s", actionpast);
-        /* reset cached colors */
-        cur->pair = -1;
-        cur->selpair = -1;
-    } else {
-        asprintf(&reply, "task%s failed (%d)", action, WEXITSTATUS(ret));
+    bool            started;
+
+    if (cur == NULL) {
+        return;
     }
 
-    statusbar_message(cfg.statusbar_timeout, reply);
-    free(reply);
+    started = cur->start > 0;
+    tasklist_queue_command(cur, started ? "stop" : "start",
+                           started ? tasklist_stopped : tasklist_started);
+
+    cur->start = started ? 0 : time(NULL);
+    /* task data changed, so its cached colors are stale */
+    cur->datagen++;
+    frame_damage(selline, 1);
+
+    statusbar_message(cfg.statusbar_timeout, started ? "stopping task" : "starting task");
 } /* }}} */
 
 void key_tasklist_undo(void) { /* {{{ */
@@ -373,11 +486,35 @@ void key_tasklist_undo(void) { /* {{{ */
     tasklist_check_curs_pos();
 } /* }}} */
 
+void key_tasklist_unmark_all(void) { /* {{{ */
+    /* handle a keyboard direction to clear all marks */
+    task_unmark_all();
+    statusbar_message(cfg.statusbar_timeout, "marks cleared");
+    redraw = true;
+} /* }}} */
+
 void key_tasklist_view(void) { /* {{{ */
     /* run task info on a task and display in pager */
     view_task(get_task_by_position(selline));
 } /* }}} */
 
+void tasklist_batch_command(const char* cmd, const char* fail,
+                            const char* success) { /* {{{ */
+    /* run a command on the marked tasks, then reload the tasks it changed
+     * cmd     - the command to run, which follows the uuids
+     * fail    - the format string to use if the command fails
+     * success - the literal string to use if it succeeds
+     */
+    int ret;
+
+    statusbar_message(cfg.statusbar_timeout, "running %s on %d tasks", cmd, task_marks());
+
+    ret = task_batch_command(cmd);
+    reload_changed = true;
+
+    tasklist_command_message(ret, fail, success);
+} /* }}} */
+
 void tasklist_check_curs_pos(void) { /* {{{ */
     /* check if the cursor is in a valid position */
     const int onscreentasks = getmaxy(tasklist);
@@ -433,11 +570,116 @@ void tasklist_command_message(const int ret,
     }
 } /* }}} */
 
+void tasklist_completed(const int ret, const char* uuid) { /* {{{ */
+    /* report a complete command which ran in the background */
+    tasklist_reconcile(ret, uuid, "complete failed (%d)", "complete successful");
+} /* }}} */
+
+void tasklist_deleted(const int ret, const char* uuid) { /* {{{ */
+    /* report a delete command which ran in the background */
+    tasklist_reconcile(ret, uuid, "delete failed (%d)", "delete successful");
+} /* }}} */
+
+int tasklist_getch(void) { /* {{{ */
+    /**
+     * wait for a keypress, or for anything else the main loop acts on:
+     * a change of the data files, a background command exiting, a statusbar
+     * message expiring, a key sequence ending, or the progress of a
+     * background load
+     * without a watcher on the data files, this wakes every nc_timeout ms
+     * return is the key pressed, or ERR
+     */
+    struct pollfd   fds[3];
+    int             timeout;
+    int             expiry;
+    int             c;
+    time_t          now;
+
+    /* take input curses has already buffered, which poll does not see */
+    wtimeout(statusbar, 0);
+    c = wgetch(statusbar);
+
+    if (c != ERR) {
+        return c;
+    }
+
+    /* sleep until the first thing that is due
+     * changes to the data files wait for the queued commands to complete */
+    timeout = process_pending() ? -1 : watch_timeout();
+
+    if (watch_fd() < 0 && cfg.nc_timeout >= 0) {
+        timeout = timeout < 0 ? cfg.nc_timeout : MIN(timeout, cfg.nc_timeout);
+    }
+
+    if (load_tasks_pending()) {
+        timeout = timeout < 0 ? NCURSES_LOAD_WAIT : MIN(timeout, NCURSES_LOAD_WAIT);
+    }
+
+    if (keys_timeout() >= 0) {
+        timeout = timeout < 0 ? keys_timeout() : MIN(timeout, keys_timeout());
+    }
+
+    if (sb_timeout > 0) {
+        now     = time(NULL);
+        expiry  = sb_timeout < now ? 0 : (sb_timeout - now + 1) * 1000;
+        timeout = timeout < 0 ? expiry : MIN(timeout, expiry);
+    }
+
+    /* descriptors which are -1 are not polled */
+    fds[0].fd     = STDIN_FILENO;
+    fds[0].events = POLLIN;
+    fds[1].fd     = watch_fd();
+    fds[1].events = POLLIN;
+    fds[2].fd     = process_fd();
+    fds[2].events = POLLIN;
+
+    if (poll(fds, 3, timeout) <= 0) {
+        return ERR;
+    }
+
+    if (fds[1].revents & POLLIN) {
+        watch_read();
+    }
+
+    if (fds[0].revents & POLLIN) {
+        wtimeout(statusbar, cfg.nc_timeout);
+        return wgetch(statusbar);
+    }
+
+    return ERR;
+} /* }}} */
+
+bool tasklist_keys_waiting(void) { /* {{{ */
+    /* check whether keys are waiting to be handled, without taking them */
+    struct pollfd   pfd;
+    int             c;
+
+    pfd.fd     = STDIN_FILENO;
+    pfd.events = POLLIN;
+
+    if (poll(&pfd, 1, 0) > 0) {
+        return true;
+    }
+
+    /* input curses has already buffered is not seen by poll */
+    wtimeout(statusbar, 0);
+    c = wgetch(statusbar);
+
+    if (c == ERR) {
+        return false;
+    }
+
+    ungetch(c);
+
+    return true;
+} /* }}} */
+
 void tasklist_window(void) { /* {{{ */
     /* ncurses main function */
     int             c;
     struct task*    cur;
     char*           uuid = NULL;
+    int             skipped = 0;
 
     /* get field lengths */
     cfg.fieldlengths.project = max_project_length();
@@ -468,8 +710,12 @@ void tasklist_window(void) { /* {{{ */
     cfg.fieldlengths.description = COLS - cfg.fieldlengths.project - 1 -
                                    cfg.fieldlengths.date;
     task_count();
-    print_header();
-    tasklist_print_task_list();
+    idlok(tasklist, TRUE);
+    frame_damage_all();
+
+    if (load_tasks_pending()) {
+        statusbar_message(cfg.statusbar_timeout, "loading tasks...");
+    }
 
     /* main loop */
     while (1) {
@@ -477,9 +723,10 @@ void tasklist_window(void) { /* {{{ */
         done    = false;
         redraw  = false;
         reload  = false;
+        reload_changed = false;
 
         /* check for an empty task list */
-        if (head == NULL) {
+        if (head == NULL && !load_tasks_pending()) {
             if (strcmp(active_filter, "") == 0) {
                 tnc_fprintf(logfp, LOG_ERROR,
                             "it appears that your task list is empty. %s does not yet support empty task lists.",
@@ -488,7 +735,10 @@ void tasklist_window(void) { /* {{{ */
             }
 
             active_filter = strdup("");
-            reload = true;
+
+            if (!task_filter(active_filter)) {
+                reload = true;
+            }
         }
 
         /* get the screen size */
@@ -501,40 +751,106 @@ void tasklist_window(void) { /* {{{ */
         /* check for size changes */
         check_resize();
 
-        /* apply staged window updates */
-        doupdate();
+        /* draw what changed, unless more keys are waiting, so that keys
+         * repeated faster than frames are drawn are drawn together */
+        if (skipped >= FRAMESKIPS || !tasklist_keys_waiting()) {
+            frame_draw();
+            skipped = 0;
+        } else {
+            skipped++;
+        }
 
-        /* get a character */
-        c = wgetch(statusbar);
+        /* get a character, once there are tasks for it to act on
+         * while a load runs, the wait is shortened to poll it often */
+        if (taskcount == 0 && load_tasks_pending()) {
+            napms(NCURSES_LOAD_WAIT);
+            c = ERR;
+        } else {
+            c = tasklist_getch();
+        }
 
         /* handle the character */
         handle_keypress(c, MODE_TASKLIST);
 
-        /* exit */
+        /* report background commands which have completed */
+        process_poll();
+
+        /* reload once another program's writes to the data files settle */
+        if (!process_pending() && watch_due()) {
+            reload_changed = true;
+        }
+
+        /* exit, once background commands have completed */
         if (done) {
+            process_flush();
             break;
         }
 
-        /* reload task list */
+        /* changes seen so far are covered by the reload */
+        if (reload || reload_changed) {
+            watch_clear();
+        }
+
+        /* reload task list in the background */
         if (reload) {
+            load_tasks_start();
+        }
+        /* update only the changed tasks, falling back to a full reload */
+        else if (reload_changed) {
             cur = get_task_by_position(selline);
 
             if (cur) {
-                uuid = strdup(cur->uuid);
+                uuid = strdup(cur->detail->uuid);
             }
 
-            wipe_tasklist();
-            reload_tasks();
-            task_count();
-            redraw = true;
+            if (refresh_tasks()) {
+                redraw = true;
 
-            if (cfg.follow_task) {
-                set_position_by_uuid(uuid);
+                if (cfg.follow_task) {
+                    set_position_by_uuid(uuid);
+                }
+
+                tasklist_check_curs_pos();
+            } else {
+                load_tasks_start();
             }
 
             check_free(uuid);
             uuid = NULL;
-            tasklist_check_curs_pos();
+        }
+
+        /* apply the progress of a background load */
+        if (load_tasks_pending()) {
+            switch (load_tasks_poll(rows - 2)) {
+            case LOAD_PAINTED:
+                task_count();
+                redraw = true;
+                break;
+
+            case LOAD_READY:
+                cur = get_task_by_position(selline);
+
+                if (cur) {
+                    uuid = strdup(cur->detail->uuid);
+                }
+
+                wipe_tasklist();
+                load_tasks_finish();
+                task_count();
+                redraw = true;
+
+                if (cfg.follow_task) {
+                    set_position_by_uuid(uuid);
+                }
+
+                check_free(uuid);
+                uuid = NULL;
+                tasklist_check_curs_pos();
+                break;
+
+            default:
+                break;
+            }
         }
 
         /* redraw all windows */
@@ -542,16 +858,8 @@ void tasklist_window(void) { /* {{{ */
             cfg.fieldlengths.project = max_project_length();
             cfg.fieldlengths.description = cols - cfg.fieldlengths.project - 1 -
                                            cfg.fieldlengths.date;
-            print_header();
-            tasklist_print_task_list();
             tasklist_check_curs_pos();
-            touchwin(tasklist);
-            touchwin(header);
-            touchwin(statusbar);
-            wnoutrefresh(tasklist);
-            wnoutrefresh(header);
-            wnoutrefresh(statusbar);
-            doupdate();
+            frame_damage_all();
         }
 
         statusbar_timeout();
@@ -568,10 +876,9 @@ void tasklist_print_task(const int tasknum,
      *           only one of either `tasknum` or `this` should be specified
      * count   - number of consecutive tasks to print
      */
-    bool  sel = false;
-    char* tmp;
-    int   x;
-    int   y = tasknum - pageoffset; /* determine position to print */
+    bool        sel = false;
+    const char* line;
+    int         y = tasknum - pageoffset; /* determine position to print */
 
     if (y < 0 || y >= rows - 1) {
         return;
@@ -595,17 +902,17 @@ void tasklist_print_task(const int tasknum,
 
     /* wipe line */
     wattrset(tasklist, COLOR_PAIR(0));
-
-    for (x = 0; x < cols; x++) {
-        mvwaddch(tasklist, y, x, ' ');
-    }
+    wmove(tasklist, y, 0);
+    wclrtoeol(tasklist);
 
     /* evaluate line */
     wmove(tasklist, 0, 0);
     wattrset(tasklist, get_colors(OBJECT_TASK, (struct task*)this, sel));
-    tmp = (char*)eval_format(cfg.formats.task_compiled, (struct task*)this);
-    umvaddstr_align(tasklist, y, tmp);
-    free(tmp);
+    line = task_line((struct task*)this, cols);
+
+    if (line != NULL) {
+        umvaddstr_align(tasklist, y, (char*)line);
+    }
 
     /* print next task if requested */
     if (count > 1) {
@@ -616,23 +923,84 @@ void tasklist_print_task(const int tasknum,
 } /* }}} */
 
 void tasklist_print_task_list(void) { /* {{{ */
-    /* print every task in the task list */
-    struct task* cur     = head;
-    short        counter = 0;
+    /* print the tasks which are visible in the task list window
+     * the first visible task is found through the position index, so the
+     * cost of a redraw does not depend on the length of the list
+     */
+    const int   height = getmaxy(tasklist);
+    int         lines = MIN(taskcount - pageoffset, height);
 
-    while (cur != NULL) {
-        tasklist_print_task(counter, cur, 1);
+    if (lines > 0) {
+        tasklist_print_task(pageoffset, NULL, lines);
+    } else {
+        lines = 0;
+    }
 
-        /* move to next item */
-        counter++;
-        cur = cur->next;
+    /* clear lines below the last task */
+    if (lines < height) {
+        wipe_screen(tasklist, lines, height - 1);
+        wnoutrefresh(tasklist);
     }
+} /* }}} */
+
+void tasklist_queue_command(const struct task* tsk, const char* cmd,
+                            void (*done)(const int, const char*)) { /* {{{ */
+    /**
+     * run a task command on a task in the background
+     * the command cannot prompt or write to the terminal, which curses owns,
+     * so confirmation is off and its output is only logged
+     * tsk  - the task to run the command on
+     * cmd  - the command, which follows the task's uuid
+     * done - called with the return of the command and the task's uuid
+     */
+    char* cmdstr;
+
+    asprintf(&cmdstr, "task rc.confirmation=off %s %s 2>&1 < /dev/null", tsk->detail->uuid, cmd);
+    view_cache_clear();
+    process_queue(cmdstr, done, tsk->detail->uuid);
+    free(cmdstr);
+} /* }}} */
+
+void tasklist_reconcile(const int ret, const char* uuid,
+                        const char* fail, const char* success) { /* {{{ */
+    /**
+     * report a background command whose change was already made to the task
+     * list, and reconcile the task list with the task database
+     * this only sets what the main loop reloads, as it may be called while
+     * another command is run
+     * ret     - the return of the command
+     * uuid    - the uuid of the task the command ran on
+     * fail    - the format string to use if the command failed
+     * success - the literal string to use if it succeeded
+     */
+    tasklist_command_message(ret, fail, success);
 
-    if (counter < cols - 2) {
-        wipe_screen(tasklist, counter - pageoffset, rows - 2);
+    if (ret != 0) {
+        /* roll back the change, along with any other made meanwhile */
+        tnc_fprintf(logfp, LOG_ERROR, "command on task %s failed (%d)", uuid, ret);
+        reload = true;
+    } else if (!process_pending()) {
+        /* pick up what the commands changed besides the local update,
+         * such as modification times, once they have all run */
+        reload_changed = true;
     }
 } /* }}} */
 
+void tasklist_search_preview(const char* pattern) { /* {{{ */
+    /**
+     * select the first result of a search as its pattern is typed
+     * results are found from the task selected when the search started, and
+     * the selection returns there while nothing matches
+     * pattern - the pattern typed so far
+     */
+    int line = search_find(pattern, search_origin, 1, NULL);
+
+    selline = line >= 0 ? line : search_origin;
+    tasklist_check_curs_pos();
+    frame_damage_all();
+    frame_draw();
+} /* }}} */
+
 void tasklist_remove_task(struct task* this) { /* {{{ */
     /* remove a task from the task list without reloading */
     if (this == head) {
@@ -645,12 +1013,24 @@ void tasklist_remove_task(struct task* this) { /* {{{ */
         this->next->prev = this->prev;
     }
 
-    free_task(this);
-    taskcount--;
+    /* the task's memory belongs to the task generation, and is released
+     * with it on the next reload */
+    index_remove(this->position);
+    task_count();
     tasklist_check_curs_pos();
     redraw = true;
 } /* }}} */
 
+void tasklist_started(const int ret, const char* uuid) { /* {{{ */
+    /* report a start command which ran in the background */
+    tasklist_reconcile(ret, uuid, "task start failed (%d)", "task started");
+} /* }}} */
+
+void tasklist_stopped(const int ret, const char* uuid) { /* {{{ */
+    /* report a stop command which ran in the background */
+    tasklist_reconcile(ret, uuid, "task stop failed (%d)", "task stopped");
+} /* }}} */
+
 void tasklist_task_add(void) { /* {{{ */
     /* create a new task by adding a generic task
      * then letting the user edit it
@@ -659,22 +1039,22 @@ void tasklist_task_add(void) { /* {{{ */
     char*           cmd;
     char            line[TOTALLENGTH];
     char*           failmsg;
-    unsigned short  tasknum;
+    unsigned int    tasknum;
     int             ret = 0;
     int             pret;
 
     /* add new task */
     cmd = strdup("task add new task");
     tnc_fprintf(logfp, LOG_DEBUG, "running: %s", cmd);
-    cmdout = popen(cmd, "r");
+    cmdout = process_open(cmd);
 
-    while (fgets(line, sizeof(struct line) - 1, cmdout) != NULL) {
-        if (sscanf(line, "Created task %hu.", &tasknum)) {
+    while (fgets(line, sizeof(line) - 1, cmdout) != NULL) {
+        if (sscanf(line, "Created task %u.", &tasknum)) {
             break;
         }
     }
 
-    pret = pclose(cmdout);
+    pret = process_close(cmdout);
     free(cmd);
 
     if (WEXITSTATUS(pret) != 0) {
@@ -684,9 +1064,9 @@ void tasklist_task_add(void) { /* {{{ */
 
     /* edit task */
     if (cfg.version[0] < '2') {
-        asprintf(&cmd, "task edit %d", tasknum);
+        asprintf(&cmd, "task edit %u", tasknum);
     } else {
-        asprintf(&cmd, "task %d edit", tasknum);
+        asprintf(&cmd, "task %u edit", tasknum);
     }
 
     ret = task_interactive_command(cmd);
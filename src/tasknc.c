@@ -15,19 +15,27 @@
 #include <time.h>
 #include <unistd.h>
 #include <wchar.h>
+#include "bench.h"
 #include "color.h"
 #include "command.h"
 #include "common.h"
 #include "config.h"
 #include "formats.h"
+#include "frame.h"
+#include "index.h"
+#include "intern.h"
+#include "process.h"
+#include "search.h"
 #include "tasknc.h"
 #include "tasklist.h"
 #include "tasks.h"
 #include "log.h"
 #include "keys.h"
+#include "metrics.h"
 #include "pager.h"
 #include "statusbar.h"
 #include "test.h"
+#include "watch.h"
 
 /* global variables {{{ */
 const char* progname = PROGNAME;
@@ -35,7 +43,7 @@ const char* progauthor = PROGAUTHOR;
 const char* progversion = PROGVERSION;
 
 struct config   cfg;                    /* runtime config struct */
-short           pageoffset = 0;         /* number of tasks page is offset */
+int             pageoffset = 0;         /* number of tasks page is offset */
 char*           searchstring = NULL;    /* currently active search string */
 int             selline = 0;            /* selected line number */
 int             rows;
@@ -49,6 +57,7 @@ struct keybind* keybinds = NULL;
 /* runtime status */
 bool redraw;
 bool reload;
+bool reload_changed;
 bool done;
 
 /* windows */
@@ -65,18 +74,37 @@ struct var vars[] = {
     {"follow_task",       VAR_INT,  VAR_RW, &(cfg.follow_task)},
     {"history_max",       VAR_INT,  VAR_RC, &(cfg.history_max)},
     {"log_level",         VAR_INT,  VAR_RW, &(cfg.loglvl)},
+    {"metrics",           VAR_INT,  VAR_RW, &(cfg.metrics)},
+    {"metrics_arena_blocks", VAR_INT, VAR_RO, &(metrics.counters[COUNTER_ARENA])},
+    {"metrics_export_calls", VAR_INT, VAR_RO, &(metrics.phases[PHASE_EXPORT].calls)},
+    {"metrics_export_us", VAR_INT,  VAR_RO, &(metrics.phases[PHASE_EXPORT].us)},
+    {"metrics_filter_calls", VAR_INT, VAR_RO, &(metrics.phases[PHASE_FILTER].calls)},
+    {"metrics_filter_us", VAR_INT,  VAR_RO, &(metrics.phases[PHASE_FILTER].us)},
+    {"metrics_parse_calls", VAR_INT, VAR_RO, &(metrics.phases[PHASE_PARSE].calls)},
+    {"metrics_parse_us",  VAR_INT,  VAR_RO, &(metrics.phases[PHASE_PARSE].us)},
+    {"metrics_regex_compiles", VAR_INT, VAR_RO, &(metrics.counters[COUNTER_REGEX])},
+    {"metrics_render_calls", VAR_INT, VAR_RO, &(metrics.phases[PHASE_RENDER].calls)},
+    {"metrics_render_us", VAR_INT,  VAR_RO, &(metrics.phases[PHASE_RENDER].us)},
+    {"metrics_sort_calls", VAR_INT, VAR_RO, &(metrics.phases[PHASE_SORT].calls)},
+    {"metrics_sort_us",   VAR_INT,  VAR_RO, &(metrics.phases[PHASE_SORT].us)},
+    {"metrics_spawn_calls", VAR_INT, VAR_RO, &(metrics.phases[PHASE_SPAWN].calls)},
+    {"metrics_spawn_us",  VAR_INT,  VAR_RO, &(metrics.phases[PHASE_SPAWN].us)},
     {"program_author",    VAR_STR,  VAR_RO, &progauthor},
     {"program_name",      VAR_STR,  VAR_RO, &progname},
     {"program_version",   VAR_STR,  VAR_RO, &progversion},
     {"search_string",     VAR_STR,  VAR_RW, &searchstring},
     {"selected_line",     VAR_INT,  VAR_RW, &selline},
+    {"snapshot",          VAR_INT,  VAR_RC, &(cfg.snapshot)},
     {"sort_mode",         VAR_STR,  VAR_RW, &(cfg.sortmode)},
     {"statusbar_timeout", VAR_INT,  VAR_RW, &(cfg.statusbar_timeout)},
     {"task_count",        VAR_INT,  VAR_RO, &taskcount},
     {"task_format",       VAR_STR,  VAR_RC, &(cfg.formats.task)},
     {"task_version",      VAR_STR,  VAR_RW, &(cfg.version)},
+    {"threads",           VAR_INT,  VAR_RW, &(cfg.threads)},
     {"title_format",      VAR_STR,  VAR_RC, &(cfg.formats.title)},
     {"view_format",       VAR_STR,  VAR_RC, &(cfg.formats.view)},
+    {"watch",             VAR_INT,  VAR_RC, &(cfg.watch)},
+    {NULL,                VAR_UNDEF, VAR_RO, NULL},
 };
 
 struct funcmap funcmaps[] = {
@@ -90,6 +118,8 @@ struct funcmap funcmaps[] = {
     {"filter",      (void*) key_tasklist_filter,          0, MODE_TASKLIST},
     {"f_redraw",    (void*) force_redraw,                 0, MODE_ANY},
     {"help",        (void*) help_window,                  0, MODE_ANY},
+    {"mark",        (void*) key_tasklist_mark,            0, MODE_TASKLIST},
+    {"mark_matching", (void*) key_tasklist_mark_matching, 0, MODE_TASKLIST},
     {"modify",      (void*) key_tasklist_modify,          0, MODE_TASKLIST},
     {"quit",        (void*) key_done,                     0, MODE_TASKLIST},
     {"quit",        (void*) key_pager_close,              0, MODE_PAGER},
@@ -104,6 +134,7 @@ struct funcmap funcmaps[] = {
     {"scroll_up",   (void*) key_pager_scroll_up,          0, MODE_PAGER},
     {"search",      (void*) key_tasklist_search,          0, MODE_TASKLIST},
     {"search_next", (void*) key_tasklist_search_next,     0, MODE_TASKLIST},
+    {"search_prev", (void*) key_tasklist_search_prev,     0, MODE_TASKLIST},
     {"set",         (void*) run_command_set,              1, MODE_ANY},
     {"shell",       (void*) key_task_interactive_command, 1, MODE_ANY},
     {"shell_bg",    (void*) key_task_background_command,  1, MODE_ANY},
@@ -116,6 +147,7 @@ struct funcmap funcmaps[] = {
     {"toggle_start",(void*) key_tasklist_toggle_started,  0, MODE_ANY},
     {"unbind",      (void*) run_command_unbind,           1, MODE_ANY},
     {"undo",        (void*) key_tasklist_undo,            0, MODE_TASKLIST},
+    {"unmark_all",  (void*) key_tasklist_unmark_all,      0, MODE_TASKLIST},
     {"view",        (void*) key_tasklist_view,            0, MODE_TASKLIST},
 };
 /* }}} */
@@ -153,11 +185,16 @@ void check_screen_size(void) { /* {{{ */
 
 void cleanup(void) { /* {{{ */
     /* function to run on termination */
-    struct keybind* lastbind;
-
     /* free memory allocated normally */
     check_free(searchstring);
-    free_tasks(head);
+    search_free();
+    frame_free();
+    view_cache_clear();
+    free_regex_cache();
+    load_tasks_cancel();
+    watch_stop();
+    free_tasks();
+    intern_free();
     check_free(cfg.sortmode);
     free(cfg.version);
     free(cfg.formats.task);
@@ -165,17 +202,15 @@ void cleanup(void) { /* {{{ */
     free(cfg.formats.view);
     free(active_filter);
 
-    while (keybinds != NULL) {
-        lastbind = keybinds;
-        keybinds = keybinds->next;
-        check_free(lastbind->argstr);
-        free(lastbind);
-    }
-
+    free_keybinds();
     free_colors();
     free_prompts();
     free_formats();
 
+    if (cfg.metrics) {
+        metrics_dump();
+    }
+
     /* close open files */
     fflush(logfp);
     fclose(logfp);
@@ -195,6 +230,10 @@ void configure(void) { /* {{{ */
     cfg.sortmode    = strdup("drpu");                   /* determine sort order */
     cfg.follow_task = true;                             /* follow task after it is moved */
     cfg.history_max = 50;
+    cfg.snapshot    = 0;                                /* do not cache task list on disk */
+    cfg.watch       = 1;                                /* reload when data files change */
+    cfg.metrics     = 0;                                /* do not log metrics on exit */
+    cfg.threads     = 0;                                /* a thread per processor */
 
     /* set default formats */
     cfg.formats.title = strdup(" $program_name ($selected_line/$task_count) $> $date");
@@ -206,15 +245,21 @@ void configure(void) { /* {{{ */
         active_filter = strdup("status:pending");
     }
 
-    /* get task version */
-    cmd = popen("task --version", "r");
+    /* get task version
+     * output which does not start with one, such as when task is missing,
+     * leaves it unknown, which is treated as a current version */
+    cmd = process_open("task --version");
 
-    while (ret != 1) {
-        ret = fscanf(cmd, "%m[0-9.-] ", &(cfg.version));
+    if (cmd != NULL) {
+        ret = fscanf(cmd, " %m[0-9.-]", &(cfg.version));
+        process_close(cmd);
+    }
+
+    if (ret != 1) {
+        cfg.version = strdup("unknown");
     }
 
     tnc_fprintf(logfp, LOG_DEBUG, "task version: %s", cfg.version);
-    pclose(cmd);
 
     /* default keybinds */
     add_keybind(ERR,           NULL,                     NULL, MODE_TASKLIST);
@@ -248,7 +293,11 @@ void configure(void) { /* {{{ */
     add_keybind('s',           key_tasklist_sort,        NULL, MODE_TASKLIST);
     add_keybind('/',           key_tasklist_search,      NULL, MODE_TASKLIST);
     add_keybind('n',           key_tasklist_search_next, NULL, MODE_TASKLIST);
+    add_keybind('N',           key_tasklist_search_prev, NULL, MODE_TASKLIST);
     add_keybind('f',           key_tasklist_filter,      NULL, MODE_TASKLIST);
+    add_keybind('t',           key_tasklist_mark,        NULL, MODE_TASKLIST);
+    add_keybind('T',           key_tasklist_mark_matching, NULL, MODE_TASKLIST);
+    add_keybind('U',           key_tasklist_unmark_all,  NULL, MODE_TASKLIST);
     add_keybind('y',           key_tasklist_sync,        NULL, MODE_TASKLIST);
     add_keybind('q',           key_done,                 NULL, MODE_TASKLIST);
     add_keybind('q',           key_pager_close,          NULL, MODE_PAGER);
@@ -294,43 +343,27 @@ struct funcmap* find_function(const char* name, const enum prog_mode mode) { /*
     return NULL;
 } /* }}} */
 
-void find_next_search_result(struct task* head, struct task* pos) { /* {{{ */
-    /* find the next search result in the list of tasks
-     * head - the first task in the task list
-     * pos  - the position in the task list to start searching from
+void find_search_result(const struct task* pos, const int direction) { /* {{{ */
+    /* find the next search result in the list of tasks, and select it
+     * pos       - the task to start searching from (may be NULL)
+     * direction - 1 to search down the task list, -1 to search up
      */
-    struct task* cur = pos;
-
-    while (1) {
-        /* move to next item */
-        cur = cur->next;
-
-        /* move to head if end of list is reached */
-        if (cur == NULL) {
-            cur = head;
-            selline = 0;
-            tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "search wrapped");
-            statusbar_message(cfg.statusbar_timeout, "search wrapped to top");
-        }
-
-        else {
-            selline++;
-        }
+    bool    wrapped;
+    int     line = search_find(searchstring, pos != NULL ? pos->position : -1,
+                               direction, &wrapped);
 
-        /* check for match */
-        if (task_match(cur, searchstring)) {
-            return;
-        }
-
-        /* stop if full loop was made */
-        if (cur == pos) {
-            break;
-        }
+    if (line < 0) {
+        statusbar_message(cfg.statusbar_timeout, "no matches: %s", searchstring);
+        return;
     }
 
-    statusbar_message(cfg.statusbar_timeout, "no matches: %s", searchstring);
+    if (wrapped) {
+        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "search wrapped");
+        statusbar_message(cfg.statusbar_timeout, "search wrapped to %s",
+                          direction < 0 ? "bottom" : "top");
+    }
 
-    return;
+    selline = line;
 } /* }}} */
 
 struct var* find_var(const char* name) { /* {{{ */
@@ -370,8 +403,7 @@ void force_redraw(void) { /* {{{ */
     doupdate();
 
     /* print messages */
-    print_header();
-    tasklist_print_task_list();
+    frame_damage_all();
     statusbar_message(cfg.statusbar_timeout, "redrawn");
 } /* }}} */
 
@@ -406,8 +438,8 @@ void handle_resize(void) { /* {{{ */
     }
 
     /* redraw windows */
-    tasklist_print_task_list();
-    print_header();
+    frame_damage_all();
+    frame_draw();
 
     /* message about resize */
     tnc_fprintf(logfp, LOG_DEBUG, "window resized to y=%d x=%d", rows, cols);
@@ -488,23 +520,9 @@ void key_done(void) { /* {{{ */
 char max_project_length(void) { /* {{{ */
     /* compute max project length
      * return is the maximum project length
+     * the projects of the task list are counted by the position index
      */
-    char            len = 0;
-    struct task*    cur = head;
-
-    while (cur) {
-        if (cur->project) {
-            char l = strlen(cur->project);
-
-            if (l > len) {
-                len = l;
-            }
-        }
-
-        cur = cur->next;
-    }
-
-    return len;
+    return index_project_length();
 } /* }}} */
 
 const char* name_function(void* function) { /* {{{ */
@@ -804,38 +822,33 @@ void wipe_screen(WINDOW* win, const short startl, const short stopl) { /* {{{ */
      * stopl  - the number of the line to stop wiping at
      */
     int y;
-    int x;
 
     wattrset(win, COLOR_PAIR(0));
 
-    for (y = startl; y <= stopl; y++)
-        for (x = 0; x < cols; x++) {
-            mvwaddch(win, y, x, ' ');
-        }
+    for (y = startl; y <= stopl; y++) {
+        wmove(win, y, 0);
+        wclrtoeol(win);
+    }
 } /* }}} */
 
 void wipe_window(WINDOW* win) { /* {{{ */
     /* wipe everything on the screen
      * win - the window to print the string in
      */
-    int x;
-    int y;
-    int tx;
+    int y = getmaxy(win);
     int ty;
 
-    getmaxyx(win, y, x);
-
-    for (ty = 0; ty < y; ty++)
-        for (tx = 0; tx < x; tx++) {
-            mvwaddch(win, ty, tx, ' ');
-        }
+    for (ty = 0; ty < y; ty++) {
+        wmove(win, ty, 0);
+        wclrtoeol(win);
+    }
 
     touchwin(win);
 } /* }}} */
 
 void sig_handler(int signo) {
     if (signo == SIGUSR1) {
-        reload = 1;
+        reload_changed = 1;
     }
 }
 
@@ -919,8 +932,18 @@ int main(int argc, char** argv) { /* {{{ */
         umvaddstr(stdscr, 1, 0, "loading tasks...");
         wrefresh(stdscr);
         tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "loading tasks...");
-        head = get_tasks(NULL);
-        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "%d tasks loaded", taskcount);
+
+        /* show a snapshot right away, the load then revalidates it */
+        if (cfg.snapshot) {
+            load_tasks_snapshot();
+        }
+
+        load_tasks_start();
+
+        if (cfg.watch) {
+            watch_start();
+        }
+
         mvwhline(stdscr, 0, 0, ' ', COLS);
         mvwhline(stdscr, 1, 0, ' ', COLS);
         wtimeout(stdscr, 1000);
@@ -928,6 +951,12 @@ int main(int argc, char** argv) { /* {{{ */
         ncurses_end(0);
     }
 
+    /* benchmarks, which generate their own tasks */
+    else if (strncmp(debugopts, "bench:", 6) == 0) {
+        bench(debugopts + 6);
+        free(debugopts);
+    }
+
     /* debug mode */
     else {
         configure();
@@ -6,66 +6,291 @@
 
 #define _GNU_SOURCE
 #include <curses.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <time.h>
-#include <time.h>
+#include <unistd.h>
 #include "common.h"
+#include "arena.h"
 #include "config.h"
+#include "filter.h"
+#include "formats.h"
+#include "index.h"
+#include "intern.h"
+#include "json.h"
 #include "log.h"
+#include "metrics.h"
+#include "pager.h"
+#include "process.h"
+#include "snapshot.h"
 #include "sort.h"
 #include "tasklist.h"
 #include "tasks.h"
+#include "watch.h"
+
+/* task fields handled by the json parser */
+enum json_field {
+    JSON_FIELD_ANNOTATIONS,
+    JSON_FIELD_DESCRIPTION,
+    JSON_FIELD_DUE,
+    JSON_FIELD_END,
+    JSON_FIELD_ENTRY,
+    JSON_FIELD_ID,
+    JSON_FIELD_MODIFIED,
+    JSON_FIELD_PRIORITY,
+    JSON_FIELD_PROJECT,
+    JSON_FIELD_START,
+    JSON_FIELD_STATUS,
+    JSON_FIELD_TAGS,
+    JSON_FIELD_URGENCY,
+    JSON_FIELD_UUID
+};
+
+/**
+ * json field map - map between a json key and the task field it fills
+ * name  - the json key (this table must stay sorted by name)
+ * field - the field to be parsed
+ */
+struct json_field_map {
+    const char*         name;
+    enum json_field     field;
+};
+
+static const struct json_field_map json_fields[] = {
+    {"annotations", JSON_FIELD_ANNOTATIONS},
+    {"description", JSON_FIELD_DESCRIPTION},
+    {"due",         JSON_FIELD_DUE},
+    {"end",         JSON_FIELD_END},
+    {"entry",       JSON_FIELD_ENTRY},
+    {"id",          JSON_FIELD_ID},
+    {"modified",    JSON_FIELD_MODIFIED},
+    {"priority",    JSON_FIELD_PRIORITY},
+    {"project",     JSON_FIELD_PROJECT},
+    {"start",       JSON_FIELD_START},
+    {"status",      JSON_FIELD_STATUS},
+    {"tags",        JSON_FIELD_TAGS},
+    {"urgency",     JSON_FIELD_URGENCY},
+    {"uuid",        JSON_FIELD_UUID},
+};
+
+#define NJSONFIELDS (sizeof(json_fields)/sizeof(struct json_field_map))
+
+/**
+ * task generation - the memory backing one load of the task list
+ * task structs and the export text their strings point into share the
+ * lifetime of the load, so a reload drops the previous one all at once
+ * tasks - arena holding the task structs and export buffer of a full load
+ * side  - small pool for tasks reloaded individually by reload_task
+ * map   - the snapshot the task strings point into, if read from one
+ * maplen - the length of the snapshot mapping
+ */
+struct task_generation {
+    struct arena tasks;
+    struct arena side;
+    void* map;
+    size_t maplen;
+};
+
+/* the generation backing the current task list */
+static struct task_generation* generation = NULL;
+
+/* the filter the current generation was loaded with, NULL if none was */
+static char* loaded_filter = NULL;
+
+/* the tasks of the current generation which the filter view does not show,
+ * in no particular order */
+static struct task* hidden = NULL;
+
+/* the newest modification time of a loaded task, 0 if unknown
+ * refresh_tasks exports only tasks modified since then */
+static time_t watermark = 0;
+
+/**
+ * background loader - a full load of the task list read from a non-blocking
+ * pipe, so the task list stays usable while the export runs
+ * cmd     - the export being read, NULL if no load is running
+ * gen     - the generation the tasks are loaded into
+ * buffer  - output which has been read, but does not yet end a line
+ * length  - the number of bytes in buffer
+ * size    - the allocated size of buffer
+ * first   - the first task parsed which is not yet in the task list
+ * last    - the last task parsed
+ * count   - the number of tasks parsed
+ * painted - whether the start of the load was put in the task list before
+ *           it completed, gen then already backs the task list
+ * failed  - whether the export could not be parsed
+ * stamp   - the state of the data files when the export was started
+ * filter  - the filter the export was run with
+ * started - when the export was started, by the metrics clock
+ */
+static struct {
+    FILE* cmd;
+    struct task_generation* gen;
+    char* buffer;
+    size_t length;
+    size_t size;
+    struct task* first;
+    struct task* last;
+    unsigned int count;
+    bool painted;
+    bool failed;
+    struct snapshot_stamp stamp;
+    char* filter;
+    long long started;
+} loader;
+
+/**
+ * parse part - a share of export output parsed by a thread of its own
+ * pos     - the start of the share
+ * end     - the end of the share, after the end of a line
+ * arena   - the arena the tasks of the share are allocated from
+ * first   - the first task parsed
+ * last    - the last task parsed
+ * count   - the number of tasks parsed
+ * ret     - whether the share was parsed successfully
+ * thread  - the thread parsing the share
+ * started - whether thread was started
+ */
+struct parse_part {
+    char* pos;
+    char* end;
+    struct arena arena;
+    struct task* first;
+    struct task* last;
+    unsigned int count;
+    bool ret;
+    pthread_t thread;
+    bool started;
+};
 
 /* local function declarations */
+static int compare_json_field(const void* key, const void* field);
+static void copy_marks(struct task* first);
+static char* export_command(const char* filter, const char* args);
+static const char* export_filter(void);
+static void hide_task(struct task* this);
+static struct task* hide_tasks(struct task* first);
+static struct task* join_tasks(struct task* first, struct task* second);
+static time_t newest_modified(struct task* first);
+static void remove_task(struct task* this);
+static struct task* replace_generation(struct task_generation* gen, struct task* new_head,
+                                       const char* filter);
+static int run_command(const char* cmdstr);
+static bool run_export(const char* cmdstr, struct arena* arena,
+                       struct task** first, unsigned int* count);
+static void load_tasks_parse(const size_t len);
+static char* parse_annotations(struct task_detail* detail, char* pos);
+static bool parse_export_parallel(char* pos, char* end, struct arena* arena,
+                                  struct task** first, struct task** last,
+                                  unsigned int* count);
+static bool parse_lines(char* pos, char* end, struct arena* arena,
+                        struct task** first, struct task** last,
+                        unsigned int* count, const bool intern);
+static struct task* parse_object(char** line, struct arena* arena, const bool intern);
+static char* parse_tags(char** field, char* pos);
+static void* parse_worker(void* arg);
+static char* parse_task_field(struct task* tsk, const enum json_field field,
+                              char* pos);
+static void free_generation(struct task_generation* gen);
+static struct task_generation* new_generation(void);
+static char* read_export(FILE* fp, size_t* len);
 static time_t strtotime(const char* timestr);
-static void set_char(char* field, char** line);
-static void set_date(time_t* field, char** line);
-static void set_int(unsigned short* field, char** line);
-static void set_string(char** field, char** line);
+static void unhide_task(const struct task* tsk);
+static void unlink_task(struct task* this);
+static time_t utctotime(const char* timestr);
 
-char free_task(struct task* tsk) { /* {{{ */
-    /* free the memory allocated to a task
-     * tsk - the task to free
-     * return is always 0
-     */
-    char ret = 0;
+int compare_json_field(const void* key, const void* field) { /* {{{ */
+    /* bsearch comparison between a json key and a json field map entry */
+    return strcmp((const char*)key, ((const struct json_field_map*)field)->name);
+} /* }}} */
 
-    free(tsk->uuid);
+void copy_marks(struct task* first) { /* {{{ */
+    /* carry the marks of the indexed task list over to new versions of its
+     * tasks, which must run before the index is rebuilt or changed
+     * first - the first of the new tasks
+     */
+    struct task*    cur;
+    int             pos;
 
-    if (tsk->tags != NULL) {
-        free(tsk->tags);
+    if (task_marks() == 0) {
+        return;
     }
 
-    if (tsk->project != NULL) {
-        free(tsk->project);
+    for (cur = first; cur != NULL; cur = cur->next) {
+        pos = index_find_uuid(cur->detail->uuid);
+
+        if (pos >= 0 && index_get(pos)->marked) {
+            cur->marked = true;
+        }
     }
+} /* }}} */
+
+char* export_command(const char* filter, const char* args) { /* {{{ */
+    /* build a command exporting tasks
+     * filter - the filter to export tasks matching (may be NULL)
+     * args   - further arguments, such as a uuid (may be NULL)
+     * return is the malloc'd command string
+     */
+    char* cmdstr;
 
-    if (tsk->description != NULL) {
-        free(tsk->description);
+    asprintf(&cmdstr, "%s%s%s%s%s", cfg.version[0] < '2' ? "task export.json" : "task export",
+             filter != NULL && *filter != 0 ? " " : "", filter != NULL ? filter : "",
+             args != NULL ? " " : "", args != NULL ? args : "");
+
+    return cmdstr;
+} /* }}} */
+
+const char* export_filter(void) { /* {{{ */
+    /* get the filter a full load exports the task list with
+     * while the filter view applies the active filter, this is the filter
+     * the view is on top of, otherwise the view is dropped
+     */
+    if (filter_view() != NULL && loaded_filter != NULL && active_filter != NULL &&
+            strcmp(filter_view(), active_filter) == 0) {
+        return loaded_filter;
     }
 
-    free(tsk);
+    filter_clear();
 
-    return ret;
+    return active_filter != NULL ? active_filter : "";
 } /* }}} */
 
-void free_tasks(struct task* head) { /* {{{ */
-    /* free the task stack
-     * head - the first task on the stack to free
+void free_generation(struct task_generation* gen) { /* {{{ */
+    /* release all memory belonging to a load of the task list
+     * gen - the generation to free (may be NULL)
      */
-    struct task* cur;
-    struct task* next;
+    if (gen == NULL) {
+        return;
+    }
 
-    cur = head;
+    tnc_fprintf(logfp, LOG_DEBUG, "dropping task generation (%zu+%zu bytes)",
+                gen->tasks.allocated, gen->side.allocated);
+    arena_free(&(gen->tasks));
+    arena_free(&(gen->side));
 
-    while (cur != NULL) {
-        next = cur->next;
-        free_task(cur);
-        cur = next;
+    if (gen->map != NULL) {
+        munmap(gen->map, gen->maplen);
     }
+
+    free(gen);
+} /* }}} */
+
+void free_tasks(void) { /* {{{ */
+    /* free the task list by dropping the generation backing it */
+    free_generation(generation);
+    generation = NULL;
+    head = NULL;
+    hidden = NULL;
+    index_free();
+    filter_clear();
+    check_free(loaded_filter);
+    loaded_filter = NULL;
 } /* }}} */
 
 struct task* get_task_by_position(int n) { /* {{{ */
@@ -74,376 +299,1300 @@ struct task* get_task_by_position(int n) { /* {{{ */
      * return is the pointer to the task found
      * or null if n > # of tasks on the stack
      */
-    struct task* cur;
-    short        i = -1;
+    return index_get(n);
+} /* }}} */
 
-    cur = head;
+int get_task_position_by_uuid(const char* uuid) { /* {{{ */
+    /* find the task with the specified uuid
+     * uuid - the uuid to match
+     * return is the line number which matches the uuid
+     * or -1 if no task on the stack matches this uuid
+     */
+    return index_find_uuid(uuid);
+} /* }}} */
 
-    while (cur != NULL) {
-        i++;
+struct task* get_tasks(char* uuid) { /* {{{ */
+    /* parse the task list
+     * uuid - specific task to obtain information for
+     *        pass NULL to get a full task list
+     * return is the task data for a single task, if a uuid was passed
+     * or all tasks, if uuid == NULL
+     * a full load is built in a fresh generation, which then replaces the
+     * generation backing the previous task list
+     * a single task is allocated from the side pool of the current generation
+     */
+    char*                   cmdstr;
+    unsigned int            counter = 0;
+    struct arena*           arena;
+    struct task_generation* gen = NULL;
+    struct task*            new_head;
+    const char*             filter;
+
+    /* pick the arena the tasks will live in, and the filter they must match */
+    if (uuid == NULL) {
+        gen = new_generation();
+        arena = &(gen->tasks);
+        filter = export_filter();
+    } else {
+        if (generation == NULL) {
+            generation = new_generation();
+        }
 
-        if (i == n) {
+        arena = &(generation->side);
+        filter = loaded_filter != NULL ? loaded_filter : active_filter;
+    }
+
+    /* run command */
+    cmdstr = export_command(filter, uuid);
+
+    if (!run_export(cmdstr, arena, &new_head, &counter)) {
+        new_head = NULL;
+    }
+
+    free(cmdstr);
+
+    /* sort tasks */
+    if (new_head != NULL) {
+        new_head = sort_tasks(new_head);
+    }
+
+    /* a full load replaces the generation of the previous task list */
+    if (gen != NULL) {
+        new_head = replace_generation(gen, new_head, filter);
+    }
+
+    return new_head;
+} /* }}} */
+
+unsigned int get_task_id(char* uuid) { /* {{{ */
+    /* given a task uuid, find its id using a custom report
+     * necessary to do without uuid addressing in task v2
+     * uuid - the task to find the id of
+     * return is the id of the task specified
+     */
+    FILE*           cmd;
+    char            line[128];
+    char            format[128];
+    int             ret;
+    unsigned int    id = 0;
+
+    /* generate format to scan for */
+    sprintf(format, "%s %%u", uuid);
+
+    /* run command */
+    cmd = process_open("task rc.report.all.columns:uuid,id rc.report.all.labels:UUID,id rc.report.all.sort:id- all status:pending rc._forcecolor=no");
+
+    while (fgets(line, sizeof(line) - 1, cmd) != NULL) {
+        ret = sscanf(line, format, &id);
+
+        if (ret > 0) {
             break;
         }
+    }
 
-        cur = cur->next;
+    process_close(cmd);
+
+    return id;
+} /* }}} */
+
+void hide_task(struct task* this) { /* {{{ */
+    /* add a task to the hidden tasks
+     * a hidden task cannot be seen, so its mark is dropped
+     * this - the task to hide, which is not in the task list
+     */
+    this->marked = false;
+    this->prev = NULL;
+    this->next = hidden;
+
+    if (hidden != NULL) {
+        hidden->prev = this;
     }
 
-    return cur;
+    hidden = this;
 } /* }}} */
 
-int get_task_position_by_uuid(const char* uuid) { /* {{{ */
-    /* find the task with the specified uuid
-     * uuid - the uuid to match
-     * return is the line number which matches the uuid
-     * or -1 if no task on the stack matches this uuid
+struct task* hide_tasks(struct task* first) { /* {{{ */
+    /* move the tasks of a list which the filter view does not show to the
+     * hidden tasks, keeping the order of the rest
+     * first - the first task of the list
+     * return is the first task which is shown
      */
-    struct task* cur;
-    int          pos = 0;
+    struct task*    shown = NULL;
+    struct task*    last = NULL;
+    struct task*    cur;
+    struct task*    next;
+    long long       start;
 
-    cur = head;
+    if (filter_view() == NULL) {
+        return first;
+    }
 
-    while (cur != NULL && !str_eq(cur->uuid, uuid)) {
-        cur = cur->next;
-        pos++;
+    start = metrics_start();
+
+    for (cur = first; cur != NULL; cur = next) {
+        next = cur->next;
+
+        if (!filter_match(cur)) {
+            hide_task(cur);
+            continue;
+        }
+
+        cur->prev = last;
+
+        if (last != NULL) {
+            last->next = cur;
+        } else {
+            shown = cur;
+        }
+
+        last = cur;
     }
 
-    if (cur != NULL && str_eq(cur->uuid, uuid)) {
-        return pos;
-    } else {
-        return -1;
+    if (last != NULL) {
+        last->next = NULL;
     }
+
+    metrics_end(PHASE_FILTER, start);
+
+    return shown;
 } /* }}} */
 
-struct task* get_tasks(char* uuid) { /* {{{ */
-    /* parse the task list
-     * uuid - specific task to obtain information for
-     *        pass NULL to get a full task list
-     * return is the task data for a single task, if a uuid was passed
-     * or all tasks, if uuid == NULL
+struct task* join_tasks(struct task* first, struct task* second) { /* {{{ */
+    /* append a task list to another
+     * first  - the first task of the list appended to (may be NULL)
+     * second - the first task of the list appended (may be NULL)
+     * return is the first task of the joined list
      */
-    FILE*           cmd;
-    char*           line;
-    char*           tmp;
-    char*           cmdstr;
-    int             linelen = TOTALLENGTH;
-    unsigned short  counter = 0;
-    struct task*    last;
-    struct task*    new_head;
+    struct task* tail;
+
+    if (first == NULL) {
+        return second;
+    }
 
-    /* generate & run command */
-    cmdstr = calloc(128, sizeof(char));
+    for (tail = first; tail->next != NULL; tail = tail->next);
 
-    if (cfg.version[0] < '2') {
-        strcat(cmdstr, "task export.json");
-    } else {
-        strcat(cmdstr, "task export");
+    tail->next = second;
+
+    if (second != NULL) {
+        second->prev = tail;
     }
 
-    if (active_filter != NULL) {
-        strcat(cmdstr, " ");
-        strcat(cmdstr, active_filter);
+    return first;
+} /* }}} */
+
+void load_tasks_cancel(void) { /* {{{ */
+    /* stop a background load, dropping the tasks it has not yet shown */
+    if (loader.cmd == NULL) {
+        return;
     }
 
-    if (uuid != NULL) {
-        strcat(cmdstr, " ");
-        strcat(cmdstr, uuid);
+    tnc_fprintf(logfp, LOG_DEBUG, "cancelling task load (%d tasks read)",
+                loader.count);
+
+    /* closing the pipe first ends the export */
+    process_close(loader.cmd);
+    free(loader.buffer);
+
+    if (!loader.painted) {
+        free_generation(loader.gen);
     }
 
-    tnc_fprintf(logfp, LOG_DEBUG, "reloading tasks (%s)", cmdstr);
-    cmd = popen(cmdstr, "r");
+    check_free(loader.filter);
+    memset(&loader, 0, sizeof(loader));
+} /* }}} */
 
-    if (cmd == NULL) {
+struct task* load_tasks_export(const char* data, const size_t len) { /* {{{ */
+    /**
+     * replace the task list with tasks parsed from export output held in
+     * memory, as get_tasks does for a full load
+     * this lets the benchmarks load tasks without running taskwarrior
+     * data - the export output
+     * len  - the length of data
+     * return is the first task of the new list
+     */
+    struct task_generation* gen = new_generation();
+    struct task*            first = NULL;
+    struct task*            last = NULL;
+    unsigned int            count = 0;
+    char*                   copy;
+
+    copy = arena_strndup(&(gen->tasks), data, len);
+
+    if (copy == NULL || !parse_export_parallel(copy, copy + len, &(gen->tasks), &first,
+                                               &last, &count)) {
+        first = NULL;
+    }
+
+    if (first != NULL) {
+        first = sort_tasks(first);
+    }
+
+    return replace_generation(gen, first, export_filter());
+} /* }}} */
+
+void load_tasks_finish(void) { /* {{{ */
+    /* replace the task list with a background load which has completed
+     * any part of the load shown early is sorted in with the rest, along with
+     * the part of it which the filter view hid
+     */
+    struct task* new_head = loader.first;
+
+    if (loader.cmd != NULL || loader.gen == NULL) {
+        return;
+    }
+
+    if (loader.painted) {
+        new_head = join_tasks(join_tasks(head, hidden), loader.first);
+    }
+
+    hidden = NULL;
+
+    if (loader.failed) {
+        tnc_fprintf(logfp, LOG_ERROR, "failed to parse task export");
+        new_head = NULL;
+    }
+
+    if (new_head != NULL) {
+        new_head = sort_tasks(new_head);
+    }
+
+    watermark = newest_modified(new_head);
+    tnc_fprintf(logfp, LOG_DEBUG, "task load complete (%d tasks)", loader.count);
+
+    /* the snapshot holds every task loaded, whatever the filter view shows */
+    if (cfg.snapshot && new_head != NULL) {
+        snapshot_write(new_head, loader.filter, &(loader.stamp));
+    }
+
+    /* as in get_tasks, index the new list before the old one is freed */
+    new_head = hide_tasks(new_head);
+    copy_marks(new_head);
+    index_build(new_head);
+
+    if (!loader.painted) {
+        free_generation(generation);
+        generation = loader.gen;
+    }
+
+    head = new_head;
+    check_free(loaded_filter);
+    loaded_filter = loader.filter;
+
+    memset(&loader, 0, sizeof(loader));
+} /* }}} */
+
+void load_tasks_parse(const size_t len) { /* {{{ */
+    /* parse the first lines of output read by the background loader
+     * len - the number of bytes to parse, which must end a line
+     * the lines are copied into the load's arena for the tasks to point into
+     */
+    char* data;
+
+    if (len == 0) {
+        return;
+    }
+
+    if (!loader.failed) {
+        data = arena_strndup(&(loader.gen->tasks), loader.buffer, len);
+
+        if (data == NULL || !parse_export(data, data + len, &(loader.gen->tasks),
+                                          &(loader.first), &(loader.last), &(loader.count))) {
+            loader.failed = true;
+        }
+    }
+
+    loader.length -= len;
+    memmove(loader.buffer, loader.buffer + len, loader.length);
+} /* }}} */
+
+bool load_tasks_snapshot(void) { /* {{{ */
+    /* replace the task list with the one saved in the snapshot file
+     * return is whether a valid snapshot was found
+     */
+    struct task_generation* gen = new_generation();
+    struct task*            first;
+    const char*             filter = export_filter();
+
+    first = snapshot_read(&(gen->tasks), filter, &(gen->map), &(gen->maplen));
+
+    if (first == NULL) {
+        free_generation(gen);
+        return false;
+    }
+
+    watermark = newest_modified(first);
+    hidden = NULL;
+    first = hide_tasks(first);
+    index_build(first);
+    free_generation(generation);
+    generation = gen;
+    head = first;
+    filter = strdup(filter);
+    check_free(loaded_filter);
+    loaded_filter = (char*)filter;
+
+    return true;
+} /* }}} */
+
+bool load_tasks_pending(void) { /* {{{ */
+    /* check whether a background load is still running */
+    return loader.cmd != NULL;
+} /* }}} */
+
+enum load_status load_tasks_poll(const int screenful) { /* {{{ */
+    /* read and parse whatever output of a background load is available
+     * without blocking
+     * screenful - the number of tasks which fill the task list window
+     *             if the task list is empty, this many tasks are shown
+     *             as soon as they have been read
+     * return is LOAD_READY once the load has completed and should be
+     * applied by load_tasks_finish, LOAD_PAINTED if the start of the load
+     * was just put in the task list, or LOAD_RUNNING otherwise
+     */
+    ssize_t ret;
+    char*   eol;
+    char*   tmp;
+    bool    eof = false;
+
+    if (loader.cmd == NULL) {
+        return LOAD_READY;
+    }
+
+    while (1) {
+        /* grow buffer to fit a full pipe */
+        if (loader.size - loader.length < EXPORTLENGTH) {
+            tmp = realloc(loader.buffer, loader.size + EXPORTLENGTH);
+
+            if (tmp == NULL) {
+                loader.failed = true;
+                eof = true;
+                break;
+            }
+
+            loader.buffer = tmp;
+            loader.size += EXPORTLENGTH;
+        }
+
+        ret = read(fileno(loader.cmd), loader.buffer + loader.length,
+                   loader.size - loader.length - 1);
+
+        if (ret < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                tnc_fprintf(logfp, LOG_ERROR, "reading task export failed: %s",
+                            strerror(errno));
+                loader.failed = true;
+                eof = true;
+            }
+
+            break;
+        } else if (ret == 0) {
+            eof = true;
+            break;
+        }
+
+        /* export writes a task per line, so parse up to the last line end */
+        loader.length += ret;
+        eol = memrchr(loader.buffer, '\n', loader.length);
+
+        if (eol != NULL) {
+            load_tasks_parse(eol + 1 - loader.buffer);
+        }
+    }
+
+    /* complete the load */
+    if (eof) {
+        load_tasks_parse(loader.length);
+        metrics_end(PHASE_EXPORT, loader.started);
+        process_close(loader.cmd);
+        loader.cmd = NULL;
+        free(loader.buffer);
+        loader.buffer = NULL;
+        loader.length = loader.size = 0;
+
+        return LOAD_READY;
+    }
+
+    /* show the first screenful of an empty task list right away */
+    if (!loader.painted && !loader.failed && head == NULL &&
+            (int)loader.count >= screenful) {
+        free_generation(generation);
+        generation = loader.gen;
+        hidden = NULL;
+        check_free(loaded_filter);
+        loaded_filter = strdup(loader.filter);
+        head = sort_tasks(hide_tasks(loader.first));
+        index_build(head);
+        loader.first = loader.last = NULL;
+        loader.painted = true;
+        tnc_fprintf(logfp, LOG_DEBUG, "showing first %d tasks while loading",
+                    loader.count);
+
+        return LOAD_PAINTED;
+    }
+
+    return LOAD_RUNNING;
+} /* }}} */
+
+void load_tasks_refresh(void) { /* {{{ */
+    /* restart a running background load after the task database has changed,
+     * so the task list it produces reflects the change */
+    if (loader.cmd != NULL) {
+        load_tasks_start();
+    }
+} /* }}} */
+
+void load_tasks_start(void) { /* {{{ */
+    /* start loading the full task list in the background
+     * the current task list stays in place until load_tasks_poll reports
+     * the load has completed, a load already running is restarted
+     */
+    const char* filter;
+    char*       cmdstr;
+    int         flags;
+
+    load_tasks_cancel();
+
+    /* the data files are checked before the export reads them, so a
+     * snapshot of the result is never newer than its stamp */
+    if (cfg.snapshot) {
+        snapshot_stamp(&(loader.stamp));
+    }
+
+    filter = export_filter();
+    cmdstr = export_command(filter, NULL);
+    tnc_fprintf(logfp, LOG_DEBUG, "loading tasks in background (%s)", cmdstr);
+    loader.cmd = process_open(cmdstr);
+
+    if (loader.cmd == NULL) {
         tnc_fprintf(logfp, LOG_ERROR, "could not execute command: (%s)", cmdstr);
-        tnc_fprintf(stdout, LOG_ERROR, "could not execute command: (%s)", cmdstr);
         free(cmdstr);
-        return NULL;
+        return;
     }
 
     free(cmdstr);
 
-    /* parse output */
-    last        = NULL;
-    new_head    = NULL;
-    line        = calloc(linelen, sizeof(char));
+    /* never block on the export */
+    flags = fcntl(fileno(loader.cmd), F_GETFL);
+    fcntl(fileno(loader.cmd), F_SETFL, flags | O_NONBLOCK);
 
-    while (fgets(line, linelen - 1, cmd) != NULL || !feof(cmd)) {
-        struct task* this;
+    loader.gen = new_generation();
+    loader.filter = strdup(filter);
+    loader.started = metrics_start();
+} /* }}} */
+
+struct task* malloc_task(struct arena* arena) { /* {{{ */
+    /* allocate memory for a new task
+     * and initialize values where necessary
+     * arena - the arena the task is allocated from
+     * return is the newly allocated task
+     */
+    struct task* tsk = arena_alloc(arena, sizeof(struct task));
 
-        /* check for longer lines */
-        while (strchr(line, '\n') == NULL) {
-            linelen += TOTALLENGTH;
-            line = realloc(line, linelen * sizeof(char));
-            tmp = calloc(TOTALLENGTH, sizeof(char));
+    if (tsk == NULL) {
+        return NULL;
+    }
 
-            if (fgets(tmp, TOTALLENGTH - 1, cmd) == NULL) {
-                break;
+    /* the detail is only read once a task is acted on, or its line drawn */
+    tsk->detail = arena_alloc(arena, sizeof(struct task_detail));
+
+    if (tsk->detail == NULL) {
+        return NULL;
+    }
+
+    tsk->pair           = -1;
+    tsk->selpair        = -1;
+
+    return tsk;
+} /* }}} */
+
+struct task_generation* new_generation(void) { /* {{{ */
+    /* create an empty generation to load a task list into
+     * return is the new generation
+     */
+    struct task_generation* gen = calloc(1, sizeof(struct task_generation));
+
+    arena_init(&(gen->tasks), TASKARENALENGTH);
+    arena_init(&(gen->side), SIDEPOOLLENGTH);
+
+    return gen;
+} /* }}} */
+
+time_t newest_modified(struct task* first) { /* {{{ */
+    /* find the newest modification time in a task list
+     * first - the first task of the list
+     * return is the time, or 0 if no task has one
+     */
+    time_t ret = 0;
+
+    for (; first != NULL; first = first->next) {
+        if (first->detail->modified > ret) {
+            ret = first->detail->modified;
+        }
+    }
+
+    return ret;
+} /* }}} */
+
+bool parse_export(char* pos, char* end, struct arena* arena,
+                  struct task** first, struct task** last,
+                  unsigned int* count) { /* {{{ */
+    /* parse the task objects of export output, appending them to a list
+     * pos   - the start of the output, which is modified in place
+     * end   - the end of the output
+     * arena - the arena the tasks are allocated from
+     * first - the first task of the list, set if the list was empty
+     * last  - the last task of the list, updated as tasks are appended
+     * count - the number of tasks in the list, updated as tasks are appended
+     * return is false if the output held a task without uuid or description
+     */
+    const long long start = metrics_start();
+    bool            ret;
+
+    ret = parse_lines(pos, end, arena, first, last, count, true);
+    metrics_end(PHASE_PARSE, start);
+
+    return ret;
+} /* }}} */
+
+bool parse_export_parallel(char* pos, char* end, struct arena* arena,
+                           struct task** first, struct task** last,
+                           unsigned int* count) { /* {{{ */
+    /* parse export output as parse_export does, shared between threads
+     * export output holds a task per line, so it is split at line ends into
+     * a part for each thread, which parses it into an arena of its own
+     * the parts are then joined in order, and their projects and tags
+     * interned, as the symbol table is not shared between threads
+     * output too short to be worth splitting is parsed by parse_export, as is
+     * output which is logged line by line
+     * pos   - the start of the output, which is modified in place
+     * end   - the end of the output
+     * arena - the arena the tasks end up in
+     * first - the first task of the list, set if the list was empty
+     * last  - the last task of the list, updated as tasks are appended
+     * count - the number of tasks in the list, updated as tasks are appended
+     * return is false if the output held a task without uuid or description
+     */
+    struct parse_part*  parts;
+    struct task*        cur;
+    char*               cut = pos;
+    char*               share;
+    const int           nparts = end - pos >= PARALLELPARSELENGTH &&
+                                 cfg.loglvl < LOG_DEBUG_VERBOSE ? thread_count() : 1;
+    long long           start;
+    bool                ret = true;
+    int                 i;
+
+    if (nparts < 2 || (parts = calloc(nparts, sizeof(struct parse_part))) == NULL) {
+        return parse_export(pos, end, arena, first, last, count);
+    }
+
+    start = metrics_start();
+
+    /* split the output after the line end following each share of it */
+    for (i = 0; i < nparts; i++) {
+        parts[i].pos = cut;
+
+        share = pos + (end - pos) * (i + 1) / nparts;
+
+        if (i == nparts - 1) {
+            cut = end;
+        } else if (share > cut) {
+            cut = memchr(share, '\n', end - share);
+            cut = cut != NULL ? cut + 1 : end;
+        }
+
+        parts[i].end = cut;
+        arena_init(&(parts[i].arena), TASKARENALENGTH);
+    }
+
+    /* the last part is parsed by this thread, as are those no thread could
+     * be started for */
+    for (i = 0; i < nparts - 1; i++) {
+        parts[i].started = pthread_create(&(parts[i].thread), NULL, parse_worker,
+                                          parts + i) == 0;
+
+        if (!parts[i].started) {
+            parse_worker(parts + i);
+        }
+    }
+
+    parse_worker(parts + nparts - 1);
+
+    /* join the parts in order */
+    for (i = 0; i < nparts; i++) {
+        if (i < nparts - 1 && parts[i].started) {
+            pthread_join(parts[i].thread, NULL);
+        }
+
+        arena_merge(arena, &(parts[i].arena));
+        ret = ret && parts[i].ret;
+
+        if (parts[i].first == NULL) {
+            continue;
+        }
+
+        for (cur = parts[i].first; cur != NULL; cur = cur->next) {
+            intern_task(cur, arena);
+        }
+
+        parts[i].first->prev = *last;
+
+        if (*last == NULL) {
+            *first = parts[i].first;
+        } else {
+            (*last)->next = parts[i].first;
+        }
+
+        *last = parts[i].last;
+        *count += parts[i].count;
+    }
+
+    free(parts);
+    metrics_end(PHASE_PARSE, start);
+    tnc_fprintf(logfp, LOG_DEBUG, "parsed %u tasks in %d threads", *count, nparts);
+
+    return ret;
+} /* }}} */
+
+bool parse_lines(char* pos, char* end, struct arena* arena,
+                 struct task** first, struct task** last,
+                 unsigned int* count, const bool intern) { /* {{{ */
+    /* parse the task objects of export output, as parse_export does
+     * pos    - the start of the output, which is modified in place
+     * end    - the end of the output
+     * arena  - the arena the tasks are allocated from
+     * first  - the first task of the list, set if the list was empty
+     * last   - the last task of the list, updated as tasks are appended
+     * count  - the number of tasks in the list, updated as tasks are appended
+     * intern - whether the projects and tags of the tasks are interned
+     * return is false if the output held a task without uuid or description
+     */
+    char*           eol;
+    struct task*    this;
+
+    while (pos < end) {
+        /* skip array punctuation between tasks */
+        pos = json_skip_ws(pos);
+
+        if (*pos == '[' || *pos == ']' || *pos == ',') {
+            pos++;
+            continue;
+        }
+
+        if (pos >= end) {
+            break;
+        }
+
+        /* find end of line before parsing modifies it, and log line */
+        eol = memchr(pos, '\n', end - pos);
+        eol = eol != NULL ? eol + 1 : end;
+        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "%.*s", (int)(eol - pos), pos);
+
+        /* parse task */
+        this = parse_object(&pos, arena, intern);
+
+        if (this == (struct task*) - 1) {
+            pos = eol;
+            continue;
+        } else if (this->detail->uuid == NULL ||
+                   this->detail->description == NULL) {
+            return false;
+        }
+
+        /* set pointers */
+        this->prev = *last;
+
+        if (*last == NULL) {
+            *first = this;
+        } else {
+            (*last)->next = this;
+        }
+
+        *last = this;
+        (*count)++;
+        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "uuid:        %s", this->detail->uuid);
+        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "description: %s", this->detail->description);
+        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "project:     %s", this->project);
+        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "tags:        %s", this->detail->tags);
+    }
+
+    return true;
+} /* }}} */
+
+char* parse_annotations(struct task_detail* detail, char* pos) { /* {{{ */
+    /* parse a json array of annotations into a string of their descriptions,
+     * one per line
+     * the string is compacted in place over the array, as tags are
+     * detail - the detail of the task the annotations belong to
+     * pos    - the position of the opening bracket
+     * return is the position after the array, or NULL on failure
+     */
+    char*   out = pos;
+    char*   key;
+    char*   str;
+    size_t  len;
+
+    pos = json_expect(pos, '[');
+
+    if (pos == NULL) {
+        return NULL;
+    }
+
+    pos = json_skip_ws(pos);
+
+    while (*pos != ']') {
+        pos = json_expect(pos, '{');
+
+        /* keep the description among the fields of the annotation */
+        while (pos != NULL && *(pos = json_skip_ws(pos)) != '}') {
+            pos = json_parse_string(pos, &key, NULL);
+
+            if (pos != NULL) {
+                pos = json_expect(pos, ':');
+            }
+
+            if (pos == NULL) {
+                return NULL;
+            }
+
+            pos = json_skip_ws(pos);
+
+            if (str_eq(key, "description") && json_peek(pos) == JSON_STRING) {
+                pos = json_parse_string(pos, &str, &len);
+
+                if (pos == NULL) {
+                    return NULL;
+                }
+
+                /* append description to compacted list */
+                if (detail->annotations == NULL) {
+                    detail->annotations = out;
+                } else {
+                    *(out++) = '\n';
+                }
+
+                memmove(out, str, len);
+                out += len;
+                detail->nannotations++;
+            } else {
+                pos = json_skip_value(pos);
+
+                if (pos == NULL) {
+                    return NULL;
+                }
+            }
+
+            /* move to next field */
+            pos = json_skip_ws(pos);
+
+            if (*pos == ',') {
+                pos++;
+            } else if (*pos != '}') {
+                return NULL;
             }
+        }
+
+        if (pos == NULL) {
+            return NULL;
+        }
 
-            strcat(line, tmp);
-            free(tmp);
+        /* move to next annotation */
+        pos = json_skip_ws(pos + 1);
+
+        if (*pos == ',') {
+            pos = json_skip_ws(pos + 1);
+        } else if (*pos != ']') {
+            return NULL;
         }
+    }
+
+    if (detail->annotations != NULL) {
+        *out = 0;
+        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "string: %s", detail->annotations);
+    }
+
+    return pos + 1;
+} /* }}} */
 
-        /* remove escapes */
-        remove_char(line, '\\');
+char* parse_tags(char** field, char* pos) { /* {{{ */
+    /* parse a json array of tags into a string of the form "tag1","tag2"
+     * the string is compacted in place over the array, which is always longer
+     * than the result
+     * field - where the tags string is stored
+     * pos   - the position of the opening bracket
+     * return is the position after the array, or NULL on failure
+     */
+    char*   out = pos;
+    char*   tag;
+    size_t  len;
+
+    pos = json_expect(pos, '[');
 
-        /* log line */
-        tmp = strchr(line, '\n');
-        *tmp = 0;
-        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, line);
+    if (pos == NULL) {
+        return NULL;
+    }
 
-        /* parse line */
-        this = parse_task(line);
+    pos = json_skip_ws(pos);
 
-        if (this == NULL) {
+    while (*pos != ']') {
+        pos = json_parse_string(pos, &tag, &len);
+
+        if (pos == NULL) {
             return NULL;
-        } else if (this == (struct task*) - 1) {
-            continue;
-        } else if (this->uuid == NULL ||
-                   this->description == NULL) {
+        }
+
+        /* append tag to compacted list */
+        if (*field == NULL) {
+            *field = out;
+        } else {
+            *(out++) = ',';
+        }
+
+        *(out++) = '"';
+        memmove(out, tag, len);
+        out += len;
+        *(out++) = '"';
+
+        /* move to next tag */
+        pos = json_skip_ws(pos);
+
+        if (*pos == ',') {
+            pos = json_skip_ws(pos + 1);
+        } else if (*pos != ']') {
             return NULL;
         }
+    }
+
+    if (*field != NULL) {
+        *out = 0;
+        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "string: %s", *field);
+    }
+
+    return pos + 1;
+} /* }}} */
+
+struct task* parse_object(char** line, struct arena* arena, const bool intern) { /* {{{ */
+    /* parse a task object, as parse_task does
+     * line   - the position of the object, which is modified in place
+     * arena  - the arena the task is allocated from
+     * intern - whether the project and tags of the task are interned
+     * return is the task structure defined in the object,
+     * or -1 if this is not a task or parsing failed
+     */
+    struct task*                    tsk;
+    char*                           pos = json_skip_ws(*line);
+    char*                           key;
+    const struct json_field_map*    map;
+
+    /* detect lines that are not json */
+    if (*pos != '{') {
+        return (struct task*) - 1;
+    }
+
+    tsk = malloc_task(arena);
+
+    if (tsk == NULL) {
+        return (struct task*) - 1;
+    }
+
+    pos = json_skip_ws(pos + 1);
+
+    if (*pos == '}') {
+        *line = pos + 1;
+
+        if (intern) {
+            intern_task(tsk, arena);
+        }
+
+        return tsk;
+    }
+
+    /* parse json */
+    while (1) {
+        /* get field */
+        pos = json_parse_string(json_skip_ws(pos), &key, NULL);
+
+        if (pos != NULL) {
+            pos = json_expect(pos, ':');
+        }
+
+        if (pos == NULL) {
+            break;
+        }
+
+        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "field: %s", key);
+
+        /* determine how to handle content */
+        pos = json_skip_ws(pos);
+        map = bsearch(key, json_fields, NJSONFIELDS, sizeof(struct json_field_map),
+                      compare_json_field);
+
+        if (map != NULL) {
+            pos = parse_task_field(tsk, map->field, pos);
+        } else { /* unknown field */
+            pos = json_skip_value(pos);
+        }
+
+        if (pos == NULL) {
+            break;
+        }
+
+        /* move to next field or terminate at end of object */
+        pos = json_skip_ws(pos);
+
+        if (*pos == ',') {
+            pos++;
+        } else if (*pos == '}') {
+            *line = pos + 1;
+
+            if (intern) {
+                intern_task(tsk, arena);
+            }
+
+            return tsk;
+        } else {
+            break;
+        }
+    }
+
+    tnc_fprintf(logfp, LOG_ERROR, "error parsing task @ %s", *line);
+
+    return (struct task*) - 1;
+} /* }}} */
+
+struct task* parse_task(char** line, struct arena* arena) { /* {{{ */
+    /* parse a task object from the output of `task export ...`
+     * line  - the position of the object, which is modified in place
+     *         its strings are unescaped in place and the task points to them
+     *         on success, this is advanced past the object
+     * arena - the arena the task is allocated from
+     * return is the task structure defined in the object,
+     * or -1 if this is not a task or parsing failed
+     */
+    return parse_object(line, arena, true);
+} /* }}} */
+
+char* parse_task_field(struct task* tsk, const enum json_field field,
+                       char* pos) { /* {{{ */
+    /* parse the value of a known field into a task
+     * tsk   - the task being filled in
+     * field - the field being parsed
+     * pos   - the position of the value
+     * return is the position after the value, or NULL on failure
+     */
+    char*   str;
+    double  num;
+
+    /* null values leave the field unset */
+    if (json_peek(pos) == JSON_NULL) {
+        return json_skip_value(pos);
+    }
+
+    switch (field) {
+    case JSON_FIELD_ID:
+        pos = json_parse_number(pos, &num);
+
+        if (pos != NULL) {
+            tsk->index = (unsigned int)num;
+            tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "int: %u", tsk->index);
+        }
+
+        return pos;
+
+    case JSON_FIELD_URGENCY:
+        return json_parse_number(pos, &(tsk->detail->urgency));
+
+    case JSON_FIELD_TAGS:
+        return parse_tags(&(tsk->detail->tags), pos);
+
+    case JSON_FIELD_ANNOTATIONS:
+        return parse_annotations(tsk->detail, pos);
+
+    default:
+        break;
+    }
+
+    /* the remaining fields are strings */
+    pos = json_parse_string(pos, &str, NULL);
+
+    if (pos == NULL) {
+        tnc_fprintf(logfp, LOG_ERROR, "error parsing string");
+        return NULL;
+    }
+
+    tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "string: %s", str);
+
+    switch (field) {
+    case JSON_FIELD_DESCRIPTION:
+        tsk->detail->description = str;
+        break;
+
+    case JSON_FIELD_PROJECT:
+        tsk->project = str;
+        break;
+
+    case JSON_FIELD_UUID:
+        tsk->detail->uuid = str;
+        uuid_to_key(str, tsk->uuidkey);
+        break;
+
+    case JSON_FIELD_PRIORITY:
+        tsk->priority = *str;
+        break;
 
-        /* set pointers */
-        this->prev = last;
+    case JSON_FIELD_DUE:
+        tsk->due = strtotime(str);
+        break;
 
-        if (counter == 0) {
-            new_head = this;
-        }
+    case JSON_FIELD_END:
+        tsk->detail->end = strtotime(str);
+        break;
 
-        if (counter > 0) {
-            last->next = this;
-        }
+    case JSON_FIELD_ENTRY:
+        tsk->detail->entry = strtotime(str);
+        break;
 
-        last = this;
-        counter++;
-        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "uuid:        %s", this->uuid);
-        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "description: %s", this->description);
-        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "project:     %s", this->project);
-        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "tags:        %s", this->tags);
+    case JSON_FIELD_START:
+        tsk->start = strtotime(str);
+        break;
 
-        /* prepare a new line */
-        free(line);
-        line = calloc(linelen, sizeof(char));
-    }
+    case JSON_FIELD_MODIFIED:
+        tsk->detail->modified = utctotime(str);
+        break;
 
-    free(line);
-    pclose(cmd);
+    case JSON_FIELD_STATUS:
+        tsk->detail->status = *str;
+        break;
 
-    /* sort tasks */
-    if (new_head != NULL) {
-        sort_wrapper(new_head);
+    default:
+        break;
     }
 
-    return new_head;
+    return pos;
 } /* }}} */
 
-unsigned short get_task_id(char* uuid) { /* {{{ */
-    /* given a task uuid, find its id using a custom report
-     * necessary to do without uuid addressing in task v2
-     * uuid - the task to find the id of
-     * return is the id of the task specified
+void* parse_worker(void* arg) { /* {{{ */
+    /* parse a share of export output, as a thread started by parse_export_parallel
+     * arg - the part to be parsed
+     * return is NULL
      */
-    FILE*           cmd;
-    char            line[128];
-    char            format[128];
-    int             ret;
-    unsigned short  id = 0;
+    struct parse_part* part = arg;
 
-    /* generate format to scan for */
-    sprintf(format, "%s %%hu", uuid);
+    part->ret = parse_lines(part->pos, part->end, &(part->arena), &(part->first),
+                            &(part->last), &(part->count), false);
 
-    /* run command */
-    cmd = popen("task rc.report.all.columns:uuid,id rc.report.all.labels:UUID,id rc.report.all.sort:id- all status:pending rc._forcecolor=no",
-                "r");
+    return NULL;
+} /* }}} */
 
-    while (fgets(line, sizeof(line) - 1, cmd) != NULL) {
-        ret = sscanf(line, format, &id);
+char* read_export(FILE* fp, size_t* len) { /* {{{ */
+    /* read the complete output of an export command into one buffer
+     * fp  - the pipe to read from
+     * len - where the length of the output is stored
+     * return is the malloc'd, null terminated output, or NULL on failure
+     */
+    char*   data;
+    char*   tmp;
+    size_t  size = EXPORTLENGTH;
+    size_t  ret;
 
-        if (ret > 0) {
+    data = malloc(size * sizeof(char));
+    *len = 0;
+
+    if (data == NULL) {
+        return NULL;
+    }
+
+    while (1) {
+        ret = fread(data + *len, sizeof(char), size - *len - 1, fp);
+        *len += ret;
+
+        if (*len < size - 1) {
             break;
         }
+
+        /* grow buffer */
+        size *= 2;
+        tmp = realloc(data, size * sizeof(char));
+
+        if (tmp == NULL) {
+            free(data);
+            return NULL;
+        }
+
+        data = tmp;
     }
 
-    pclose(cmd);
+    data[*len] = 0;
 
-    return id;
+    return data;
 } /* }}} */
 
-struct task* malloc_task(void) { /* {{{ */
-    /* allocate memory for a new task
-     * and initialize values where necessary
-     * return is the newly allocated task
+bool refresh_tasks(void) { /* {{{ */
+    /* update the task list with the tasks modified since the last load
+     * tasks which changed and still match the filter are put at their new
+     * place in the sort order, the rest of the changed tasks are dropped
+     * return is false if a full reload is needed instead
      */
-    struct task* tsk = calloc(1, sizeof(struct task));
-
-    if (tsk == NULL) {
-        return NULL;
+    struct task*    changed;
+    struct task*    matching;
+    struct task*    cur;
+    struct task*    next;
+    struct tm       tmr;
+    char            since[TIMELENGTH];
+    char*           filter;
+    char*           cmdstr;
+    unsigned int    nchanged;
+    unsigned int    nmatching;
+    time_t          newest = watermark;
+    bool            ok;
+    bool            bulk;
+    int             pos;
+
+    if (watermark == 0 || generation == NULL || load_tasks_pending()) {
+        return false;
     }
 
-    tsk->index          = 0;
-    tsk->uuid           = NULL;
-    tsk->tags           = NULL;
-    tsk->start          = 0;
-    tsk->end            = 0;
-    tsk->entry          = 0;
-    tsk->due            = 0;
-    tsk->project        = NULL;
-    tsk->priority       = 0;
-    tsk->description    = NULL;
-    tsk->next           = NULL;
-    tsk->prev           = NULL;
-    tsk->pair           = -1;
-    tsk->selpair        = -1;
+    /* overlap by a second, as modification times have a second resolution */
+    newest = watermark - 1;
+    gmtime_r(&newest, &tmr);
+    strftime(since, TIMELENGTH, "modified.after:%Y%m%dT%H%M%SZ", &tmr);
+    newest = watermark;
 
-    return tsk;
-} /* }}} */
+    /* export every changed task, whatever its status, to find tasks which
+     * stopped matching the filter */
+    cmdstr = export_command(NULL, since);
+    ok = run_export(cmdstr, &(generation->side), &changed, &nchanged);
+    free(cmdstr);
 
-struct task* parse_task(char* line) { /* {{{ */
-    /* parse a line of output from `task export ...`
-     * line - the line to parse
-     * return is the task structure defined in the line,
-     * or -1 if this line is not a task or parsing failed
-     */
-    struct task* tsk = malloc_task();
+    if (!ok) {
+        return false;
+    }
 
-    /* detect lines that are not json */
-    if (*line != '{') {
-        return (struct task*) - 1;
+    if (nchanged == 0) {
+        tnc_fprintf(logfp, LOG_DEBUG, "refresh: no tasks modified");
+        return true;
     }
 
-    line++;
+    /* export changed tasks which still match the filter */
+    if (loaded_filter != NULL && *loaded_filter != 0) {
+        asprintf(&filter, "\\( %s \\)", loaded_filter);
+        cmdstr = export_command(filter, since);
+        ok = run_export(cmdstr, &(generation->side), &matching, &nmatching);
+        free(cmdstr);
+        free(filter);
 
-    /* parse json */
-    while (*line != 0) {
-        /* local vars */
-        char* field = NULL;
-        int ret;
-
-        /* skip field delimiters */
-        if (*line == ',') {
-            line++;
-            continue;
+        if (!ok) {
+            return false;
         }
+    } else {
+        matching = changed;
+        nmatching = nchanged;
+    }
 
-        /* terminate at end of line */
-        if (*line == '}') {
-            break;
+    for (cur = changed; cur != NULL; cur = cur->next) {
+        if (cur->detail->modified > newest) {
+            newest = cur->detail->modified;
         }
+    }
 
-        /* get field */
-        ret = sscanf(line, "\"%m[^\"]\":", &field);
+    copy_marks(matching);
+
+    /* drop the old versions of changed tasks
+     * a large change is cheaper to sort and index as a whole */
+    bulk = (int)nchanged > index_length() / 8;
+
+    /* hidden tasks are only found by a scan, which does not scale */
+    if (bulk && hidden != NULL) {
+        tnc_fprintf(logfp, LOG_DEBUG, "refresh: %d tasks modified behind a filter view",
+                    nchanged);
+        return false;
+    }
 
-        if (ret != 1) {
-            tnc_fprintf(logfp, LOG_ERROR, "error parsing task @ %s", line);
-            return (struct task*) - 1;
+    for (cur = changed; cur != NULL; cur = cur->next) {
+        pos = index_find_uuid(cur->detail->uuid);
+
+        if (pos < 0) {
+            unhide_task(cur);
+            continue;
+        } else if (bulk) {
+            unlink_task(index_get(pos));
+        } else {
+            remove_task(index_get(pos));
         }
+    }
 
-        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "field: %s", field);
-        line += strlen(field) + 3;
+    /* add the new versions */
+    if (bulk) {
+        for (cur = matching; cur != NULL && cur->next != NULL; cur = cur->next);
 
-        /* determine how to handle content */
-        if (str_eq(field, "id")) {
-            set_int(&(tsk->index), &line);
-        } else if (str_eq(field, "description")) {
-            set_string(&(tsk->description), &line);
-        } else if (str_eq(field, "project")) {
-            set_string(&(tsk->project), &line);
-        } else if (str_eq(field, "tags")) {
-            char* pos = line;
-
-            while (*pos != ']') {
-                pos++;
-            }
+        if (cur != NULL) {
+            cur->next = head;
 
-            tsk->tags = strndup(line + 1, pos - line - 1);
-            line = pos + 1;
-            tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "string: %s", tsk->tags);
-        } else if (str_eq(field, "uuid")) {
-            set_string(&(tsk->uuid), &line);
-        } else if (str_eq(field, "entry")) {
-            set_date(&(tsk->entry), &line);
-        } else if (str_eq(field, "due")) {
-            set_date(&(tsk->due), &line);
-        } else if (str_eq(field, "priority")) {
-            set_char(&(tsk->priority), &line);
-        } else if (str_eq(field, "annotations")) {
-            while (*line != ']') {
-                line++;
+            if (head != NULL) {
+                head->prev = cur;
             }
 
-            line++;
-        } else { /* unknown field */
-            while (*line != ',' && *line != '}') {
-                line++;
-            }
+            head = matching;
         }
 
-        free(field);
+        head = sort_tasks(hide_tasks(head));
+        index_build(head);
+    } else {
+        for (cur = matching; cur != NULL; cur = next) {
+            next = cur->next;
+
+            if (filter_match(cur)) {
+                head = sort_insert(head, cur);
+            } else {
+                hide_task(cur);
+            }
+        }
     }
 
-    return tsk;
+    watermark = newest;
+    task_count();
+    tnc_fprintf(logfp, LOG_DEBUG, "refresh: %d tasks modified, %d match the filter",
+                nchanged, nmatching);
+
+    return true;
 } /* }}} */
 
 void reload_task(struct task* this) { /* {{{ */
     /* reload an individual task's data
      * this - the task whose data needs reloading
      * task data is modified by generating a new task struct, and replacing
-     * the old task in the stack
+     * the old task in the stack at its place in the sort order
      */
     struct task* new;
 
+    /* a background load may have read the task before it changed */
+    load_tasks_refresh();
+
     /* get new task */
-    new = get_tasks(this->uuid);
+    new = get_tasks(this->detail->uuid);
 
     /* check for NULL new task */
     if (new == NULL) {
         tnc_fprintf(logfp, LOG_ERROR, "reload_task(%s): get_tasks returned NULL",
-                    this->uuid);
-
-        if (this->prev != NULL) {
-            this->prev->next = this->next;
-        } else {
-            head = this->next;
-        }
-
-        if (this->next != NULL) {
-            this->next->prev = this->prev;
-        }
-
-        taskcount--;
+                    this->detail->uuid);
+
+        remove_task(this);
+        task_count();
+    } else if (!filter_match(new)) {
+        /* the task is no longer shown by the filter view */
+        remove_task(this);
+        hide_task(new);
+        task_count();
     } else {
-        /* transfer pointers */
-        new->prev = this->prev;
-        new->next = this->next;
-
-        if (this->prev != NULL) {
-            this->prev->next = new;
-        } else {
-            tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "reload_task(%s): no previous task",
-                        this->uuid);
-        }
-
-        if (this->next != NULL) {
-            this->next->prev = new;
-        } else {
-            tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "reload_task(%s): no next task",
-                        this->uuid);
-        }
-
-        /* move to head if necessary */
-        if (this == head) {
-            head = new;
-            tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "reload_task(%s): setting task as head",
-                        this->uuid);
-        }
+        new->marked = this->marked;
+        head = sort_reposition(head, this, new);
+        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "reload_task(%s): moved from %d to %d",
+                    this->detail->uuid, this->position, new->position);
     }
 
-    /* free old task */
-    free_task(this);
-
-    /* re-sort task list */
-    sort_wrapper(head);
+    /* the command which changed the task has finished, and its writes to the
+     * data files are covered by the reload */
+    watch_clear();
 } /* }}} */
 
 void reload_tasks() { /* {{{ */
@@ -452,140 +1601,136 @@ void reload_tasks() { /* {{{ */
 
     tnc_fprintf(logfp, LOG_DEBUG, "reloading tasks");
 
-    free_tasks(head);
-
+    load_tasks_cancel();
     head = get_tasks(NULL);
 
     /* debug */
     cur = head;
 
     while (cur != NULL) {
-        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "%d,%s,%s,%llu,%llu,%llu,%llu,%s,%c,%s",
-                    cur->index, cur->uuid, cur->tags, (unsigned long long)cur->start,
-                    (unsigned long long)cur->end, (unsigned long long)cur->entry,
-                    (unsigned long long)cur->due, cur->project, cur->priority, cur->description);
+        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "%u,%s,%s,%llu,%llu,%llu,%llu,%s,%c,%s",
+                    cur->index, cur->detail->uuid, cur->detail->tags,
+                    (unsigned long long)cur->start, (unsigned long long)cur->detail->end,
+                    (unsigned long long)cur->detail->entry, (unsigned long long)cur->due,
+                    cur->project, cur->priority, cur->detail->description);
         cur = cur->next;
     }
 } /* }}} */
 
-void remove_char(char* str, char remove) { /* {{{ */
-    /* iterate through a string and remove escapes inline
-     * str    - the string to remove escapes from
-     * remove - the escape to remove
+void remove_task(struct task* this) { /* {{{ */
+    /* unlink a task from the task list and remove it from the indexes
+     * this - the task to remove
      */
-    const int   len = strlen(str);
-    int         i;
-    int         offset = 0;
-
-    for (i = 0; i < len; i++) {
-        if (str[i + offset] == '\0') {
-            break;
-        }
-
-        str[i] = str[i + offset];
-
-        while (str[i] == remove || str[i] == '\0') {
-            offset++;
-
-            if (i + offset >= len) {
-                break;
-            }
-
-            str[i] = str[i + offset];
-        }
-
-        if (str[i + offset] == '\0') {
-            break;
-        }
-    }
-
+    unlink_task(this);
+    index_remove(this->position);
 } /* }}} */
 
-void set_char(char* field, char** line) { /* {{{ */
-    /* set a character field from the next contents of line
-     * field - the field set the character in
-     * line  - the line to parse the character from
+struct task* replace_generation(struct task_generation* gen, struct task* new_head,
+                                const char* filter) { /* {{{ */
+    /**
+     * make a fully loaded task list the current one, freeing the generation
+     * of the previous list
+     * the position index is rebuilt first, so it never points into a
+     * generation which has been freed
+     * gen      - the generation the new list was loaded into
+     * new_head - the first task of the new list, sorted
+     * filter   - the filter the new list was loaded with
+     * return is the first task of the new list which is shown
      */
-    int ret = sscanf(*line, "\"%c\"", field);
-
-    if (ret != 1) {
-        tnc_fprintf(logfp, LOG_ERROR, "error parsing char @ %s", *line);
-    } else {
-        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "char: %c", *field);
-    }
+    watermark = newest_modified(new_head);
+    hidden = NULL;
+    new_head = hide_tasks(new_head);
+    copy_marks(new_head);
+    index_build(new_head);
+    free_generation(generation);
+    generation = gen;
+    filter = strdup(filter);
+    check_free(loaded_filter);
+    loaded_filter = (char*)filter;
 
-    while (**line != ',' &&** line != '}') {
-        (*line)++;
-    }
+    return new_head;
 } /* }}} */
 
-void set_date(time_t* field, char** line) { /* {{{ */
-    /* set a time field from the next contents of line
-     * field - the field set the time in
-     * line  - the line to parse the time from
+bool run_export(const char* cmdstr, struct arena* arena,
+                struct task** first, unsigned int* count) { /* {{{ */
+    /* run an export command and parse the tasks it outputs
+     * cmdstr - the export command
+     * arena  - the arena the tasks and their strings are allocated from
+     * first  - where the first task of the unsorted list is stored
+     * count  - where the number of tasks is stored
+     * return is whether the command ran and its output could be parsed
      */
-    char*   tmp;
-    int     ret = sscanf(*line, "\"%m[^\"]\"", &tmp);
+    FILE*           cmd;
+    char*           data;
+    size_t          len;
+    struct task*    last = NULL;
+    long long       start;
 
-    if (ret != 1) {
-        tnc_fprintf(logfp, LOG_ERROR, "error parsing time @ %s", *line);
-    } else {
-        *field = strtotime(tmp);
-        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "time: %d", (int)*field);
-        free(tmp);
-    }
+    *first = NULL;
+    *count = 0;
 
-    while (**line != ',' &&** line != '}') {
-        (*line)++;
+    tnc_fprintf(logfp, LOG_DEBUG, "reloading tasks (%s)", cmdstr);
+    cmd = process_open(cmdstr);
+
+    if (cmd == NULL) {
+        tnc_fprintf(logfp, LOG_ERROR, "could not execute command: (%s)", cmdstr);
+        tnc_fprintf(stdout, LOG_ERROR, "could not execute command: (%s)", cmdstr);
+        return false;
     }
-} /* }}} */
 
-void set_int(unsigned short* field, char** line) { /* {{{ */
-    /* set an integer field from the next contents of line
-     * field - the field set the integer in
-     * line  - the line to parse the integer from
-     */
-    int ret = sscanf(*line, "%hd", field);
+    /* read the whole export, task strings will point into this buffer */
+    start = metrics_start();
+    data = arena_adopt(arena, read_export(cmd, &len));
+    process_close(cmd);
+    metrics_end(PHASE_EXPORT, start);
 
-    if (ret != 1) {
-        tnc_fprintf(logfp, LOG_ERROR, "error parsing integer @ %s", *line);
-    } else {
-        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "int: %d", *field);
+    if (data == NULL) {
+        tnc_fprintf(logfp, LOG_ERROR, "failed to read task export");
+        return false;
     }
 
-    while (**line != ',' &&** line != '}') {
-        (*line)++;
-    }
+    return parse_export_parallel(data, data + len, arena, first, &last, count);
 } /* }}} */
 
-void set_string(char** field, char** line) { /* {{{ */
-    /* set an string field from the next contents of line
-     * field - the field set the string in
-     * line  - the line to parse the string from
+int run_command(const char* cmdstr) { /* {{{ */
+    /* run a command in the background, logging its output
+     * cmdstr - the command to run
+     * return is the return of the command run
      */
-    char* tmp = *line;
+    char*   line;
+    char*   fullcmd;
+    FILE*   cmd;
+    int     ret;
 
-    do {
-        tmp = strstr(*line, "\",");
+    asprintf(&fullcmd, "%s 2>&1", cmdstr);
+    tnc_fprintf(logfp, LOG_DEBUG, "running command: %s", fullcmd);
 
-        if (tmp == NULL) {
-            tmp = strstr(*line, "\"}");
-        }
-    } while (tmp != NULL && *(tmp - 1) == '\\');
+    /* the command may change what task info shows */
+    view_cache_clear();
 
-    *field = strndup((*line) + 1, tmp - (*line) - 1);
+    /* run command in background */
+    cmd = process_open(fullcmd);
+    free(fullcmd);
 
-    if (tmp == NULL || *field == NULL) {
-        tnc_fprintf(logfp, LOG_ERROR, "error parsing string @ %s", *line);
-    } else {
-        tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, "string: %s", *field);
+    if (cmd == NULL) {
+        return -1;
     }
 
-    *line += tmp - *line;
+    while (!feof(cmd)) {
+        ret = fscanf(cmd, "%m[^\n]*", &line);
 
-    while (**line != ',' &&** line != '}') {
-        (*line)++;
+        if (ret == 1) {
+            tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, line);
+            free(line);
+        } else {
+            break;
+        }
     }
+
+    ret = process_status(process_close(cmd));
+    tnc_fprintf(logfp, LOG_DEBUG, "command returned: %d", ret);
+
+    return ret;
 } /* }}} */
 
 void set_position_by_uuid(const char* uuid) { /* {{{ */
@@ -628,56 +1773,107 @@ int task_background_command(const char* cmdfmt) { /* {{{ */
      */
     struct task*    cur;
     char*           cmdstr;
-    char*           line;
-    FILE*           cmd;
     int             ret;
 
     /* build command */
     cur = get_task_by_position(selline);
-    asprintf(&cmdstr, cmdfmt, cur->uuid);
-    cmdstr = realloc(cmdstr, (strlen(cmdstr) + 6) * sizeof(char));
-    strcat(cmdstr, " 2>&1");
-    tnc_fprintf(logfp, LOG_DEBUG, "running command: %s", cmdstr);
-
-    /* run command in background */
-    cmd = popen(cmdstr, "r");
+    asprintf(&cmdstr, cmdfmt, cur->detail->uuid);
+    ret = run_command(cmdstr);
     free(cmdstr);
 
-    while (!feof(cmd)) {
-        ret = fscanf(cmd, "%m[^\n]*", &line);
+    return ret;
+} /* }}} */
 
-        if (ret == 1) {
-            tnc_fprintf(logfp, LOG_DEBUG_VERBOSE, line);
-            free(line);
-        } else {
+int task_batch_command(const char* cmd) { /* {{{ */
+    /**
+     * run a command on the marked tasks in the background, passing the
+     * uuids of as many tasks as fit in BATCHLENGTH bytes to each invocation
+     * confirmation is turned off, since the command cannot prompt and
+     * taskwarrior asks before changing more than a few tasks at once
+     * cmd - the command to run, which follows the uuids, e.g. "done"
+     * return is 0, or the return of the last batch which failed
+     */
+    struct task*    cur = head;
+    struct task*    end;
+    char*           cmdstr;
+    char*           pos;
+    size_t          len;
+    int             ret = 0;
+    int             batchret;
+    int             n;
+
+    while (cur != NULL) {
+        /* find the marked tasks of the next batch */
+        len = 0;
+        n   = 0;
+
+        for (end = cur; end != NULL; end = end->next) {
+            if (!end->marked) {
+                continue;
+            }
+
+            if (n > 0 && len + strlen(end->detail->uuid) + 1 > BATCHLENGTH) {
+                break;
+            }
+
+            len += strlen(end->detail->uuid) + 1;
+            n++;
+        }
+
+        if (n == 0) {
             break;
         }
-    }
 
-    ret = pclose(cmd);
+        /* build and run its command */
+        cmdstr = malloc(len + strlen(cmd) + 64);
+        pos = cmdstr + sprintf(cmdstr, "task rc.confirmation=off rc.bulk=0");
 
-    /* log command return value */
-    if (WEXITSTATUS(ret) == 0 || WEXITSTATUS(ret) == 128 + SIGPIPE) {
-        ret = 0;
-    } else {
-        ret = WEXITSTATUS(ret);
-    }
+        for (; cur != end; cur = cur->next) {
+            if (cur->marked) {
+                pos += sprintf(pos, " %s", cur->detail->uuid);
+            }
+        }
 
-    tnc_fprintf(logfp, LOG_DEBUG, "command returned: %d", ret);
+        sprintf(pos, " %s < /dev/null", cmd);
+        batchret = run_command(cmdstr);
+        free(cmdstr);
+
+        if (batchret != 0) {
+            ret = batchret;
+        }
+    }
 
     return ret;
 } /* }}} */
 
 void task_count() { /* {{{ */
-    taskcount = 0;
-    struct task* cur;
+    /* update the number of tasks from the position index */
+    taskcount = index_length();
+} /* }}} */
 
-    cur = head;
+bool task_filter(const char* filter) { /* {{{ */
+    /* apply a filter to the loaded tasks without exporting them again, which
+     * is possible if it only adds simple terms to the filter they were
+     * loaded with
+     * filter - the filter to apply
+     * return is false if the task list must be reloaded instead
+     */
+    struct task* all;
 
-    while (cur != NULL) {
-        taskcount++;
-        cur = cur->next;
+    if (generation == NULL || loaded_filter == NULL || load_tasks_pending() ||
+            !filter_compile(filter, loaded_filter)) {
+        filter_clear();
+        return false;
     }
+
+    all = join_tasks(head, hidden);
+    hidden = NULL;
+    head = sort_tasks(hide_tasks(all));
+    index_build(head);
+    task_count();
+    tnc_fprintf(logfp, LOG_DEBUG, "filter applied to loaded tasks (%d shown)", taskcount);
+
+    return true;
 } /* }}} */
 
 int task_interactive_command(const char* cmdfmt) { /* {{{ */
@@ -693,9 +1889,13 @@ int task_interactive_command(const char* cmdfmt) { /* {{{ */
 
     /* build command */
     cur = get_task_by_position(selline);
-    asprintf(&cmdstr, cmdfmt, cur->uuid);
+    asprintf(&cmdstr, cmdfmt, cur->detail->uuid);
     tnc_fprintf(logfp, LOG_DEBUG, "running command: %s", cmdstr);
 
+    /* the command may depend on those run in the background */
+    process_flush();
+    view_cache_clear();
+
     /* exit window */
     def_prog_mode();
     endwin();
@@ -713,6 +1913,51 @@ int task_interactive_command(const char* cmdfmt) { /* {{{ */
     return ret;
 } /* }}} */
 
+const char* task_line(struct task* tsk, const int width) { /* {{{ */
+    /**
+     * get the line of the task list showing a task
+     * the line is kept with the task and only evaluated again when the task
+     * format, the window width or the task data have changed
+     * tsk   - the task to show
+     * width - the width of the window the line will be drawn in
+     * return is the line, owned by the task, or NULL on failure
+     */
+    unsigned int    gen = task_format_generation();
+    unsigned int    size;
+    int             len;
+
+    if (gen != 0 && tsk->line != NULL && tsk->linegen == gen &&
+            tsk->linewidth == width && tsk->linedatagen == tsk->datagen) {
+        return tsk->line;
+    }
+
+    /* the line is evaluated into the task's buffer, which is only replaced
+     * when the line outgrows it, by one at least as wide as the window and
+     * twice as large, as the old one stays in the arena until the next load */
+    len = eval_format_buffer(cfg.formats.task_compiled, tsk, tsk->line, tsk->linesize);
+
+    if (len < 0) {
+        return NULL;
+    } else if ((unsigned int)len >= tsk->linesize) {
+        size = len > width ? (unsigned int)len + 1 : (unsigned int)width + 1;
+        size = size < 2 * tsk->linesize ? 2 * tsk->linesize : size;
+        tsk->line = arena_alloc(&(generation->side), size);
+        tsk->linesize = tsk->line != NULL ? size : 0;
+
+        if (tsk->line == NULL) {
+            return NULL;
+        }
+
+        eval_format_buffer(cfg.formats.task_compiled, tsk, tsk->line, tsk->linesize);
+    }
+
+    tsk->linegen = gen;
+    tsk->linewidth = width;
+    tsk->linedatagen = tsk->datagen;
+
+    return tsk->line;
+} /* }}} */
+
 bool task_match(const struct task* cur, const char* str) { /* {{{ */
     /* check if specified task meets specified conditions
      * cur - the task to check
@@ -720,13 +1965,44 @@ bool task_match(const struct task* cur, const char* str) { /* {{{ */
      *       refer to the manual for how conditions are specified
      * return is whether the task matches
      */
-    if (match_string(cur->project, str) ||
-        match_string(cur->description, str) ||
-        match_string(cur->tags, str)) {
-        return 1;
-    } else {
-        return 0;
+    return task_match_regex(cur, regex_get(str, REGEX_OPTS));
+} /* }}} */
+
+bool task_match_regex(const struct task* cur, const regex_t* regex) { /* {{{ */
+    /* check if a task matches a compiled regex
+     * cur   - the task to check
+     * regex - the compiled pattern, as returned by regex_get
+     * return is whether the project, description or tags match
+     */
+    return match_regex(cur->project, regex) ||
+           match_regex(cur->detail->description, regex) ||
+           match_regex(cur->detail->tags, regex);
+} /* }}} */
+
+void task_mark(struct task* tsk, const bool marked) { /* {{{ */
+    /* set whether a task is marked for a batch command
+     * tsk    - the task to mark
+     * marked - whether the task is marked
+     */
+    if (tsk->marked != marked) {
+        tsk->marked = marked;
+        /* marks are shown by color rules, so the cached colors are stale */
+        tsk->datagen++;
+    }
+} /* }}} */
+
+int task_marks(void) { /* {{{ */
+    /* count the marked tasks in the task list */
+    struct task*    cur;
+    int             n = 0;
+
+    for (cur = head; cur != NULL; cur = cur->next) {
+        if (cur->marked) {
+            n++;
+        }
     }
+
+    return n;
 } /* }}} */
 
 void task_modify(const char* argstr) { /* {{{ */
@@ -756,7 +2032,7 @@ void task_modify(const char* argstr) { /* {{{ */
 
     task_background_command(cmd);
 
-    uuid = strdup(cur->uuid);
+    uuid = strdup(cur->detail->uuid);
     reload_task(cur);
 
     if (cfg.follow_task) {
@@ -769,4 +2045,69 @@ void task_modify(const char* argstr) { /* {{{ */
     free(cmd);
 } /* }}} */
 
+void task_unmark_all(void) { /* {{{ */
+    /* clear the marks of all tasks */
+    struct task* cur;
+
+    for (cur = head; cur != NULL; cur = cur->next) {
+        task_mark(cur, false);
+    }
+} /* }}} */
+
+void unhide_task(const struct task* tsk) { /* {{{ */
+    /* drop the old version of a task from the hidden tasks, if it is there
+     * tsk - the new version of the task
+     */
+    struct task* cur;
+
+    for (cur = hidden; cur != NULL; cur = cur->next) {
+        if (memcmp(cur->uuidkey, tsk->uuidkey, UUIDKEYLENGTH) == 0 &&
+                strcmp(cur->detail->uuid, tsk->detail->uuid) == 0) {
+            break;
+        }
+    }
+
+    if (cur == NULL) {
+        return;
+    }
+
+    if (cur->prev != NULL) {
+        cur->prev->next = cur->next;
+    } else {
+        hidden = cur->next;
+    }
+
+    if (cur->next != NULL) {
+        cur->next->prev = cur->prev;
+    }
+} /* }}} */
+
+void unlink_task(struct task* this) { /* {{{ */
+    /* unlink a task from the task list, leaving the indexes unchanged
+     * this - the task to unlink
+     */
+    if (this->prev != NULL) {
+        this->prev->next = this->next;
+    } else {
+        head = this->next;
+    }
+
+    if (this->next != NULL) {
+        this->next->prev = this->prev;
+    }
+} /* }}} */
+
+time_t utctotime(const char* timestr) { /* {{{ */
+    /* convert a utc timestamp string to a time_t
+     * unlike strtotime, the result converts back to the same string
+     * timestr - the string to parse, in the form 20130101T000000Z
+     * return is the time parsed
+     */
+    struct tm tmr;
+
+    memset(&tmr, 0, sizeof(tmr));
+    strptime(timestr, "%Y%m%dT%H%M%S", &tmr);
+    return timegm(&tmr);
+} /* }}} */
+
 // vim: et ts=4 sw=4 sts=4
@@ -13,8 +13,11 @@
 #include "command.h"
 #include "common.h"
 #include "config.h"
+#include "filter.h"
 #include "formats.h"
+#include "intern.h"
 #include "log.h"
+#include "metrics.h"
 #include "tasks.h"
 #include "tasknc.h"
 #include "test.h"
@@ -22,6 +25,8 @@
 #ifdef TASKNC_INCLUDE_TESTS
 /* local functions {{{ */
 void test_compile_fmt(void);
+void test_filter(void);
+void test_parse_task(void);
 void test_result(const char* testname, const bool passed);
 void test_search(void);
 void test_set_var(void);
@@ -40,6 +45,8 @@ void test(const char* args) { /* {{{ */
     };
     struct test tests[] = {
         {"compile_fmt", test_compile_fmt},
+        {"filter", test_filter},
+        {"parse_task", test_parse_task},
         {"task_count", test_task_count},
         {"trim", test_trim},
         {"search", test_search},
@@ -95,6 +102,85 @@ void test_compile_fmt() { /* {{{ */
     } else {
         puts("NULL returned");
     }
+
+    /* a var whose name starts with the name of another */
+    metrics.phases[PHASE_SORT].calls = 7;
+    fmts = compile_format_string("$metrics_sort_calls");
+    eval = eval_format(fmts, NULL);
+    test_result("format var", eval != NULL && str_eq(eval, "7"));
+    metrics.phases[PHASE_SORT].calls = 0;
+} /* }}} */
+
+void test_filter(void) { /* {{{ */
+    /* test evaluating a filter on the loaded tasks */
+    struct arena        arena;
+    struct task         tsk;
+    struct task_detail  detail;
+    bool                pass;
+
+    memset(&tsk, 0, sizeof(tsk));
+    memset(&detail, 0, sizeof(detail));
+    tsk.detail          = &detail;
+    tsk.project         = "work.meetings";
+    tsk.priority        = 'H';
+    detail.tags         = "\"next\",\"bug\"";
+    detail.description  = "write the filter test";
+    arena_init(&arena, 256);
+    intern_task(&tsk, &arena);
+
+    pass = filter_compile("status:pending pro:work +bug -waiting pri:H desc.contains:fil+ter",
+                          "status:pending") && filter_match(&tsk);
+    tsk.priority = 0;
+    pass = pass && !filter_match(&tsk);
+    pass = pass && filter_compile("status:pending pri:", "status:pending") && filter_match(&tsk);
+
+    /* filters which need taskwarrior */
+    pass = pass && !filter_compile("pro:work", "status:pending");
+    pass = pass && !filter_compile("status:pending +ACTIVE", "status:pending");
+    pass = pass && !filter_compile("pro:a or pro:b +bug", "pro:a or pro:b");
+    pass = pass && filter_view() == NULL;
+
+    test_result("filter", pass);
+    arena_free(&arena);
+} /* }}} */
+
+void test_parse_task(void) { /* {{{ */
+    /* test parsing a line of task export json */
+    struct arena    arena;
+    struct task*    this;
+    bool            pass;
+    char*           pos;
+    char*           line = strdup("{\"id\":12,\"description\":\"say \\\"hi\\\" \\\\ caf\\u00e9\","
+                                  "\"annotations\":[{\"entry\":\"20120110T231200Z\",\"description\":\"a ] }\"}],"
+                                  "\"tags\":[\"one\", \"two\"],\"udas\":{\"x\":[1,{\"y\":\"]\"}]},"
+                                  "\"priority\":\"M\",\"project\":\"tasknc\","
+                                  "\"status\":\"pending\",\"urgency\":4.5,"
+                                  "\"uuid\":\"0123-4567\"},");
+
+    arena_init(&arena, 256);
+    pos = line;
+    this = parse_task(&pos, &arena);
+    pass = this != (struct task*) - 1 &&
+           this->index == 12 &&
+           str_eq(this->detail->description, "say \"hi\" \\ caf\xc3\xa9") &&
+           str_eq(this->detail->tags, "\"one\",\"two\"") &&
+           str_eq(this->project, "tasknc") &&
+           this->project == intern_name(this->projectid) &&
+           this->ntags == 2 && str_eq(intern_name(this->tagids[1]), "two") &&
+           str_eq(this->detail->uuid, "0123-4567") &&
+           str_eq(this->detail->annotations, "a ] }") && this->detail->nannotations == 1 &&
+           this->detail->status == 'p' && this->detail->urgency == 4.5 &&
+           this->priority == 'M' &&
+           *pos == ',';
+    test_result("parse_task", pass);
+
+    if (this != (struct task*) - 1 && !pass) {
+        printf("description: %s\n", this->detail->description);
+        printf("tags: %s\n", this->detail->tags);
+    }
+
+    arena_free(&arena);
+    free(line);
 } /* }}} */
 
 void test_result(const char* testname, const bool passed) { /* {{{ */
@@ -130,12 +216,11 @@ void test_search() { /* {{{ */
     asprintf(&addcmdstr, "task add pro:%s pri:%c %s", proj, pri, unique);
     cmdout = popen(addcmdstr, "r");
     pclose(cmdout);
-    free_tasks(head);
     head = get_tasks(NULL);
 
     stdout = devnull;
     searchstring = strdup(unique);
-    find_next_search_result(head, head);
+    find_search_result(head, 1);
     stdout = out;
     this = get_task_by_position(selline);
     pass = strcmp(this->project, proj) == 0 && this->priority == pri;
@@ -147,10 +232,10 @@ void test_search() { /* {{{ */
         puts(tmp);
         free(tmp);
         puts("selected:");
-        printf("uuid: %s\n", this->uuid);
-        printf("description: %s\n", this->description);
+        printf("uuid: %s\n", this->detail->uuid);
+        printf("description: %s\n", this->detail->description);
         printf("project: %s\n", this->project);
-        printf("tags: %s\n", this->tags);
+        printf("tags: %s\n", this->detail->tags);
         fflush(stdout);
         asprintf(&testcmdstr, "task list %s", unique);
         system(testcmdstr);
@@ -0,0 +1,172 @@
+/*
+ * watch.c - notification of changes to taskwarrior's data files
+ * for tasknc
+ * by mjheagle
+ */
+
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "common.h"
+#include "config.h"
+#include "log.h"
+#include "watch.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+/**
+ * data directory watcher
+ * fd      - the notification descriptor, -1 if the data files are not watched
+ * pending - whether a change was seen that has not been reported yet
+ * due     - when the pending change is reported, in ms of the monotonic clock
+ */
+static struct {
+    int fd;
+    bool pending;
+    long due;
+} watcher = {-1, false, 0};
+
+/* local functions */
+static bool data_file_name(const char* name);
+
+bool data_file_name(const char* name) { /* {{{ */
+    /**
+     * check whether a file in the data directory holds task data
+     * this includes the journals sqlite keeps next to its database
+     * name - the name of the file
+     */
+    size_t  len;
+    int     i;
+
+    for (i = 0; i < DATAFILES; i++) {
+        len = strlen(data_files[i]);
+
+        if (strncmp(name, data_files[i], len) == 0 && (name[len] == 0 || name[len] == '-')) {
+            return true;
+        }
+    }
+
+    return false;
+} /* }}} */
+
+void watch_clear(void) { /* {{{ */
+    /* forget the changes seen so far
+     * this is run when the task list is reloaded anyway, so that changes
+     * made by tasknc's own commands do not cause a second reload
+     */
+    if (watcher.fd < 0) {
+        return;
+    }
+
+    watch_read();
+    watcher.pending = false;
+} /* }}} */
+
+bool watch_due(void) { /* {{{ */
+    /* check whether a change is due to be reloaded, which happens once the
+     * data files have not been written for WATCHDELAY ms
+     * return is true once per change
+     */
+    if (!watcher.pending || now_ms() < watcher.due) {
+        return false;
+    }
+
+    watcher.pending = false;
+
+    return true;
+} /* }}} */
+
+int watch_fd(void) { /* {{{ */
+    /* get the descriptor to wait on for changes, -1 if there is none */
+    return watcher.fd;
+} /* }}} */
+
+void watch_read(void) { /* {{{ */
+    /* read the notifications waiting on the descriptor without blocking
+     * each change to a data file pushes back when the change is due
+     */
+#ifdef __linux__
+    char            buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event* event;
+    ssize_t         len;
+    char*           pos;
+
+    while ((len = read(watcher.fd, buffer, sizeof(buffer))) > 0) {
+        for (pos = buffer; pos < buffer + len; pos += sizeof(struct inotify_event) + event->len) {
+            event = (const struct inotify_event*) pos;
+
+            if (event->len > 0 && data_file_name(event->name)) {
+                watcher.pending = true;
+                watcher.due     = now_ms() + WATCHDELAY;
+            }
+        }
+    }
+#endif
+} /* }}} */
+
+bool watch_start(void) { /* {{{ */
+    /* start watching the data directory for changes
+     * return is whether changes will be reported, which requires inotify
+     */
+#ifdef __linux__
+    char*   dir;
+    int     fd;
+
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (fd < 0) {
+        tnc_fprintf(logfp, LOG_ERROR, "watch: could not create an inotify instance");
+        return false;
+    }
+
+    dir = data_location();
+
+    if (inotify_add_watch(fd, dir, IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE) < 0) {
+        tnc_fprintf(logfp, LOG_ERROR, "watch: could not watch %s", dir);
+        free(dir);
+        close(fd);
+        return false;
+    }
+
+    tnc_fprintf(logfp, LOG_DEBUG, "watch: watching %s", dir);
+    free(dir);
+    watcher.fd      = fd;
+    watcher.pending = false;
+
+    return true;
+#else
+    return false;
+#endif
+} /* }}} */
+
+void watch_stop(void) { /* {{{ */
+    /* stop watching the data directory */
+    if (watcher.fd >= 0) {
+        close(watcher.fd);
+    }
+
+    watcher.fd      = -1;
+    watcher.pending = false;
+} /* }}} */
+
+int watch_timeout(void) { /* {{{ */
+    /* get the time until a pending change is due in ms
+     * return is -1 if no change is pending
+     */
+    long wait;
+
+    if (!watcher.pending) {
+        return -1;
+    }
+
+    wait = watcher.due - now_ms();
+
+    return wait > 0 ? wait : 0;
+} /* }}} */
+
+// vim: et ts=4 sw=4 sts=4